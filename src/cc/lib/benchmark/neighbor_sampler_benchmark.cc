@@ -13,6 +13,7 @@
 #include "src/cc/lib/graph/xoroshiro.h"
 
 #include "boost/random/exponential_distribution.hpp"
+#include "boost/random/uniform_real_distribution.hpp"
 #include <benchmark/benchmark.h>
 #ifdef SNARK_PLATFORM_LINUX
 #include <mimalloc-override.h>
@@ -93,7 +94,9 @@ std::pair<size_t, size_t> create_partition(MemoryGraph t, std::filesystem::path
     return {counter, nb_index.size()};
 }
 
-snark::Graph create_graph(size_t num_types, size_t num_nodes_per_partition, size_t num_partitions)
+// Nodes have mean_degree neighbors of every type on average, weighted graphs have random edge weights.
+snark::Graph create_graph(size_t num_types, size_t num_nodes_per_partition, size_t num_partitions,
+                          float mean_degree = 10, bool weighted = false, size_t search_tree_degree_threshold = 0)
 {
     snark::Xoroshiro128PlusGenerator gen(42);
     auto path = std::filesystem::temp_directory_path();
@@ -103,8 +106,8 @@ snark::Graph create_graph(size_t num_types, size_t num_nodes_per_partition, size
     size_t num_nodes = 0;
     size_t num_edges = 0;
     // https://en.wikipedia.org/wiki/Scale-free_network
-    // On average it will have 1/0.1 = 10 neighbors.
-    boost::random::exponential_distribution<float> d(0.1f);
+    boost::random::exponential_distribution<float> d(1.0f / mean_degree);
+    boost::random::uniform_real_distribution<float> weight(0.1f, 1.0f);
     int64_t node_id = 0;
     for (size_t p = 0; p < num_partitions; ++p)
     {
@@ -118,7 +121,7 @@ snark::Graph create_graph(size_t num_types, size_t num_nodes_per_partition, size
             {
                 for (size_t i = 0; i < num_neighbors; ++i)
                 {
-                    nbs.emplace_back(node_id + i + t * num_neighbors, snark::Type(t), 1.0f);
+                    nbs.emplace_back(node_id + i + t * num_neighbors, snark::Type(t), weighted ? weight(gen) : 1.0f);
                 }
             }
 
@@ -156,19 +159,14 @@ snark::Graph create_graph(size_t num_types, size_t num_nodes_per_partition, size
         meta.close();
     };
     return snark::Graph(snark::Metadata{path.string()}, std::move(partition_paths), std::move(partition_indices),
-                        snark::PartitionStorageType::memory);
+                        snark::PartitionStorageType::memory,
+                        snark::GraphOptions{.m_search_tree_degree_threshold = search_tree_degree_threshold});
 }
 
-static void BM_ONE_NODE_TYPE_WEIGHTED(benchmark::State &state)
+void sample_neighbors(benchmark::State &state, snark::Graph &s, std::vector<snark::NodeId> &input_nodes,
+                      size_t batch_size, size_t num_neighbors_to_sample)
 {
-    const size_t num_partitions = 10;
-    const size_t num_nodes_per_partition = 100000;
-    auto s = create_graph(1, num_nodes_per_partition, num_partitions);
-    const auto total_nodes = num_nodes_per_partition * num_partitions;
-    std::vector<snark::NodeId> input_nodes(total_nodes);
-    std::iota(std::begin(input_nodes), std::end(input_nodes), 0);
     std::shuffle(std::begin(input_nodes), std::end(input_nodes), snark::Xoroshiro128PlusGenerator(23));
-    const size_t num_neighbors_to_sample = 10;
     size_t max_count = num_neighbors_to_sample * (1 << 13);
     std::vector<snark::Type> edge_types({0});
     std::vector<float> weight_holder(max_count, -1);
@@ -178,7 +176,6 @@ static void BM_ONE_NODE_TYPE_WEIGHTED(benchmark::State &state)
     size_t offset = 0;
     for (auto _ : state)
     {
-        const size_t batch_size = state.range(0);
         std::vector<float> total_neighbor_weight(batch_size);
         s.SampleNeighbor(++seed, std::span(input_nodes).subspan(offset, batch_size), std::span(edge_types),
                          num_neighbors_to_sample,
@@ -187,12 +184,36 @@ static void BM_ONE_NODE_TYPE_WEIGHTED(benchmark::State &state)
                          std::span(weight_holder).subspan(0, num_neighbors_to_sample * batch_size),
                          std::span(total_neighbor_weight), 0, 0, -1);
         offset += batch_size;
-        if (offset + batch_size > max_count)
+        if (offset + batch_size > std::min(max_count, input_nodes.size()))
         {
             offset = 0;
         }
     }
 }
 
+static void BM_ONE_NODE_TYPE_WEIGHTED(benchmark::State &state)
+{
+    const size_t num_partitions = 10;
+    const size_t num_nodes_per_partition = 100000;
+    auto s = create_graph(1, num_nodes_per_partition, num_partitions);
+    const auto total_nodes = num_nodes_per_partition * num_partitions;
+    std::vector<snark::NodeId> input_nodes(total_nodes);
+    std::iota(std::begin(input_nodes), std::end(input_nodes), 0);
+    sample_neighbors(state, s, input_nodes, state.range(0), 10);
+}
+
+// Weighted neighbors of nodes with hundreds of edges are found with std::lower_bound over cumulative weights
+// for a zero search tree threshold or in search trees otherwise.
+static void BM_CUMULATIVE_WEIGHT_SEARCH(benchmark::State &state)
+{
+    const size_t num_partitions = 1;
+    const size_t num_nodes_per_partition = 4000;
+    auto s = create_graph(1, num_nodes_per_partition, num_partitions, 500, true, state.range(0));
+    std::vector<snark::NodeId> input_nodes(num_nodes_per_partition * num_partitions);
+    std::iota(std::begin(input_nodes), std::end(input_nodes), 0);
+    sample_neighbors(state, s, input_nodes, 512, 100);
+}
+
 BENCHMARK(BM_ONE_NODE_TYPE_WEIGHTED)->RangeMultiplier(2)->Range(1 << 3, 1 << 12);
+BENCHMARK(BM_CUMULATIVE_WEIGHT_SEARCH)->Arg(0)->Arg(32);
 BENCHMARK_MAIN();
@@ -6,12 +6,15 @@
 #include <algorithm>
 #include <cassert>
 #include <span>
+#include <thread>
 
 #include "absl/container/flat_hash_set.h"
 #include <glog/logging.h>
 #include <glog/raw_logging.h>
 
+#include "src/cc/lib/graph/huge_pages.h"
 #include "src/cc/lib/graph/locator.h"
+#include "src/cc/lib/graph/parallel.h"
 
 namespace
 {
@@ -22,16 +25,158 @@ static const size_t neighbors_prefix_len = neighbors_prefix.size();
 
 namespace snark
 {
+namespace
+{
+// Sparse features read by RunNearPartitions, workers append them to indices and values of their NUMA nodes.
+// Every position records its node, dimensions and where its data ends to merge outputs in request order.
+class SparseFeatureOutputs
+{
+  public:
+    SparseFeatureOutputs(size_t numa_node_count, size_t position_count, size_t feature_count)
+        : m_feature_count(feature_count), m_indices(numa_node_count, std::vector<std::vector<int64_t>>(feature_count)),
+          m_values(numa_node_count, std::vector<std::vector<uint8_t>>(feature_count)),
+          m_dimensions(position_count * feature_count, -1), m_numa_nodes(position_count),
+          m_indices_ends(position_count * feature_count), m_values_ends(position_count * feature_count)
+    {
+    }
+
+    // Dimensions of features of a position, features not found keep -1.
+    std::span<int64_t> Dimensions(size_t position)
+    {
+        return std::span(m_dimensions).subspan(position * m_feature_count, m_feature_count);
+    }
+
+    std::vector<std::vector<int64_t>> &Indices(size_t numa_node)
+    {
+        return m_indices[numa_node];
+    }
+
+    std::vector<std::vector<uint8_t>> &Values(size_t numa_node)
+    {
+        return m_values[numa_node];
+    }
+
+    // Record where data of a position ends in outputs of its NUMA node.
+    void Finish(size_t numa_node, size_t position)
+    {
+        m_numa_nodes[position] = numa_node;
+        for (size_t feature = 0; feature < m_feature_count; ++feature)
+        {
+            m_indices_ends[position * m_feature_count + feature] = m_indices[numa_node][feature].size();
+            m_values_ends[position * m_feature_count + feature] = m_values[numa_node][feature].size();
+        }
+    }
+
+    // Append features to response in the order of positions, like reading them sequentially would.
+    void Append(snark::SparseFeaturesReply &response) const
+    {
+        response.mutable_dimensions()->Resize(int(m_feature_count), 0);
+        auto dimensions = response.mutable_dimensions()->mutable_data();
+        for (size_t feature = 0; feature < m_feature_count; ++feature)
+        {
+            std::vector<size_t> indices_begin(m_indices.size());
+            std::vector<size_t> values_begin(m_values.size());
+            int64_t indices_count = 0;
+            int64_t values_count = 0;
+            for (size_t position = 0; position < m_numa_nodes.size(); ++position)
+            {
+                const auto numa_node = m_numa_nodes[position];
+                const auto &indices = m_indices[numa_node][feature];
+                const auto indices_end = m_indices_ends[position * m_feature_count + feature];
+                response.mutable_indices()->Add(std::begin(indices) + indices_begin[numa_node],
+                                                std::begin(indices) + indices_end);
+                indices_count += indices_end - indices_begin[numa_node];
+                indices_begin[numa_node] = indices_end;
+
+                const auto &values = m_values[numa_node][feature];
+                const auto values_end = m_values_ends[position * m_feature_count + feature];
+                response.mutable_values()->append(std::begin(values) + values_begin[numa_node],
+                                                  std::begin(values) + values_end);
+                values_count += values_end - values_begin[numa_node];
+                values_begin[numa_node] = values_end;
+
+                // Later nodes overwrite dimensions.
+                if (m_dimensions[position * m_feature_count + feature] >= 0)
+                {
+                    dimensions[feature] = m_dimensions[position * m_feature_count + feature];
+                }
+            }
+            response.mutable_indices_counts()->Add(indices_count);
+            response.mutable_values_counts()->Add(values_count);
+        }
+    }
+
+  private:
+    size_t m_feature_count;
+    std::vector<std::vector<std::vector<int64_t>>> m_indices;
+    std::vector<std::vector<std::vector<uint8_t>>> m_values;
+    std::vector<int64_t> m_dimensions;
+    std::vector<size_t> m_numa_nodes;
+    std::vector<size_t> m_indices_ends;
+    std::vector<size_t> m_values_ends;
+};
+
+// String features read by RunNearPartitions, workers append values to outputs of their NUMA nodes.
+class StringFeatureOutputs
+{
+  public:
+    StringFeatureOutputs(size_t numa_node_count, size_t position_count)
+        : m_values(numa_node_count), m_numa_nodes(position_count), m_values_ends(position_count)
+    {
+    }
+
+    std::vector<uint8_t> &Values(size_t numa_node)
+    {
+        return m_values[numa_node];
+    }
+
+    // Record where values of a position end in outputs of its NUMA node.
+    void Finish(size_t numa_node, size_t position)
+    {
+        m_numa_nodes[position] = numa_node;
+        m_values_ends[position] = m_values[numa_node].size();
+    }
+
+    // Append values to response in the order of positions.
+    void Append(snark::StringFeaturesReply &response) const
+    {
+        std::vector<size_t> values_begin(m_values.size());
+        for (size_t position = 0; position < m_numa_nodes.size(); ++position)
+        {
+            const auto numa_node = m_numa_nodes[position];
+            const auto &values = m_values[numa_node];
+            response.mutable_values()->append(std::begin(values) + values_begin[numa_node],
+                                              std::begin(values) + m_values_ends[position]);
+            values_begin[numa_node] = m_values_ends[position];
+        }
+    }
+
+  private:
+    std::vector<std::vector<uint8_t>> m_values;
+    std::vector<size_t> m_numa_nodes;
+    std::vector<size_t> m_values_ends;
+};
+} // namespace
 
 GraphEngineServiceImpl::GraphEngineServiceImpl(snark::Metadata metadata, std::vector<std::string> paths,
-                                               std::vector<uint32_t> partitions, PartitionStorageType storage_type)
-    : m_metadata(std::move(metadata))
+                                               std::vector<uint32_t> partitions, PartitionStorageType storage_type,
+                                               GraphOptions options)
+    : m_metadata(std::move(metadata)),
+      m_reader(storage_type == PartitionStorageType::disk || storage_type == PartitionStorageType::hybrid
+                   ? AsyncReader::Backend::io_uring
+                   : AsyncReader::Backend::threads)
 {
     if (paths.size() != partitions.size())
     {
         RAW_LOG_FATAL("Not enough %ld paths provided. Expected %ld for each partition.", paths.size(),
                       partitions.size());
     }
+
+    // Arrays are allocated with huge pages while partitions and node map are loaded.
+    HugePageScope huge_page_scope(options.m_huge_pages);
+
+    // Path and suffix of every partition in loading order.
+    std::vector<std::pair<std::filesystem::path, std::string>> partition_files;
     for (size_t partition_index = 0; partition_index < paths.size(); ++partition_index)
     {
         std::vector<std::string> suffixes;
@@ -75,38 +220,160 @@ GraphEngineServiceImpl::GraphEngineServiceImpl(snark::Metadata metadata, std::ve
         }
 
         std::sort(std::begin(suffixes), std::end(suffixes));
-        for (size_t i = 0; i < suffixes.size(); ++i)
+        for (auto &suffix : suffixes)
         {
-            m_partitions.emplace_back(m_metadata, paths[partition_index], suffixes[i], storage_type);
-            ReadNodeMap(paths[partition_index], suffixes[i], partition_index);
+            partition_files.emplace_back(paths[partition_index], std::move(suffix));
         }
     }
+
+    // Spread partitions between NUMA nodes round robin, requests are served by workers next to them.
+    const size_t numa_nodes =
+        options.m_numa ? (options.m_numa_node_count > 0 ? options.m_numa_node_count : numa_node_count()) : 1;
+    m_partition_numa_nodes.resize(partition_files.size());
+    for (size_t index = 0; index < partition_files.size(); ++index)
+    {
+        m_partition_numa_nodes[index] = index % numa_nodes;
+    }
+    if (numa_nodes > 1)
+    {
+        m_numa_workers = std::make_unique<NumaWorkers>(
+            numa_nodes, std::max<size_t>(std::thread::hardware_concurrency() / numa_nodes, 1));
+    }
+
+    // Partitions are independent, load them in parallel.
+    m_partitions.resize(partition_files.size());
+    const size_t partition_count = std::max<size_t>(partition_files.size(), 1);
+    auto partition_options = options;
+    partition_options.m_feature_cache_size /= partition_count;
+    partition_options.m_block_cache_size /= partition_count;
+    partition_options.m_pinned_features_size /= partition_count;
+    // Partitions build their sampling tables in parallel too, share hardware threads to avoid oversubscription.
+    const size_t partition_threads = std::max<size_t>(std::thread::hardware_concurrency() / partition_count, 1);
+    parallel_for(partition_files.size(), [&](size_t index) {
+        auto load = [&]() {
+            m_partitions[index] = Partition(m_metadata, partition_files[index].first, partition_files[index].second,
+                                            storage_type, partition_options, partition_threads);
+        };
+
+        // Arrays are allocated on the NUMA node of the thread that touches them first.
+        if (m_numa_workers)
+        {
+            run_on_numa_node(m_partition_numa_nodes[index], load);
+        }
+        else
+        {
+            load();
+        }
+    });
+    if (options.m_compact_neighbor_ids)
+    {
+        const auto neighbor_ids = Partition::NeighborIdTable(m_partitions);
+        parallel_for(m_partitions.size(), [&](size_t index) {
+            auto compact = [&]() { m_partitions[index].CompactNeighborIds(neighbor_ids); };
+            if (m_numa_workers)
+            {
+                run_on_numa_node(m_partition_numa_nodes[index], compact);
+            }
+            else
+            {
+                compact();
+            }
+        });
+    }
+    m_node_map = NodeMap(partition_files, m_metadata.m_config_path);
+    log_huge_page_stats();
 }
 
-grpc::Status GraphEngineServiceImpl::GetNodeTypes(::grpc::ServerContext *context,
-                                                  const snark::NodeTypesRequest *request,
-                                                  snark::NodeTypesReply *response)
+void GraphEngineServiceImpl::RunNearPartitions(std::span<const uint64_t> indices,
+                                               std::function<void(size_t, size_t)> f,
+                                               std::function<void(size_t)> finish) const
 {
-    for (int curr_offset = 0; curr_offset < request->node_ids().size(); ++curr_offset)
+    if (!m_numa_workers)
     {
-        auto elem = m_node_map.find(request->node_ids()[curr_offset]);
-        if (elem == std::end(m_node_map))
+        for (size_t position = 0; position < indices.size(); ++position)
+        {
+            f(0, position);
+        }
+        if (finish)
+        {
+            finish(0);
+        }
+        return;
+    }
+
+    std::vector<std::vector<size_t>> positions(m_numa_workers->NodeCount());
+    for (size_t position = 0; position < indices.size(); ++position)
+    {
+        positions[m_partition_numa_nodes[m_node_map.PartitionIndex(indices[position])]].emplace_back(position);
+    }
+
+    std::vector<size_t> nodes;
+    for (size_t node = 0; node < positions.size(); ++node)
+    {
+        if (!positions[node].empty())
+        {
+            nodes.emplace_back(node);
+        }
+    }
+
+    m_numa_workers->Run(nodes, [&](size_t node) {
+        for (auto position : positions[node])
+        {
+            f(node, position);
+        }
+        if (finish)
+        {
+            finish(node);
+        }
+    });
+}
+
+size_t GraphEngineServiceImpl::NumaNodeCount() const
+{
+    return m_numa_workers ? m_numa_workers->NodeCount() : 1;
+}
+
+void GraphEngineServiceImpl::FindNodes(std::span<const NodeId> node_ids, std::vector<uint64_t> &indices,
+                                       std::vector<size_t> &offsets) const
+{
+    for (size_t offset = 0; offset < node_ids.size(); ++offset)
+    {
+        const auto index = m_node_map.Find(node_ids[offset]);
+        if (index == NodeMap::npos)
         {
             continue;
         }
 
-        auto index = elem->second;
-        const size_t partition_count = m_counts[index];
-        Type result = snark::PLACEHOLDER_NODE_TYPE;
-        for (size_t partition = 0; partition < partition_count && result == snark::PLACEHOLDER_NODE_TYPE;
+        indices.emplace_back(index);
+        offsets.emplace_back(offset);
+    }
+}
+
+grpc::Status GraphEngineServiceImpl::GetNodeTypes(::grpc::ServerContext *context,
+                                                  const snark::NodeTypesRequest *request,
+                                                  snark::NodeTypesReply *response)
+{
+    std::vector<uint64_t> found_indices;
+    std::vector<size_t> found_offsets;
+    FindNodes(std::span(request->node_ids().data(), request->node_ids().size()), found_indices, found_offsets);
+
+    std::vector<Type> types(found_indices.size(), snark::PLACEHOLDER_NODE_TYPE);
+    RunNearPartitions(found_indices, [&](size_t, size_t position) {
+        auto index = found_indices[position];
+        const size_t partition_count = m_node_map.Count(index);
+        for (size_t partition = 0; partition < partition_count && types[position] == snark::PLACEHOLDER_NODE_TYPE;
              ++partition, ++index)
         {
-            result = m_partitions[m_partitions_indices[index]].GetNodeType(m_internal_indices[index]);
+            types[position] = m_partitions[m_node_map.PartitionIndex(index)].GetNodeType(m_node_map.InternalId(index));
         }
-        if (result == snark::PLACEHOLDER_NODE_TYPE)
+    });
+
+    for (size_t position = 0; position < found_indices.size(); ++position)
+    {
+        if (types[position] == snark::PLACEHOLDER_NODE_TYPE)
             continue;
-        response->add_offsets(curr_offset);
-        response->add_types(result);
+        response->add_offsets(found_offsets[position]);
+        response->add_types(types[position]);
     }
 
     return grpc::Status::OK;
@@ -124,34 +391,49 @@ grpc::Status GraphEngineServiceImpl::GetNodeFeatures(::grpc::ServerContext *cont
         fv_size += feature.size();
     }
 
-    size_t feature_offset = 0;
+    // Find nodes with features first to allocate output once, reads are batched and
+    // need stable destination addresses.
+    std::vector<uint64_t> found_indices;
     for (int node_offset = 0; node_offset < request->node_ids().size(); ++node_offset)
     {
-        auto internal_id = m_node_map.find(request->node_ids()[node_offset]);
-        if (internal_id == std::end(m_node_map))
+        auto index = m_node_map.Find(request->node_ids()[node_offset]);
+        if (index == NodeMap::npos)
         {
             continue;
         }
 
-        response->mutable_feature_values()->resize(feature_offset + fv_size);
-        auto index = internal_id->second;
-        const size_t partition_count = m_counts[index];
-        auto data = reinterpret_cast<uint8_t *>(response->mutable_feature_values()->data());
-        auto data_span = std::span(data + feature_offset, fv_size);
+        const size_t partition_count = m_node_map.Count(index);
         for (size_t partition = 0; partition < partition_count; ++partition, ++index)
         {
-            if (m_partitions[m_partitions_indices[index]].HasNodeFeatures(m_internal_indices[index]))
+            if (m_partitions[m_node_map.PartitionIndex(index)].HasNodeFeatures(m_node_map.InternalId(index)))
             {
-                response->mutable_feature_values()->resize(feature_offset + fv_size);
-                m_partitions[m_partitions_indices[index]].GetNodeFeature(m_internal_indices[index], features,
-                                                                         data_span);
-                feature_offset += fv_size;
+                found_indices.emplace_back(index);
                 response->add_offsets(node_offset);
                 break;
             }
         }
     }
 
+    response->mutable_feature_values()->resize(found_indices.size() * fv_size);
+    auto data = reinterpret_cast<uint8_t *>(response->mutable_feature_values()->data());
+    std::vector<std::vector<ReadRequest>> requests(NumaNodeCount());
+    std::vector<std::vector<PendingNodeFeature>> pending(requests.size());
+    RunNearPartitions(
+        found_indices,
+        [&](size_t numa_node, size_t position) {
+            const auto index = found_indices[position];
+            m_partitions[m_node_map.PartitionIndex(index)].GetNodeFeature(
+                m_node_map.InternalId(index), features, std::span(data + position * fv_size, fv_size),
+                &requests[numa_node], &pending[numa_node]);
+        },
+        [&](size_t numa_node) {
+            // Workers submit reads of their NUMA node instead of the calling thread, so nodes read in parallel.
+            m_reader.Read(requests[numa_node]);
+            for (const auto &node : pending[numa_node])
+            {
+                node.m_partition->FinishNodeFeature(node);
+            }
+        });
     return grpc::Status::OK;
 }
 
@@ -171,36 +453,41 @@ grpc::Status GraphEngineServiceImpl::GetEdgeFeatures(::grpc::ServerContext *cont
         fv_size += feature.size();
     }
 
-    size_t feature_offset = 0;
-    for (size_t node_offset = 0; node_offset < len; ++node_offset)
-    {
-        auto internal_id = m_node_map.find(request->node_ids()[node_offset]);
-        if (internal_id == std::end(m_node_map))
-        {
-            continue;
-        }
-
-        response->mutable_feature_values()->resize(feature_offset + fv_size);
-        auto index = internal_id->second;
-        const size_t partition_count = m_counts[index];
-        auto data = reinterpret_cast<uint8_t *>(response->mutable_feature_values()->data());
+    std::vector<uint64_t> found_indices;
+    std::vector<size_t> found_offsets;
+    FindNodes(std::span(request->node_ids().data(), len), found_indices, found_offsets);
+
+    // Every source node gets a slot in the output, slots of missing edges are dropped after all reads.
+    response->mutable_feature_values()->resize(found_indices.size() * fv_size);
+    auto data = reinterpret_cast<uint8_t *>(response->mutable_feature_values()->data());
+    std::vector<uint8_t> found_edges(found_indices.size());
+    RunNearPartitions(found_indices, [&](size_t, size_t position) {
+        auto index = found_indices[position];
+        const auto edge_offset = found_offsets[position];
+        const size_t partition_count = m_node_map.Count(index);
         bool found_edge = false;
         for (size_t partition = 0; partition < partition_count && !found_edge; ++partition, ++index)
         {
-            found_edge = m_partitions[m_partitions_indices[index]].GetEdgeFeature(
-                m_internal_indices[index], request->node_ids()[len + node_offset], request->types()[node_offset],
-                features, std::span(data + feature_offset, fv_size));
-        }
-        if (found_edge)
-        {
-            response->add_offsets(node_offset);
-            feature_offset += fv_size;
+            found_edge = m_partitions[m_node_map.PartitionIndex(index)].GetEdgeFeature(
+                m_node_map.InternalId(index), request->node_ids()[len + edge_offset], request->types()[edge_offset],
+                features, std::span(data + position * fv_size, fv_size));
         }
-        else
+        found_edges[position] = found_edge;
+    });
+
+    size_t feature_offset = 0;
+    for (size_t position = 0; position < found_indices.size(); ++position)
+    {
+        if (!found_edges[position])
         {
-            response->mutable_feature_values()->resize(feature_offset);
+            continue;
         }
+
+        std::copy_n(data + position * fv_size, fv_size, data + feature_offset);
+        response->add_offsets(found_offsets[position]);
+        feature_offset += fv_size;
     }
+    response->mutable_feature_values()->resize(feature_offset);
     return grpc::Status::OK;
 }
 
@@ -210,38 +497,25 @@ grpc::Status GraphEngineServiceImpl::GetNodeSparseFeatures(::grpc::ServerContext
 {
     std::span<const snark::FeatureId> features =
         std::span(request->feature_ids().data(), request->feature_ids().size());
-    auto *reply_dimensions = response->mutable_dimensions();
-    reply_dimensions->Resize(int(features.size()), 0);
-    auto dimensions = std::span(reply_dimensions->mutable_data(), reply_dimensions->size());
-    std::vector<std::vector<int64_t>> indices(features.size());
-    std::vector<std::vector<uint8_t>> values(features.size());
-
-    for (int node_offset = 0; node_offset < request->node_ids().size(); ++node_offset)
-    {
-        auto internal_id = m_node_map.find(request->node_ids()[node_offset]);
-        if (internal_id == std::end(m_node_map))
-        {
-            continue;
-        }
-
-        auto index = internal_id->second;
-        const size_t partition_count = m_counts[index];
+    std::vector<uint64_t> found_indices;
+    std::vector<size_t> found_offsets;
+    FindNodes(std::span(request->node_ids().data(), request->node_ids().size()), found_indices, found_offsets);
+
+    SparseFeatureOutputs outputs(NumaNodeCount(), found_indices.size(), features.size());
+    RunNearPartitions(found_indices, [&](size_t numa_node, size_t position) {
+        auto index = found_indices[position];
+        const size_t partition_count = m_node_map.Count(index);
         bool found = false;
         for (size_t partition = 0; partition < partition_count && !found; ++partition, ++index)
         {
-            found = m_partitions[m_partitions_indices[index]].GetNodeSparseFeature(
-                m_internal_indices[index], features, int64_t(node_offset), dimensions, indices, values);
+            found = m_partitions[m_node_map.PartitionIndex(index)].GetNodeSparseFeature(
+                m_node_map.InternalId(index), features, int64_t(found_offsets[position]), outputs.Dimensions(position),
+                outputs.Indices(numa_node), outputs.Values(numa_node));
         }
-    }
-
-    for (size_t i = 0; i < features.size(); ++i)
-    {
-        response->mutable_indices()->Add(std::begin(indices[i]), std::end(indices[i]));
-        response->mutable_values()->append(std::begin(values[i]), std::end(values[i]));
-        response->mutable_indices_counts()->Add(indices[i].size());
-        response->mutable_values_counts()->Add(values[i].size());
-    }
+        outputs.Finish(numa_node, position);
+    });
 
+    outputs.Append(*response);
     return grpc::Status::OK;
 }
 
@@ -255,39 +529,27 @@ grpc::Status GraphEngineServiceImpl::GetEdgeSparseFeatures(::grpc::ServerContext
     assert(2 * len == size_t(request->node_ids().size()));
     std::span<const snark::FeatureId> features =
         std::span(request->feature_ids().data(), request->feature_ids().size());
-    auto *reply_dimensions = response->mutable_dimensions();
-    reply_dimensions->Resize(int(features.size()), 0);
-    auto dimensions = std::span(reply_dimensions->mutable_data(), reply_dimensions->size());
-
-    std::vector<std::vector<int64_t>> indices(features.size());
-    std::vector<std::vector<uint8_t>> values(features.size());
-    for (size_t node_offset = 0; node_offset < len; ++node_offset)
-    {
-        auto internal_id = m_node_map.find(request->node_ids()[node_offset]);
-        if (internal_id == std::end(m_node_map))
-        {
-            continue;
-        }
-
-        auto index = internal_id->second;
-        const size_t partition_count = m_counts[index];
+    std::vector<uint64_t> found_indices;
+    std::vector<size_t> found_offsets;
+    FindNodes(std::span(request->node_ids().data(), len), found_indices, found_offsets);
+
+    SparseFeatureOutputs outputs(NumaNodeCount(), found_indices.size(), features.size());
+    RunNearPartitions(found_indices, [&](size_t numa_node, size_t position) {
+        auto index = found_indices[position];
+        const auto edge_offset = found_offsets[position];
+        const size_t partition_count = m_node_map.Count(index);
         bool found_edge = false;
         for (size_t partition = 0; partition < partition_count && !found_edge; ++partition, ++index)
         {
-            found_edge = m_partitions[m_partitions_indices[index]].GetEdgeSparseFeature(
-                m_internal_indices[index], request->node_ids()[len + node_offset], request->types()[node_offset],
-                features, int64_t(node_offset), dimensions, indices, values);
+            found_edge = m_partitions[m_node_map.PartitionIndex(index)].GetEdgeSparseFeature(
+                m_node_map.InternalId(index), request->node_ids()[len + edge_offset], request->types()[edge_offset],
+                features, int64_t(edge_offset), outputs.Dimensions(position), outputs.Indices(numa_node),
+                outputs.Values(numa_node));
         }
-    }
-
-    for (size_t i = 0; i < features.size(); ++i)
-    {
-        response->mutable_indices()->Add(std::begin(indices[i]), std::end(indices[i]));
-        response->mutable_values()->append(std::begin(values[i]), std::end(values[i]));
-        response->mutable_indices_counts()->Add(indices[i].size());
-        response->mutable_values_counts()->Add(values[i].size());
-    }
+        outputs.Finish(numa_node, position);
+    });
 
+    outputs.Append(*response);
     return grpc::Status::OK;
 }
 
@@ -303,29 +565,25 @@ grpc::Status GraphEngineServiceImpl::GetNodeStringFeatures(::grpc::ServerContext
 
     reply_dimensions->Resize(int(features_size * nodes_size), 0);
     auto dimensions = std::span(reply_dimensions->mutable_data(), reply_dimensions->size());
-    std::vector<uint8_t> values;
-
-    for (int node_offset = 0; node_offset < request->node_ids().size(); ++node_offset)
-    {
-        auto internal_id = m_node_map.find(request->node_ids()[node_offset]);
-        if (internal_id == std::end(m_node_map))
-        {
-            continue;
-        }
-
-        auto dims_span = dimensions.subspan(features_size * node_offset, features_size);
-
-        auto index = internal_id->second;
-        const size_t partition_count = m_counts[index];
+    std::vector<uint64_t> found_indices;
+    std::vector<size_t> found_offsets;
+    FindNodes(std::span(request->node_ids().data(), nodes_size), found_indices, found_offsets);
+
+    StringFeatureOutputs outputs(NumaNodeCount(), found_indices.size());
+    RunNearPartitions(found_indices, [&](size_t numa_node, size_t position) {
+        auto index = found_indices[position];
+        auto dims_span = dimensions.subspan(features_size * found_offsets[position], features_size);
+        const size_t partition_count = m_node_map.Count(index);
         bool found = false;
         for (size_t partition = 0; partition < partition_count && !found; ++partition, ++index)
         {
-            found = m_partitions[m_partitions_indices[index]].GetNodeStringFeature(m_internal_indices[index], features,
-                                                                                   dims_span, values);
+            found = m_partitions[m_node_map.PartitionIndex(index)].GetNodeStringFeature(
+                m_node_map.InternalId(index), features, dims_span, outputs.Values(numa_node));
         }
-    }
+        outputs.Finish(numa_node, position);
+    });
 
-    response->mutable_values()->append(std::begin(values), std::end(values));
+    outputs.Append(*response);
     return grpc::Status::OK;
 }
 
@@ -343,28 +601,26 @@ grpc::Status GraphEngineServiceImpl::GetEdgeStringFeatures(::grpc::ServerContext
     auto *reply_dimensions = response->mutable_dimensions();
     reply_dimensions->Resize(int(features_size * len), 0);
     auto dimensions = std::span(reply_dimensions->mutable_data(), reply_dimensions->size());
-    std::vector<uint8_t> values;
-
-    for (size_t edge_offset = 0; edge_offset < len; ++edge_offset)
-    {
-        auto internal_id = m_node_map.find(request->node_ids()[edge_offset]);
-        if (internal_id == std::end(m_node_map))
-        {
-            continue;
-        }
-
-        auto index = internal_id->second;
-        const size_t partition_count = m_counts[index];
+    std::vector<uint64_t> found_indices;
+    std::vector<size_t> found_offsets;
+    FindNodes(std::span(request->node_ids().data(), len), found_indices, found_offsets);
+
+    StringFeatureOutputs outputs(NumaNodeCount(), found_indices.size());
+    RunNearPartitions(found_indices, [&](size_t numa_node, size_t position) {
+        auto index = found_indices[position];
+        const auto edge_offset = found_offsets[position];
+        const size_t partition_count = m_node_map.Count(index);
         bool found_edge = false;
         for (size_t partition = 0; partition < partition_count && !found_edge; ++partition, ++index)
         {
-            found_edge = m_partitions[m_partitions_indices[index]].GetEdgeStringFeature(
-                m_internal_indices[index], request->node_ids()[len + edge_offset], request->types()[edge_offset],
-                features, dimensions.subspan(features_size * edge_offset, features_size), values);
+            found_edge = m_partitions[m_node_map.PartitionIndex(index)].GetEdgeStringFeature(
+                m_node_map.InternalId(index), request->node_ids()[len + edge_offset], request->types()[edge_offset],
+                features, dimensions.subspan(features_size * edge_offset, features_size), outputs.Values(numa_node));
         }
-    }
+        outputs.Finish(numa_node, position);
+    });
 
-    response->mutable_values()->append(std::begin(values), std::end(values));
+    outputs.Append(*response);
     return grpc::Status::OK;
 }
 
@@ -374,27 +630,21 @@ grpc::Status GraphEngineServiceImpl::GetNeighborCounts(::grpc::ServerContext *co
 {
     const auto node_count = request->node_ids().size();
     response->mutable_neighbor_counts()->Resize(node_count, 0);
+    auto neighbor_counts = response->mutable_neighbor_counts()->mutable_data();
     auto input_edge_types = std::span(request->edge_types().data(), request->edge_types().size());
+    std::vector<uint64_t> found_indices;
+    std::vector<size_t> found_offsets;
+    FindNodes(std::span(request->node_ids().data(), node_count), found_indices, found_offsets);
 
-    for (int node_index = 0; node_index < node_count; ++node_index)
-    {
-        auto internal_id = m_node_map.find(request->node_ids()[node_index]);
-        if (internal_id == std::end(m_node_map))
-        {
-            continue;
-        }
-        else
+    RunNearPartitions(found_indices, [&](size_t, size_t position) {
+        auto index = found_indices[position];
+        const size_t partition_count = m_node_map.Count(index);
+        for (size_t partition = 0; partition < partition_count; ++partition, ++index)
         {
-            auto index = internal_id->second;
-            size_t partition_count = m_counts[index];
-            for (size_t partition = 0; partition < partition_count; ++partition, ++index)
-            {
-                response->mutable_neighbor_counts()->at(node_index) +=
-                    m_partitions[m_partitions_indices[index]].NeighborCount(m_internal_indices[index],
-                                                                            input_edge_types);
-            }
+            neighbor_counts[found_offsets[position]] += m_partitions[m_node_map.PartitionIndex(index)].NeighborCount(
+                m_node_map.InternalId(index), input_edge_types);
         }
-    }
+    });
 
     return grpc::Status::OK;
 }
@@ -405,36 +655,44 @@ grpc::Status GraphEngineServiceImpl::GetNeighbors(::grpc::ServerContext *context
 {
     const auto node_count = request->node_ids().size();
     response->mutable_neighbor_counts()->Resize(node_count, 0);
+    auto neighbor_counts = response->mutable_neighbor_counts()->mutable_data();
     auto input_edge_types = std::span(request->edge_types().data(), request->edge_types().size());
-    std::vector<NodeId> output_neighbor_ids;
-    std::vector<Type> output_neighbor_types;
-    std::vector<float> output_neighbors_weights;
-    for (int node_index = 0; node_index < node_count; ++node_index)
+    std::vector<uint64_t> found_indices;
+    std::vector<size_t> found_offsets;
+    FindNodes(std::span(request->node_ids().data(), node_count), found_indices, found_offsets);
+
+    // Workers append neighbors to lists of their NUMA nodes, which are merged in request order with neighbor counts.
+    struct Neighbors
     {
-        auto internal_id = m_node_map.find(request->node_ids()[node_index]);
-        if (internal_id == std::end(m_node_map))
-        {
-            continue;
-        }
-        else
+        std::vector<NodeId> m_ids;
+        std::vector<Type> m_types;
+        std::vector<float> m_weights;
+    };
+    std::vector<Neighbors> neighbors(NumaNodeCount());
+    std::vector<size_t> numa_nodes(found_indices.size());
+    RunNearPartitions(found_indices, [&](size_t numa_node, size_t position) {
+        auto &output = neighbors[numa_node];
+        auto index = found_indices[position];
+        const size_t partition_count = m_node_map.Count(index);
+        for (size_t partition = 0; partition < partition_count; ++partition, ++index)
         {
-            auto index = internal_id->second;
-            const size_t partition_count = m_counts[index];
-            for (size_t partition = 0; partition < partition_count; ++partition, ++index)
-            {
-                response->mutable_neighbor_counts()->at(node_index) +=
-                    m_partitions[m_partitions_indices[index]].FullNeighbor(m_internal_indices[index], input_edge_types,
-                                                                           output_neighbor_ids, output_neighbor_types,
-                                                                           output_neighbors_weights);
-                response->mutable_node_ids()->Add(std::begin(output_neighbor_ids), std::end(output_neighbor_ids));
-                response->mutable_edge_types()->Add(std::begin(output_neighbor_types), std::end(output_neighbor_types));
-                response->mutable_edge_weights()->Add(std::begin(output_neighbors_weights),
-                                                      std::end(output_neighbors_weights));
-                output_neighbor_ids.resize(0);
-                output_neighbor_types.resize(0);
-                output_neighbors_weights.resize(0);
-            }
+            neighbor_counts[found_offsets[position]] += m_partitions[m_node_map.PartitionIndex(index)].FullNeighbor(
+                m_node_map.InternalId(index), input_edge_types, output.m_ids, output.m_types, output.m_weights);
         }
+        numa_nodes[position] = numa_node;
+    });
+
+    std::vector<size_t> begins(neighbors.size());
+    for (size_t position = 0; position < found_indices.size(); ++position)
+    {
+        const auto &output = neighbors[numa_nodes[position]];
+        auto &begin = begins[numa_nodes[position]];
+        const auto end = begin + neighbor_counts[found_offsets[position]];
+        response->mutable_node_ids()->Add(std::begin(output.m_ids) + begin, std::begin(output.m_ids) + end);
+        response->mutable_edge_types()->Add(std::begin(output.m_types) + begin, std::begin(output.m_types) + end);
+        response->mutable_edge_weights()->Add(std::begin(output.m_weights) + begin,
+                                              std::begin(output.m_weights) + end);
+        begin = end;
     }
     return grpc::Status::OK;
 }
@@ -446,38 +704,48 @@ grpc::Status GraphEngineServiceImpl::WeightedSampleNeighbors(::grpc::ServerConte
     assert(std::is_sorted(std::begin(request->edge_types()), std::end(request->edge_types())));
 
     size_t count = request->count();
-    size_t nodes_found = 0;
     auto input_edge_types = std::span(request->edge_types().data(), request->edge_types().size());
     auto seed = request->seed();
 
+    // Every partition of a node uses the next seed, assign them upfront to sample nodes in any order.
+    std::vector<uint64_t> found_indices;
+    std::vector<int64_t> seeds;
     for (int node_index = 0; node_index < request->node_ids().size(); ++node_index)
     {
         const auto node_id = request->node_ids()[node_index];
-        auto internal_id = m_node_map.find(node_id);
-        if (internal_id == std::end(m_node_map))
+        auto index = m_node_map.Find(node_id);
+        if (index == NodeMap::npos)
         {
             continue;
         }
-        size_t offset = nodes_found * count;
-        ++nodes_found;
-        const auto index = internal_id->second;
-        const size_t partition_count = m_counts[index];
+        found_indices.emplace_back(index);
+        seeds.emplace_back(seed);
+        seed += m_node_map.Count(index);
         response->add_node_ids(node_id);
-        response->mutable_shard_weights()->Resize(nodes_found, {});
-        auto &last_shard_weight = response->mutable_shard_weights()->at(nodes_found - 1);
-        response->mutable_neighbor_ids()->Resize(nodes_found * count, request->default_node_id());
-        response->mutable_neighbor_types()->Resize(nodes_found * count, request->default_edge_type());
-        response->mutable_neighbor_weights()->Resize(nodes_found * count, request->default_node_weight());
+    }
+
+    const size_t nodes_found = found_indices.size();
+    response->mutable_shard_weights()->Resize(nodes_found, {});
+    response->mutable_neighbor_ids()->Resize(nodes_found * count, request->default_node_id());
+    response->mutable_neighbor_types()->Resize(nodes_found * count, request->default_edge_type());
+    response->mutable_neighbor_weights()->Resize(nodes_found * count, request->default_node_weight());
+    auto shard_weights = response->mutable_shard_weights()->mutable_data();
+    auto neighbor_ids = response->mutable_neighbor_ids()->mutable_data();
+    auto neighbor_types = response->mutable_neighbor_types()->mutable_data();
+    auto neighbor_weights = response->mutable_neighbor_weights()->mutable_data();
+    RunNearPartitions(found_indices, [&](size_t, size_t position) {
+        const auto index = found_indices[position];
+        const size_t offset = position * count;
+        const size_t partition_count = m_node_map.Count(index);
         for (size_t partition = 0; partition < partition_count; ++partition)
         {
-            m_partitions[m_partitions_indices[index + partition]].SampleNeighbor(
-                seed++, m_internal_indices[index + partition], input_edge_types, count,
-                std::span(response->mutable_neighbor_ids()->mutable_data() + offset, count),
-                std::span(response->mutable_neighbor_types()->mutable_data() + offset, count),
-                std::span(response->mutable_neighbor_weights()->mutable_data() + offset, count), last_shard_weight,
-                request->default_node_id(), request->default_node_weight(), request->default_edge_type());
+            m_partitions[m_node_map.PartitionIndex(index + partition)].SampleNeighbor(
+                seeds[position] + partition, m_node_map.InternalId(index + partition), input_edge_types, count,
+                std::span(neighbor_ids + offset, count), std::span(neighbor_types + offset, count),
+                std::span(neighbor_weights + offset, count), shard_weights[position], request->default_node_id(),
+                request->default_node_weight(), request->default_edge_type());
         }
-    }
+    });
     return grpc::Status::OK;
 }
 
@@ -488,37 +756,46 @@ grpc::Status GraphEngineServiceImpl::UniformSampleNeighbors(::grpc::ServerContex
     assert(std::is_sorted(std::begin(request->edge_types()), std::end(request->edge_types())));
 
     size_t count = request->count();
-    size_t nodes_found = 0;
     bool without_replacement = request->without_replacement();
     auto input_edge_types = std::span(request->edge_types().data(), request->edge_types().size());
     auto seed = request->seed();
 
+    std::vector<uint64_t> found_indices;
+    std::vector<int64_t> seeds;
     for (int node_index = 0; node_index < request->node_ids().size(); ++node_index)
     {
         const auto node_id = request->node_ids()[node_index];
-        auto internal_id = m_node_map.find(node_id);
-        if (internal_id == std::end(m_node_map))
+        auto index = m_node_map.Find(node_id);
+        if (index == NodeMap::npos)
         {
             continue;
         }
-        size_t offset = nodes_found * count;
-        ++nodes_found;
-        const auto index = internal_id->second;
-        const size_t partition_count = m_counts[index];
+        found_indices.emplace_back(index);
+        seeds.emplace_back(seed);
+        seed += m_node_map.Count(index);
         response->add_node_ids(node_id);
-        response->mutable_shard_counts()->Resize(nodes_found, {});
-        auto &last_shard_weight = response->mutable_shard_counts()->at(nodes_found - 1);
-        response->mutable_neighbor_ids()->Resize(nodes_found * count, request->default_node_id());
-        response->mutable_neighbor_types()->Resize(nodes_found * count, request->default_edge_type());
+    }
+
+    const size_t nodes_found = found_indices.size();
+    response->mutable_shard_counts()->Resize(nodes_found, {});
+    response->mutable_neighbor_ids()->Resize(nodes_found * count, request->default_node_id());
+    response->mutable_neighbor_types()->Resize(nodes_found * count, request->default_edge_type());
+    auto shard_counts = response->mutable_shard_counts()->mutable_data();
+    auto neighbor_ids = response->mutable_neighbor_ids()->mutable_data();
+    auto neighbor_types = response->mutable_neighbor_types()->mutable_data();
+    RunNearPartitions(found_indices, [&](size_t, size_t position) {
+        const auto index = found_indices[position];
+        const size_t offset = position * count;
+        const size_t partition_count = m_node_map.Count(index);
         for (size_t partition = 0; partition < partition_count; ++partition)
         {
-            m_partitions[m_partitions_indices[index + partition]].UniformSampleNeighbor(
-                without_replacement, seed++, m_internal_indices[index + partition], input_edge_types, count,
-                std::span(response->mutable_neighbor_ids()->mutable_data() + offset, count),
-                std::span(response->mutable_neighbor_types()->mutable_data() + offset, count), last_shard_weight,
-                request->default_node_id(), request->default_edge_type());
+            m_partitions[m_node_map.PartitionIndex(index + partition)].UniformSampleNeighbor(
+                without_replacement, seeds[position] + partition, m_node_map.InternalId(index + partition),
+                input_edge_types, count, std::span(neighbor_ids + offset, count),
+                std::span(neighbor_types + offset, count), shard_counts[position], request->default_node_id(),
+                request->default_edge_type());
         }
-    }
+    });
     return grpc::Status::OK;
 }
 
@@ -555,64 +832,4 @@ grpc::Status GraphEngineServiceImpl::GetMetadata(::grpc::ServerContext *context,
     return grpc::Status::OK;
 }
 
-void GraphEngineServiceImpl::ReadNodeMap(std::filesystem::path path, std::string suffix, uint32_t index)
-{
-    std::shared_ptr<BaseStorage<uint8_t>> node_map;
-    if (!is_hdfs_path(path))
-    {
-        node_map = std::make_shared<DiskStorage<uint8_t>>(std::move(path), std::move(suffix), open_node_map);
-    }
-    else
-    {
-        auto full_path = path / ("node_" + suffix + ".map");
-        node_map = std::make_shared<HDFSStreamStorage<uint8_t>>(full_path.c_str(), m_metadata.m_config_path);
-    }
-    auto node_map_ptr = node_map->start();
-    size_t size = node_map->size() / 20;
-    m_node_map.reserve(size);
-    m_partitions_indices.reserve(size);
-    m_internal_indices.reserve(size);
-    m_counts.reserve(size);
-    for (size_t i = 0; i < size; ++i)
-    {
-        uint64_t pair[2];
-        if (node_map->read(pair, 8, 2, node_map_ptr) != 2)
-        {
-            RAW_LOG_FATAL("Failed to read pair in a node maping");
-        }
-
-        auto el = m_node_map.find(pair[0]);
-        if (el == std::end(m_node_map))
-        {
-            m_node_map[pair[0]] = m_internal_indices.size();
-            m_internal_indices.emplace_back(pair[1]);
-            // TODO: compress vectors below?
-            m_partitions_indices.emplace_back(index);
-            m_counts.emplace_back(1);
-        }
-        else
-        {
-            auto old_offset = el->second;
-            auto old_count = m_counts[old_offset];
-            m_node_map[pair[0]] = m_internal_indices.size();
-
-            std::copy_n(std::begin(m_internal_indices) + old_offset, old_count, std::back_inserter(m_internal_indices));
-            m_internal_indices.emplace_back(pair[1]);
-
-            std::copy_n(std::begin(m_partitions_indices) + old_offset, old_count,
-                        std::back_inserter(m_partitions_indices));
-            m_partitions_indices.emplace_back(index);
-
-            std::fill_n(std::back_inserter(m_counts), old_count + 1, old_count + 1);
-        }
-
-        assert(pair[1] == i);
-        Type node_type;
-        if (node_map->read(&node_type, sizeof(Type), 1, node_map_ptr) != 1)
-        {
-            RAW_LOG_FATAL("Failed to read node type in a node maping");
-        }
-    }
-}
-
 } // namespace snark
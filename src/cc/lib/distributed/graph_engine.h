@@ -4,6 +4,8 @@
 #ifndef SNARK_SERVICE_H
 #define SNARK_SERVICE_H
 
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -13,6 +15,7 @@
 
 #include "src/cc/lib/distributed/service.grpc.pb.h"
 #include "src/cc/lib/graph/graph.h"
+#include "src/cc/lib/graph/numa.h"
 
 namespace snark
 {
@@ -21,7 +24,7 @@ class GraphEngineServiceImpl final : public snark::GraphEngine::Service
 {
   public:
     GraphEngineServiceImpl(snark::Metadata metadata, std::vector<std::string> paths, std::vector<uint32_t> partitions,
-                           PartitionStorageType storage_type);
+                           PartitionStorageType storage_type, GraphOptions options = {});
     grpc::Status GetNodeTypes(::grpc::ServerContext *context, const snark::NodeTypesRequest *request,
                               snark::NodeTypesReply *response) override;
 
@@ -50,15 +53,28 @@ class GraphEngineServiceImpl final : public snark::GraphEngine::Service
     grpc::Status GetMetadata(::grpc::ServerContext *context, const snark::EmptyMessage *request,
                              snark::MetadataReply *response) override;
 
+    // Number of NUMA nodes partitions are spread between, 1 if NUMA mode is disabled.
+    size_t NumaNodeCount() const;
+
   private:
-    void ReadNodeMap(std::filesystem::path path, std::string suffix, uint32_t index);
+    // Call f(numa_node, position) for every position of node map indices. In NUMA mode calls are executed by
+    // workers of the NUMA node with the first partition of a node, otherwise on the calling thread with node 0.
+    // Positions of a node are passed in increasing order, so outputs appended per node can be merged in order.
+    // finish(numa_node) is called by the same worker after all positions of its node, if finish is set.
+    void RunNearPartitions(std::span<const uint64_t> indices, std::function<void(size_t, size_t)> f,
+                           std::function<void(size_t)> finish = nullptr) const;
+    // Node map indices of node_ids found in the graph and their offsets in node_ids.
+    void FindNodes(std::span<const NodeId> node_ids, std::vector<uint64_t> &indices,
+                   std::vector<size_t> &offsets) const;
 
     std::vector<Partition> m_partitions;
-    absl::flat_hash_map<NodeId, uint64_t> m_node_map;
-    std::vector<uint32_t> m_partitions_indices;
-    std::vector<uint64_t> m_internal_indices;
-    std::vector<uint32_t> m_counts;
+    NodeMap m_node_map;
     Metadata m_metadata;
+    AsyncReader m_reader;
+
+    // NUMA node of every partition, partitions are allocated on their nodes in NUMA mode.
+    std::vector<size_t> m_partition_numa_nodes;
+    std::unique_ptr<NumaWorkers> m_numa_workers;
 };
 
 } // namespace snark
@@ -3,6 +3,7 @@
 
 #include "server.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <limits>
 
@@ -11,6 +12,7 @@
 #include <grpcpp/health_check_service_interface.h>
 
 #include "src/cc/lib/distributed/call_data.h"
+#include "src/cc/lib/graph/numa.h"
 
 namespace snark
 {
@@ -112,8 +114,9 @@ class EmptyGraphEngine final : public snark::GraphEngine::Service
 
 GRPCServer::GRPCServer(std::shared_ptr<snark::GraphEngineServiceImpl> engine_service_impl,
                        std::shared_ptr<snark::GraphSamplerServiceImpl> sampler_service_impl, std::string host_name,
-                       std::string ssl_key, std::string ssl_cert, std::string ssl_root)
-    : m_engine_service_impl(std::move(engine_service_impl)), m_sampler_service_impl(std::move(sampler_service_impl))
+                       std::string ssl_key, std::string ssl_cert, std::string ssl_root, size_t numa_nodes)
+    : m_engine_service_impl(std::move(engine_service_impl)), m_sampler_service_impl(std::move(sampler_service_impl)),
+      m_numa_nodes(std::max<size_t>(numa_nodes, 1))
 {
     if (!m_engine_service_impl && !m_sampler_service_impl)
     {
@@ -176,6 +179,11 @@ std::shared_ptr<grpc::Channel> GRPCServer::InProcessChannel()
 
 void GRPCServer::HandleRpcs(size_t index)
 {
+    if (m_numa_nodes > 1)
+    {
+        bind_thread_to_numa_node(index % m_numa_nodes);
+    }
+
     auto &queue = *m_cqs[index];
     if (m_engine_service_impl)
     {
@@ -20,9 +20,11 @@ namespace snark
 class GRPCServer final
 {
   public:
+    // Completion queue threads are spread evenly between numa_nodes NUMA nodes and bound to them if there are
+    // several, pass NumaNodeCount() of the engine service to serve requests next to its partitions.
     GRPCServer(std::shared_ptr<snark::GraphEngineServiceImpl> engine_service_impl,
                std::shared_ptr<snark::GraphSamplerServiceImpl> sampler_service_impl, std::string host_name,
-               std::string ssl_key, std::string ssl_cert, std::string ssl_root);
+               std::string ssl_key, std::string ssl_cert, std::string ssl_root, size_t numa_nodes = 1);
 
     ~GRPCServer();
 
@@ -44,6 +46,7 @@ class GRPCServer final
     std::shared_ptr<snark::GraphSampler::Service> m_sampler_service_impl;
     std::unique_ptr<grpc::Server> m_server;
     std::vector<std::thread> m_runner_threads;
+    size_t m_numa_nodes = 1;
 };
 } // namespace snark
 #endif // SNARK_SERVER_H
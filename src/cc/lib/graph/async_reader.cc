@@ -0,0 +1,422 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#include "async_reader.h"
+#include "locator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(SNARK_PLATFORM_LINUX) && __has_include(<linux/io_uring.h>)
+#define SNARK_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <glog/logging.h>
+#include <glog/raw_logging.h>
+
+namespace snark
+{
+namespace
+{
+// Maximum number of reads in flight for every thread using io_uring.
+const unsigned queue_depth = 128;
+
+// Fallback splits batches between threads, but only if every thread has enough work.
+const size_t fallback_threads = 16;
+const size_t fallback_min_requests_per_thread = 8;
+
+// Complete request with a blocking read, starting done bytes into it.
+void finish_read(const ReadRequest &request, uint64_t done)
+{
+    platform_pread(request.m_file, request.m_output + done, request.m_size - done, request.m_offset + done);
+}
+
+void read_sequential(std::span<const ReadRequest> requests)
+{
+    for (const auto &request : requests)
+    {
+        finish_read(request, 0);
+    }
+}
+
+#ifdef SNARK_IO_URING
+// Minimal io_uring wrapper over raw syscalls: a single submission/completion queue pair
+// owned by one thread.
+class Ring
+{
+  public:
+    Ring()
+    {
+        io_uring_params params = {};
+        m_fd = int(syscall(__NR_io_uring_setup, queue_depth, &params));
+        if (m_fd < 0)
+        {
+            return;
+        }
+
+        // IORING_OP_READ was added in the same kernel version as this feature flag.
+        if ((params.features & IORING_FEAT_RW_CUR_POS) == 0)
+        {
+            Reset();
+            return;
+        }
+
+        m_entries = params.sq_entries;
+        m_sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        m_cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap)
+        {
+            m_sq_size = m_cq_size = std::max(m_sq_size, m_cq_size);
+        }
+
+        m_sq_ptr =
+            ::mmap(nullptr, m_sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+        if (m_sq_ptr == MAP_FAILED)
+        {
+            Reset();
+            return;
+        }
+
+        m_cq_ptr = single_mmap ? m_sq_ptr
+                               : ::mmap(nullptr, m_cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd,
+                                        IORING_OFF_CQ_RING);
+        if (m_cq_ptr == MAP_FAILED)
+        {
+            Reset();
+            return;
+        }
+
+        m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        auto sqes =
+            ::mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED)
+        {
+            Reset();
+            return;
+        }
+
+        m_sqes = static_cast<io_uring_sqe *>(sqes);
+        auto sq = static_cast<uint8_t *>(m_sq_ptr);
+        m_sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        m_sq_mask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        m_sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+        auto cq = static_cast<uint8_t *>(m_cq_ptr);
+        m_cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        m_cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        m_cq_mask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        m_cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    }
+
+    Ring(const Ring &) = delete;
+    Ring &operator=(const Ring &) = delete;
+
+    ~Ring()
+    {
+        Reset();
+    }
+
+    bool Valid() const
+    {
+        return m_fd >= 0;
+    }
+
+    void Read(std::span<const ReadRequest> requests)
+    {
+        size_t next = 0;
+        unsigned in_flight = 0;
+        unsigned to_submit = 0;
+        while (next < requests.size() || in_flight > 0)
+        {
+            // Only this thread produces submissions, so the tail can be read without synchronization.
+            unsigned tail = *m_sq_tail;
+            for (; next < requests.size() && in_flight < m_entries; ++next)
+            {
+                const auto &request = requests[next];
+                if (request.m_size > std::numeric_limits<uint32_t>::max())
+                {
+                    finish_read(request, 0);
+                    continue;
+                }
+
+                const unsigned index = tail & *m_sq_mask;
+                auto &sqe = m_sqes[index];
+                std::memset(&sqe, 0, sizeof(sqe));
+                sqe.opcode = IORING_OP_READ;
+                sqe.fd = fileno(request.m_file);
+                sqe.addr = reinterpret_cast<uint64_t>(request.m_output);
+                sqe.len = uint32_t(request.m_size);
+                sqe.off = request.m_offset;
+                sqe.user_data = next;
+                m_sq_array[index] = index;
+                ++tail;
+                ++in_flight;
+                ++to_submit;
+            }
+
+            __atomic_store_n(m_sq_tail, tail, __ATOMIC_RELEASE);
+            if (in_flight == 0)
+            {
+                break;
+            }
+
+            const auto submitted = syscall(__NR_io_uring_enter, m_fd, to_submit, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (submitted >= 0)
+            {
+                to_submit -= unsigned(submitted);
+            }
+            else if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+            {
+                RAW_LOG_FATAL("Failed to submit reads to io_uring: %s", strerror(errno));
+            }
+
+            unsigned head = *m_cq_head;
+            const unsigned cq_tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+            for (; head != cq_tail; ++head)
+            {
+                const auto &cqe = m_cqes[head & *m_cq_mask];
+                const auto &request = requests[cqe.user_data];
+
+                // Short reads and errors are retried with a blocking read, which reports unrecoverable errors.
+                const uint64_t done = cqe.res > 0 ? uint64_t(cqe.res) : 0;
+                if (done < request.m_size)
+                {
+                    finish_read(request, done);
+                }
+                --in_flight;
+            }
+
+            __atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+        }
+    }
+
+  private:
+    void Reset()
+    {
+        if (m_sqes != nullptr)
+        {
+            ::munmap(m_sqes, m_sqes_size);
+            m_sqes = nullptr;
+        }
+        if (m_cq_ptr != MAP_FAILED && m_cq_ptr != m_sq_ptr)
+        {
+            ::munmap(m_cq_ptr, m_cq_size);
+        }
+        m_cq_ptr = MAP_FAILED;
+        if (m_sq_ptr != MAP_FAILED)
+        {
+            ::munmap(m_sq_ptr, m_sq_size);
+            m_sq_ptr = MAP_FAILED;
+        }
+        if (m_fd >= 0)
+        {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+    }
+
+    int m_fd = -1;
+    unsigned m_entries = 0;
+
+    void *m_sq_ptr = MAP_FAILED;
+    size_t m_sq_size = 0;
+    unsigned *m_sq_tail = nullptr;
+    unsigned *m_sq_mask = nullptr;
+    unsigned *m_sq_array = nullptr;
+
+    io_uring_sqe *m_sqes = nullptr;
+    size_t m_sqes_size = 0;
+
+    void *m_cq_ptr = MAP_FAILED;
+    size_t m_cq_size = 0;
+    unsigned *m_cq_head = nullptr;
+    unsigned *m_cq_tail = nullptr;
+    unsigned *m_cq_mask = nullptr;
+    io_uring_cqe *m_cqes = nullptr;
+};
+
+// Rings are not thread safe, so every thread gets its own.
+Ring &thread_ring()
+{
+    thread_local Ring ring;
+    return ring;
+}
+#endif
+
+bool io_uring_supported()
+{
+#ifdef SNARK_IO_URING
+    Ring probe;
+    if (!probe.Valid())
+    {
+        RAW_LOG_WARNING("io_uring is not available, falling back to threads for disk reads");
+    }
+
+    return probe.Valid();
+#else
+    return false;
+#endif
+}
+
+} // namespace
+
+// Persistent threads reading chunks of batches for the threads backend.
+class AsyncReader::Workers
+{
+  public:
+    ~Workers()
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stop = true;
+        }
+        m_ready.notify_all();
+        for (auto &thread : m_threads)
+        {
+            thread.join();
+        }
+    }
+
+    // Split requests in chunks read by the calling thread and workers, block until all chunks are read.
+    void Read(std::span<const ReadRequest> requests)
+    {
+        const size_t thread_count = std::min(fallback_threads, requests.size() / fallback_min_requests_per_thread);
+        if (thread_count <= 1)
+        {
+            read_sequential(requests);
+            return;
+        }
+
+        // Tasks may be picked up after the batch is complete, so they share its state and find no chunks left.
+        auto batch = std::make_shared<Batch>();
+        batch->m_requests = requests;
+        batch->m_chunk = (requests.size() + thread_count - 1) / thread_count;
+        batch->m_chunk_count = (requests.size() + batch->m_chunk - 1) / batch->m_chunk;
+        {
+            std::lock_guard lock(m_mutex);
+            if (m_threads.empty())
+            {
+                for (size_t i = 1; i < fallback_threads; ++i)
+                {
+                    m_threads.emplace_back([this]() { Work(); });
+                }
+            }
+            for (size_t i = 1; i < batch->m_chunk_count; ++i)
+            {
+                m_tasks.emplace_back([batch]() { batch->ReadChunks(); });
+            }
+        }
+        m_ready.notify_all();
+
+        // Chunks not picked up by busy workers are read by the calling thread.
+        batch->ReadChunks();
+        std::unique_lock lock(batch->m_mutex);
+        batch->m_done.wait(lock, [&batch]() { return batch->m_chunks_read == batch->m_chunk_count; });
+    }
+
+  private:
+    struct Batch
+    {
+        std::span<const ReadRequest> m_requests;
+        size_t m_chunk = 0;
+        size_t m_chunk_count = 0;
+        std::atomic<size_t> m_next = 0;
+
+        std::mutex m_mutex;
+        std::condition_variable m_done;
+        size_t m_chunks_read = 0;
+
+        void ReadChunks()
+        {
+            for (size_t i = m_next++; i < m_chunk_count; i = m_next++)
+            {
+                const size_t start = i * m_chunk;
+                read_sequential(m_requests.subspan(start, std::min(m_chunk, m_requests.size() - start)));
+                std::lock_guard lock(m_mutex);
+                if (++m_chunks_read == m_chunk_count)
+                {
+                    m_done.notify_all();
+                }
+            }
+        }
+    };
+
+    void Work()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock lock(m_mutex);
+                m_ready.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+                if (m_tasks.empty())
+                {
+                    return;
+                }
+
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_ready;
+    std::deque<std::function<void()>> m_tasks;
+    bool m_stop = false;
+    std::vector<std::thread> m_threads;
+};
+
+AsyncReader::AsyncReader() : AsyncReader(Backend::io_uring)
+{
+}
+
+AsyncReader::AsyncReader(Backend backend) : m_backend(backend), m_workers(std::make_shared<Workers>())
+{
+    if (m_backend == Backend::io_uring && !io_uring_supported())
+    {
+        m_backend = Backend::threads;
+    }
+}
+
+AsyncReader::Backend AsyncReader::GetBackend() const
+{
+    return m_backend;
+}
+
+void AsyncReader::Read(std::span<const ReadRequest> requests) const
+{
+    if (requests.empty())
+    {
+        return;
+    }
+
+#ifdef SNARK_IO_URING
+    if (m_backend == Backend::io_uring)
+    {
+        auto &ring = thread_ring();
+        if (ring.Valid())
+        {
+            ring.Read(requests);
+            return;
+        }
+    }
+#endif
+
+    m_workers->Read(requests);
+}
+
+} // namespace snark
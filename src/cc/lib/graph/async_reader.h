@@ -0,0 +1,56 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#ifndef SNARK_ASYNC_READER_H
+#define SNARK_ASYNC_READER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <span>
+
+namespace snark
+{
+
+// Positional read of size bytes at offset in file into output.
+struct ReadRequest
+{
+    FILE *m_file;
+    uint64_t m_offset;
+    uint64_t m_size;
+    uint8_t *m_output;
+};
+
+// Executes batches of positional reads with a high queue depth to saturate local disks.
+// On linux reads are submitted through io_uring, on other platforms or kernels without
+// io_uring support they are spread across a pool of threads issuing blocking reads. Pool threads are owned by
+// the reader and started by the first batch large enough to split.
+class AsyncReader
+{
+  public:
+    enum class Backend
+    {
+        io_uring,
+        threads
+    };
+
+    // Use io_uring if kernel supports it, otherwise fall back to threads.
+    AsyncReader();
+    explicit AsyncReader(Backend backend);
+
+    Backend GetBackend() const;
+
+    // Perform all reads and block until they are complete. Safe to call concurrently.
+    void Read(std::span<const ReadRequest> requests) const;
+
+  private:
+    class Workers;
+
+    Backend m_backend;
+    // Shared by copies of the reader, every batch hands its chunks to the same threads.
+    std::shared_ptr<Workers> m_workers;
+};
+
+} // namespace snark
+
+#endif // SNARK_ASYNC_READER_H
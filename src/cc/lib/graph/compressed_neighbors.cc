@@ -0,0 +1,257 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#include "compressed_neighbors.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(_MSC_VER)
+#define SNARK_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace snark
+{
+namespace
+{
+// Extra bytes after encoded data to load 16 bytes of the last group.
+const size_t data_padding = 16;
+
+uint64_t zigzag_encode(uint64_t delta)
+{
+    return (delta << 1) ^ uint64_t(int64_t(delta) >> 63);
+}
+
+uint64_t zigzag_decode(uint32_t value)
+{
+    return uint64_t(value >> 1) ^ (uint64_t(0) - (value & 1));
+}
+
+uint8_t byte_length(uint32_t value)
+{
+    return value < (1u << 8) ? 1 : value < (1u << 16) ? 2 : value < (1u << 24) ? 3 : 4;
+}
+
+// Byte length of 4 values and shuffle masks to expand them into 32 bit lanes for every control byte.
+struct GroupTables
+{
+    GroupTables()
+    {
+        for (size_t control = 0; control < 256; ++control)
+        {
+            uint8_t offset = 0;
+            for (size_t value = 0; value < 4; ++value)
+            {
+                const uint8_t length = ((control >> (2 * value)) & 3) + 1;
+                for (uint8_t byte = 0; byte < 4; ++byte)
+                {
+                    m_shuffle[control][4 * value + byte] = byte < length ? offset + byte : 0x80;
+                }
+                offset += length;
+            }
+            m_length[control] = offset;
+        }
+    }
+
+    alignas(16) uint8_t m_shuffle[256][16];
+    uint8_t m_length[256];
+};
+
+const GroupTables group_tables;
+
+// Decode groups of 4 values with their control bytes from data to output.
+void decode_groups_scalar(const uint8_t *controls, const uint8_t *data, size_t groups, uint32_t *output)
+{
+    for (size_t group = 0; group < groups; ++group)
+    {
+        const auto control = controls[group];
+        for (size_t value = 0; value < 4; ++value)
+        {
+            const size_t length = ((control >> (2 * value)) & 3) + 1;
+            uint32_t result = 0;
+            memcpy(&result, data, length);
+            output[4 * group + value] = result;
+            data += length;
+        }
+    }
+}
+
+#ifdef SNARK_X86_DISPATCH
+__attribute__((target("ssse3"))) void decode_groups_ssse3(const uint8_t *controls, const uint8_t *data, size_t groups,
+                                                          uint32_t *output)
+{
+    for (size_t group = 0; group < groups; ++group)
+    {
+        const auto control = controls[group];
+        const auto shuffle = _mm_load_si128(reinterpret_cast<const __m128i *>(group_tables.m_shuffle[control]));
+        const auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output + 4 * group), _mm_shuffle_epi8(bytes, shuffle));
+        data += group_tables.m_length[control];
+    }
+}
+#endif
+
+using DecodeGroups = void (*)(const uint8_t *, const uint8_t *, size_t, uint32_t *);
+
+DecodeGroups decode_groups()
+{
+    static const DecodeGroups decode = []() -> DecodeGroups {
+#ifdef SNARK_X86_DISPATCH
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("ssse3"))
+        {
+            return decode_groups_ssse3;
+        }
+#endif
+        return decode_groups_scalar;
+    }();
+    return decode;
+}
+} // namespace
+
+CompressedNeighbors::CompressedNeighbors(std::span<const NodeId> neighbors) : m_size(neighbors.size())
+{
+    const auto block_count = (m_size + NEIGHBOR_BLOCK_SIZE - 1) / NEIGHBOR_BLOCK_SIZE;
+    m_blocks.reserve(block_count);
+
+    std::vector<uint8_t> data;
+    std::vector<uint32_t> deltas;
+    for (uint64_t block = 0; block < block_count; ++block)
+    {
+        const auto values = neighbors.subspan(block * NEIGHBOR_BLOCK_SIZE,
+                                              std::min(NEIGHBOR_BLOCK_SIZE, m_size - block * NEIGHBOR_BLOCK_SIZE));
+        m_blocks.emplace_back(Block{values.front(), data.size()});
+
+        // The first difference is always 0 to decode groups of 4 values from the start of a block.
+        deltas.clear();
+        auto previous = uint64_t(values.front());
+        bool fits = true;
+        for (auto value : values)
+        {
+            const auto encoded = zigzag_encode(uint64_t(value) - previous);
+            fits &= encoded <= std::numeric_limits<uint32_t>::max();
+            deltas.emplace_back(uint32_t(encoded));
+            previous = uint64_t(value);
+        }
+
+        if (!fits)
+        {
+            m_blocks.back().m_offset |= raw_block;
+            const auto bytes = reinterpret_cast<const uint8_t *>(values.data());
+            data.insert(std::end(data), bytes, bytes + values.size_bytes());
+            continue;
+        }
+
+        deltas.resize((deltas.size() + 3) / 4 * 4, 0);
+        const auto controls = data.size();
+        data.resize(controls + deltas.size() / 4, 0);
+        for (size_t i = 0; i < deltas.size(); ++i)
+        {
+            const auto length = byte_length(deltas[i]);
+            data[controls + i / 4] |= uint8_t((length - 1) << (2 * (i % 4)));
+            const auto bytes = reinterpret_cast<const uint8_t *>(&deltas[i]);
+            data.insert(std::end(data), bytes, bytes + length);
+        }
+    }
+
+    data.resize(data.size() + data_padding, 0);
+    m_data.assign(std::begin(data), std::end(data));
+}
+
+bool CompressedNeighbors::empty() const
+{
+    return m_size == 0;
+}
+
+size_t CompressedNeighbors::size() const
+{
+    return m_size;
+}
+
+size_t CompressedNeighbors::memory_size() const
+{
+    return m_blocks.size() * sizeof(Block) + m_data.size();
+}
+
+NodeId CompressedNeighbors::operator[](uint64_t index) const
+{
+    NodeId result;
+    const auto block = index / NEIGHBOR_BLOCK_SIZE;
+    const auto position = index - block * NEIGHBOR_BLOCK_SIZE;
+    DecodeBlock(block, position, position + 1, &result);
+    return result;
+}
+
+void CompressedNeighbors::Decode(uint64_t begin, uint64_t end, NodeId *output) const
+{
+    assert(end <= m_size);
+    while (begin < end)
+    {
+        const auto block = begin / NEIGHBOR_BLOCK_SIZE;
+        const auto block_begin = block * NEIGHBOR_BLOCK_SIZE;
+        const auto last = std::min(end, block_begin + NEIGHBOR_BLOCK_SIZE);
+        DecodeBlock(block, begin - block_begin, last - block_begin, output);
+        output += last - begin;
+        begin = last;
+    }
+}
+
+uint64_t CompressedNeighbors::LowerBound(uint64_t begin, uint64_t end, NodeId value) const
+{
+    if (begin >= end)
+    {
+        return end;
+    }
+
+    // Blocks starting within the range are searched by their first neighbors, then a single block is decoded.
+    const auto first_block = std::begin(m_blocks) + (begin + NEIGHBOR_BLOCK_SIZE - 1) / NEIGHBOR_BLOCK_SIZE;
+    const auto last_block = std::max(first_block, std::begin(m_blocks) + (end - 1) / NEIGHBOR_BLOCK_SIZE + 1);
+    const auto next = std::upper_bound(first_block, last_block, value,
+                                       [](NodeId value, const Block &block) { return value < block.m_first; });
+    auto search_begin = begin;
+    if (next != first_block)
+    {
+        search_begin = uint64_t(next - std::begin(m_blocks) - 1) * NEIGHBOR_BLOCK_SIZE;
+    }
+    const auto search_end = std::min(end, (search_begin / NEIGHBOR_BLOCK_SIZE + 1) * NEIGHBOR_BLOCK_SIZE);
+
+    std::array<NodeId, NEIGHBOR_BLOCK_SIZE> decoded;
+    const auto count = search_end - search_begin;
+    Decode(search_begin, search_end, decoded.data());
+    return search_begin + (std::lower_bound(std::begin(decoded), std::begin(decoded) + count, value) -
+                           std::begin(decoded));
+}
+
+void CompressedNeighbors::DecodeBlock(uint64_t block, uint64_t first, uint64_t last, NodeId *output) const
+{
+    const auto &header = m_blocks[block];
+    const auto data = m_data.data() + (header.m_offset & ~raw_block);
+    if ((header.m_offset & raw_block) != 0)
+    {
+        memcpy(output, data + first * sizeof(NodeId), (last - first) * sizeof(NodeId));
+        return;
+    }
+
+    const auto count = std::min(NEIGHBOR_BLOCK_SIZE, m_size - block * NEIGHBOR_BLOCK_SIZE);
+    std::array<uint32_t, NEIGHBOR_BLOCK_SIZE> deltas;
+    decode_groups()(data, data + (count + 3) / 4, (last + 3) / 4, deltas.data());
+
+    auto value = uint64_t(header.m_first);
+    for (uint64_t i = 1; i <= first; ++i)
+    {
+        value += zigzag_decode(deltas[i]);
+    }
+    output[0] = NodeId(value);
+    for (uint64_t i = first + 1; i < last; ++i)
+    {
+        value += zigzag_decode(deltas[i]);
+        output[i - first] = NodeId(value);
+    }
+}
+
+} // namespace snark
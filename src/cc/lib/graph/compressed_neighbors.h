@@ -0,0 +1,63 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#ifndef SNARK_COMPRESSED_NEIGHBORS_H
+#define SNARK_COMPRESSED_NEIGHBORS_H
+
+#include <cstdint>
+#include <span>
+
+#include "huge_pages.h"
+#include "types.h"
+
+namespace snark
+{
+
+// Number of neighbors in a block, every block is decoded independently.
+const uint64_t NEIGHBOR_BLOCK_SIZE = 64;
+
+// Neighbor ids of a partition compressed in blocks of NEIGHBOR_BLOCK_SIZE edges. Every neighbor is stored as a
+// zigzag encoded difference from the previous neighbor in a StreamVByte layout: 2 bit byte lengths of 4 values
+// packed in a control byte, followed by 1 to 4 bytes of every value. Differences are small within sorted runs of
+// edge types, blocks with a difference that doesn't fit into 32 bits keep raw ids instead.
+// The first neighbor and data offset of every block are skip pointers for random access and searches.
+class CompressedNeighbors
+{
+  public:
+    CompressedNeighbors() = default;
+    explicit CompressedNeighbors(std::span<const NodeId> neighbors);
+
+    bool empty() const;
+    size_t size() const;
+    // Size of blocks and encoded data in bytes.
+    size_t memory_size() const;
+
+    NodeId operator[](uint64_t index) const;
+
+    // Decode neighbors in [begin, end) to output.
+    void Decode(uint64_t begin, uint64_t end, NodeId *output) const;
+
+    // Index of the first neighbor in [begin, end) not less than value or end if there is no such neighbor,
+    // neighbors in the range have to be sorted.
+    uint64_t LowerBound(uint64_t begin, uint64_t end, NodeId value) const;
+
+  private:
+    struct Block
+    {
+        NodeId m_first;
+        // Offset of encoded data, raw_block is set for blocks of raw ids.
+        uint64_t m_offset;
+    };
+    static constexpr uint64_t raw_block = uint64_t(1) << 63;
+
+    // Decode neighbors in [first, last) of a block.
+    void DecodeBlock(uint64_t block, uint64_t first, uint64_t last, NodeId *output) const;
+
+    huge_vector<Block> m_blocks;
+    huge_vector<uint8_t> m_data;
+    uint64_t m_size = 0;
+};
+
+} // namespace snark
+
+#endif // SNARK_COMPRESSED_NEIGHBORS_H
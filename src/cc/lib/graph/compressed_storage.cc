@@ -0,0 +1,239 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#include "compressed_storage.h"
+
+#include <algorithm>
+#include <cstring>
+#include <system_error>
+
+#include <glog/logging.h>
+#include <glog/raw_logging.h>
+#include <zlib.h>
+
+#include "locator.h"
+
+namespace snark
+{
+namespace
+{
+// "SNARKZBL" in little endian.
+const uint64_t compressed_data_magic = 0x4C425A4B52414E53ull;
+
+struct CompressedDataHeader
+{
+    uint64_t m_magic;
+    uint32_t m_version;
+    uint32_t m_block_size;
+    // Size of uncompressed data, the same as the size of the source data file.
+    uint64_t m_size;
+    uint64_t m_block_count;
+    // Modification time of the source data file.
+    int64_t m_source_time;
+};
+
+int64_t source_time(const std::filesystem::path &path)
+{
+    return int64_t(std::filesystem::last_write_time(path).time_since_epoch().count());
+}
+
+void write_bytes(FILE *file, const void *data, size_t size)
+{
+    if (size > 0 && fwrite(data, 1, size, file) != size)
+    {
+        RAW_LOG_FATAL("Failed to write compressed data: %s", strerror(errno));
+    }
+}
+} // namespace
+
+bool has_compressed_data(std::filesystem::path path, std::string name)
+{
+    const auto compressed_path = path / (name + ".zdata");
+    const auto data_path = path / (name + ".data");
+    std::error_code error;
+    if (!std::filesystem::is_regular_file(compressed_path, error))
+    {
+        return false;
+    }
+    if (!std::filesystem::is_regular_file(data_path, error))
+    {
+        return true;
+    }
+
+    CompressedDataHeader header = {};
+    FilePtr file(open_file(compressed_path, "rb"));
+    if (platform_pread(*file, &header, sizeof(header), 0) != sizeof(header) ||
+        header.m_magic != compressed_data_magic || header.m_version != COMPRESSED_DATA_VERSION ||
+        header.m_size != std::filesystem::file_size(data_path) || header.m_source_time != source_time(data_path))
+    {
+        RAW_LOG_WARNING("Ignoring compressed data %s: it was not written from the current %s",
+                        compressed_path.string().c_str(), data_path.filename().string().c_str());
+        return false;
+    }
+
+    return true;
+}
+
+void write_compressed_data(std::filesystem::path input, std::filesystem::path output, uint32_t block_size)
+{
+    if (block_size == 0)
+    {
+        RAW_LOG_FATAL("Block size of compressed data must be positive");
+    }
+
+    FilePtr input_file(open_file(input, "rb"));
+    CompressedDataHeader header = {};
+    header.m_magic = compressed_data_magic;
+    header.m_version = COMPRESSED_DATA_VERSION;
+    header.m_block_size = block_size;
+    header.m_size = std::filesystem::file_size(input);
+    header.m_block_count = (header.m_size + block_size - 1) / block_size;
+    header.m_source_time = source_time(input);
+
+    // Write to a temporary file first, so readers never see a partially written file.
+    auto temp_path = output;
+    temp_path += ".tmp";
+    {
+        FilePtr file(open_file(temp_path, "wb"));
+        write_bytes(*file, &header, sizeof(header));
+
+        // Block offsets are known only after compression, index is written again after the blocks.
+        std::vector<uint64_t> offsets(header.m_block_count + 1);
+        write_bytes(*file, offsets.data(), offsets.size() * sizeof(uint64_t));
+        offsets[0] = sizeof(header) + offsets.size() * sizeof(uint64_t);
+
+        std::vector<uint8_t> raw(block_size);
+        std::vector<uint8_t> compressed(compressBound(block_size));
+        for (uint64_t block = 0; block < header.m_block_count; ++block)
+        {
+            const size_t raw_size = std::min<uint64_t>(block_size, header.m_size - block * block_size);
+            if (fread(raw.data(), 1, raw_size, *input_file) != raw_size)
+            {
+                RAW_LOG_FATAL("Failed to read %s", input.string().c_str());
+            }
+
+            uLongf compressed_size = uLongf(compressed.size());
+            if (compress2(compressed.data(), &compressed_size, raw.data(), uLong(raw_size), Z_DEFAULT_COMPRESSION) !=
+                Z_OK)
+            {
+                RAW_LOG_FATAL("Failed to compress block %lu of %s", block, input.string().c_str());
+            }
+
+            // Incompressible blocks are stored as is, they are recognized by their size.
+            const bool store_raw = compressed_size >= raw_size;
+            const size_t stored_size = store_raw ? raw_size : compressed_size;
+            write_bytes(*file, store_raw ? raw.data() : compressed.data(), stored_size);
+            offsets[block + 1] = offsets[block] + stored_size;
+        }
+
+        platform_fseek(*file, sizeof(header), SEEK_SET);
+        write_bytes(*file, offsets.data(), offsets.size() * sizeof(uint64_t));
+    }
+    std::filesystem::rename(temp_path, output);
+}
+
+CompressedStorage::CompressedStorage(std::filesystem::path path, std::string suffix, open_file_ptr open_file,
+                                     size_t cache_size)
+    : m_file(std::make_shared<FilePtr>(open_file(std::move(path), std::move(suffix)))),
+      m_cache(cache_size > 0 ? std::make_shared<FeatureCache>(cache_size) : nullptr)
+{
+    CompressedDataHeader header;
+    if (platform_pread(**m_file, &header, sizeof(header), 0) != sizeof(header) ||
+        header.m_magic != compressed_data_magic)
+    {
+        RAW_LOG_FATAL("Unknown format of compressed data");
+    }
+    if (header.m_version != COMPRESSED_DATA_VERSION)
+    {
+        RAW_LOG_FATAL("Unsupported version of compressed data %u, expected %u", header.m_version,
+                      COMPRESSED_DATA_VERSION);
+    }
+
+    m_size = header.m_size;
+    m_block_size = header.m_block_size;
+    m_block_offsets.resize(header.m_block_count + 1);
+    const uint64_t size = m_block_offsets.size() * sizeof(uint64_t);
+    if (platform_pread(**m_file, m_block_offsets.data(), size, sizeof(header)) != size)
+    {
+        RAW_LOG_FATAL("Failed to read block index of compressed data");
+    }
+}
+
+size_t CompressedStorage::size()
+{
+    return m_size;
+}
+
+std::shared_ptr<FilePtr> CompressedStorage::start()
+{
+    RAW_LOG_FATAL("Sequential reads are not supported by CompressedStorage!");
+    return nullptr;
+}
+
+size_t CompressedStorage::read(void *output, size_t size, size_t count, std::shared_ptr<FilePtr> file_ptr_temp)
+{
+    RAW_LOG_FATAL("pointer read not supported by CompressedStorage!");
+    return -1;
+}
+
+std::span<uint8_t>::iterator CompressedStorage::read(uint64_t offset, uint64_t size,
+                                                     std::span<uint8_t>::iterator output_ptr,
+                                                     std::shared_ptr<FilePtr> file_ptr) const
+{
+    if (size > 0 && offset + size > m_size)
+    {
+        throw std::out_of_range("Offset out of range!");
+    }
+
+    while (size > 0)
+    {
+        const auto block = GetBlock(offset / m_block_size);
+        const auto block_offset = offset % m_block_size;
+        const auto count = std::min<uint64_t>(size, block->size() - block_offset);
+        output_ptr = std::copy_n(std::begin(*block) + block_offset, count, output_ptr);
+        offset += count;
+        size -= count;
+    }
+
+    return output_ptr;
+}
+
+FeatureCache::Value CompressedStorage::GetBlock(uint64_t index) const
+{
+    if (m_cache != nullptr)
+    {
+        if (auto block = m_cache->Get(index))
+        {
+            return block;
+        }
+    }
+
+    const size_t raw_size = std::min<uint64_t>(m_block_size, m_size - index * m_block_size);
+    const size_t stored_size = m_block_offsets[index + 1] - m_block_offsets[index];
+    auto block = std::make_shared<std::vector<uint8_t>>(raw_size);
+    if (stored_size == raw_size)
+    {
+        if (platform_pread(**m_file, block->data(), raw_size, m_block_offsets[index]) != raw_size)
+        {
+            RAW_LOG_FATAL("Failed to read block %lu of compressed data", index);
+        }
+    }
+    else
+    {
+        std::vector<uint8_t> compressed(stored_size);
+        uLongf size = uLongf(raw_size);
+        if (platform_pread(**m_file, compressed.data(), stored_size, m_block_offsets[index]) != stored_size ||
+            uncompress(block->data(), &size, compressed.data(), uLong(stored_size)) != Z_OK || size != raw_size)
+        {
+            RAW_LOG_FATAL("Failed to decompress block %lu of compressed data", index);
+        }
+    }
+
+    if (m_cache != nullptr)
+    {
+        m_cache->Put(index, block);
+    }
+    return block;
+}
+
+} // namespace snark
@@ -0,0 +1,66 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#ifndef SNARK_COMPRESSED_STORAGE_H
+#define SNARK_COMPRESSED_STORAGE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "feature_cache.h"
+#include "storage.h"
+
+namespace snark
+{
+
+// Block compressed feature data: data is split into blocks of equal size compressed independently with zlib
+// and a block index, so random reads decompress only the blocks they touch.
+// Increment the version on any layout change.
+const uint32_t COMPRESSED_DATA_VERSION = 2;
+
+// Default size of uncompressed blocks, large enough to compress well and small enough to read a single feature fast.
+const uint32_t DEFAULT_COMPRESSED_BLOCK_SIZE = 64 << 10;
+
+// Compressed files have the name of the data file with a .zdata extension, e.g. node_features_0_0.zdata.
+// Files written from another version of the data file are ignored with a warning, so reads fall back to
+// the data file. Compressed files are used as is if the data file was removed.
+bool has_compressed_data(std::filesystem::path path, std::string name);
+
+// Compress data file at input to a block compressed file at output.
+void write_compressed_data(std::filesystem::path input, std::filesystem::path output,
+                           uint32_t block_size = DEFAULT_COMPRESSED_BLOCK_SIZE);
+
+// Random access reads from a block compressed file. Only local files are supported, there is no
+// file handle for batched reads, so feature reads are served synchronously. Decompressed blocks
+// are cached within cache_size bytes, 0 disables the cache.
+struct CompressedStorage final : BaseStorage<uint8_t>
+{
+  public:
+    CompressedStorage(std::filesystem::path path, std::string suffix, open_file_ptr open_file, size_t cache_size);
+
+    // Size of uncompressed data.
+    size_t size() override;
+    std::shared_ptr<FilePtr> start() override;
+    size_t read(void *output, size_t size, size_t count, std::shared_ptr<FilePtr> file_ptr_temp) override;
+    std::span<uint8_t>::iterator read(uint64_t offset, uint64_t size, std::span<uint8_t>::iterator output_ptr,
+                                      std::shared_ptr<FilePtr> file_ptr) const override;
+
+  private:
+    FeatureCache::Value GetBlock(uint64_t index) const;
+
+    std::shared_ptr<FilePtr> m_file;
+    uint64_t m_size = 0;
+    uint32_t m_block_size = 0;
+    // Offsets of compressed blocks in the file, the last one is the file size.
+    std::vector<uint64_t> m_block_offsets;
+    // Null if caching is disabled.
+    std::shared_ptr<FeatureCache> m_cache;
+};
+
+} // namespace snark
+
+#endif // SNARK_COMPRESSED_STORAGE_H
@@ -0,0 +1,104 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#include "feature_cache.h"
+
+namespace snark
+{
+namespace
+{
+const size_t feature_cache_shards = 16;
+} // namespace
+
+FeatureCache::FeatureCache(size_t capacity) : m_shard_capacity(capacity / feature_cache_shards)
+{
+    for (size_t i = 0; i < feature_cache_shards; ++i)
+    {
+        m_shards.emplace_back(std::make_unique<Shard>());
+    }
+}
+
+FeatureCache::Shard &FeatureCache::GetShard(uint64_t key)
+{
+    // Consecutive keys are often requested together, spread them between shards.
+    return *m_shards[key % m_shards.size()];
+}
+
+FeatureCache::Value FeatureCache::Get(uint64_t key)
+{
+    auto &shard = GetShard(key);
+    std::lock_guard lock(shard.m_mutex);
+    auto it = shard.m_index.find(key);
+    if (it == std::end(shard.m_index))
+    {
+        ++shard.m_stats.m_misses;
+        return nullptr;
+    }
+
+    ++shard.m_stats.m_hits;
+    auto &entry = shard.m_entries[it->second];
+    entry.m_referenced = true;
+    return entry.m_value;
+}
+
+void FeatureCache::Put(uint64_t key, Value value)
+{
+    auto &shard = GetShard(key);
+    std::lock_guard lock(shard.m_mutex);
+    if (value->size() > m_shard_capacity || shard.m_index.contains(key))
+    {
+        return;
+    }
+
+    // Referenced blocks get a second chance, the first one without a reference is evicted.
+    while (shard.m_size + value->size() > m_shard_capacity)
+    {
+        const size_t position = shard.m_hand;
+        shard.m_hand = (shard.m_hand + 1) % shard.m_entries.size();
+        auto &entry = shard.m_entries[position];
+        if (entry.m_value == nullptr)
+        {
+            continue;
+        }
+        if (entry.m_referenced)
+        {
+            entry.m_referenced = false;
+            continue;
+        }
+
+        shard.m_size -= entry.m_value->size();
+        shard.m_index.erase(entry.m_key);
+        entry.m_value.reset();
+        shard.m_free.push_back(position);
+    }
+
+    size_t position = shard.m_entries.size();
+    if (shard.m_free.empty())
+    {
+        shard.m_entries.emplace_back();
+    }
+    else
+    {
+        position = shard.m_free.back();
+        shard.m_free.pop_back();
+    }
+
+    shard.m_size += value->size();
+    shard.m_entries[position] = Entry{key, std::move(value), false};
+    shard.m_index.emplace(key, position);
+}
+
+FeatureCache::Stats FeatureCache::GetStats() const
+{
+    Stats result;
+    for (const auto &shard : m_shards)
+    {
+        std::lock_guard lock(shard->m_mutex);
+        result.m_hits += shard->m_stats.m_hits;
+        result.m_misses += shard->m_stats.m_misses;
+    }
+
+    return result;
+}
+
+} // namespace snark
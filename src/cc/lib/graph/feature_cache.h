@@ -0,0 +1,70 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#ifndef SNARK_FEATURE_CACHE_H
+#define SNARK_FEATURE_CACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+
+namespace snark
+{
+
+// Concurrent cache of feature data blocks with a capacity in bytes. Keys are spread between shards with
+// their own locks, so concurrent readers rarely wait for each other. Shards evict blocks with CLOCK:
+// hits only set a reference bit, which is cheaper than reordering a list and keeps frequently
+// requested blocks, e.g. features of high degree nodes hit by neighbor sampling.
+class FeatureCache
+{
+  public:
+    using Value = std::shared_ptr<const std::vector<uint8_t>>;
+
+    struct Stats
+    {
+        uint64_t m_hits = 0;
+        uint64_t m_misses = 0;
+    };
+
+    explicit FeatureCache(size_t capacity);
+
+    // Return nullptr if key is not in cache. Every call is counted as a hit or a miss.
+    Value Get(uint64_t key);
+
+    // Blocks larger than capacity of a shard are not cached.
+    void Put(uint64_t key, Value value);
+
+    Stats GetStats() const;
+
+  private:
+    struct Entry
+    {
+        uint64_t m_key = 0;
+        Value m_value;
+        bool m_referenced = false;
+    };
+
+    struct Shard
+    {
+        mutable std::mutex m_mutex;
+        // Clock hand walks over entries, evicted entries are reused by new blocks.
+        std::vector<Entry> m_entries;
+        std::vector<size_t> m_free;
+        size_t m_hand = 0;
+        absl::flat_hash_map<uint64_t, size_t> m_index;
+        size_t m_size = 0;
+        Stats m_stats;
+    };
+
+    Shard &GetShard(uint64_t key);
+
+    std::vector<std::unique_ptr<Shard>> m_shards;
+    size_t m_shard_capacity;
+};
+
+} // namespace snark
+
+#endif // SNARK_FEATURE_CACHE_H
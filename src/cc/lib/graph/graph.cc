@@ -3,17 +3,22 @@
 
 #include "graph.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <filesystem>
 #include <numeric>
 #include <random>
 #include <string>
+#include <thread>
 
 #include "absl/container/flat_hash_set.h"
 #include <glog/logging.h>
 #include <glog/raw_logging.h>
 
+#include "huge_pages.h"
 #include "locator.h"
+#include "parallel.h"
 #include "types.h"
 
 namespace snark
@@ -23,6 +28,60 @@ namespace
 static const std::string neighbors_prefix = "neighbors_";
 static const size_t neighbors_prefix_len = neighbors_prefix.size();
 
+// Distance in nodes between prefetching partition entries of a node and processing it in batch loops.
+const size_t prefetch_lookahead = 8;
+
+// Copy in 32 byte blocks, fixed size copies compile to vector loads and stores.
+void copy_wide(const uint8_t *source, size_t size, uint8_t *output)
+{
+    size_t offset = 0;
+    for (; offset + 32 <= size; offset += 32)
+    {
+        std::memcpy(output + offset, source + offset, 32);
+    }
+    if (offset < size)
+    {
+        std::memcpy(output + offset, source + offset, size - offset);
+    }
+}
+
+// Copy node features located in memory to rows of output, zero padded to the requested sizes. Nodes without
+// data have zero rows, rows of nodes not gathered are left as is.
+void gather_node_features(std::span<const uint8_t *const> data, std::span<const uint64_t> sizes,
+                          const std::vector<bool> &gathered, std::span<const FeatureMeta> features,
+                          std::span<uint8_t> output)
+{
+    const size_t feature_size = output.size() / gathered.size();
+    for (size_t node_index = 0; node_index < gathered.size(); ++node_index)
+    {
+        if (node_index + prefetch_lookahead < gathered.size())
+        {
+            for (size_t feature = 0; feature < features.size(); ++feature)
+            {
+                if (const auto source = data[(node_index + prefetch_lookahead) * features.size() + feature])
+                {
+                    prefetch(source);
+                }
+            }
+        }
+        if (!gathered[node_index])
+        {
+            continue;
+        }
+
+        auto out = output.data() + node_index * feature_size;
+        for (size_t feature = 0; feature < features.size(); ++feature)
+        {
+            const size_t position = node_index * features.size() + feature;
+            const size_t size = features[feature].second;
+            const size_t copied = std::min<size_t>(sizes[position], size);
+            copy_wide(data[position], copied, out);
+            std::fill_n(out + copied, size - copied, 0);
+            out += size;
+        }
+    }
+}
+
 bool check_sorted_unique_types(const Type *in_edge_types, size_t count)
 {
     for (size_t i = 1; i < count; ++i)
@@ -39,8 +98,11 @@ bool check_sorted_unique_types(const Type *in_edge_types, size_t count)
 } // namespace
 
 Graph::Graph(Metadata metadata, std::vector<std::string> paths, std::vector<uint32_t> partitions,
-             PartitionStorageType storage_type)
-    : m_metadata(std::move(metadata))
+             PartitionStorageType storage_type, GraphOptions options)
+    : m_metadata(std::move(metadata)),
+      m_reader(storage_type == PartitionStorageType::disk || storage_type == PartitionStorageType::hybrid
+                   ? AsyncReader::Backend::io_uring
+                   : AsyncReader::Backend::threads)
 {
     if (paths.size() != partitions.size())
     {
@@ -48,6 +110,11 @@ Graph::Graph(Metadata metadata, std::vector<std::string> paths, std::vector<uint
                       partitions.size());
     }
 
+    // Arrays are allocated with huge pages while partitions and node map are loaded.
+    HugePageScope huge_page_scope(options.m_huge_pages);
+
+    // Path and suffix of every partition in loading order.
+    std::vector<std::pair<std::filesystem::path, std::string>> partition_files;
     for (size_t partition_index = 0; partition_index < paths.size(); ++partition_index)
     {
         std::vector<std::string> suffixes;
@@ -90,10 +157,54 @@ Graph::Graph(Metadata metadata, std::vector<std::string> paths, std::vector<uint
 
         // Fix loading order to obtain deterministic results for sampling.
         std::sort(std::begin(suffixes), std::end(suffixes));
-        for (size_t i = 0; i < suffixes.size(); ++i)
+        for (auto &suffix : suffixes)
         {
-            m_partitions.emplace_back(m_metadata, paths[partition_index], suffixes[i], storage_type);
-            ReadNodeMap(paths[partition_index], suffixes[i], partition_index);
+            partition_files.emplace_back(paths[partition_index], std::move(suffix));
+        }
+    }
+
+    // Partitions are independent, load them in parallel.
+    m_partitions.resize(partition_files.size());
+    const size_t partition_count = std::max<size_t>(partition_files.size(), 1);
+    auto partition_options = options;
+    partition_options.m_feature_cache_size /= partition_count;
+    partition_options.m_block_cache_size /= partition_count;
+    partition_options.m_pinned_features_size /= partition_count;
+    // Partitions build their sampling tables in parallel too, share hardware threads to avoid oversubscription.
+    const size_t partition_threads = std::max<size_t>(std::thread::hardware_concurrency() / partition_count, 1);
+    parallel_for(partition_files.size(), [&](size_t index) {
+        m_partitions[index] = Partition(m_metadata, partition_files[index].first, partition_files[index].second,
+                                        storage_type, partition_options, partition_threads);
+    });
+    if (options.m_compact_neighbor_ids)
+    {
+        const auto neighbor_ids = Partition::NeighborIdTable(m_partitions);
+        parallel_for(m_partitions.size(), [&](size_t index) { m_partitions[index].CompactNeighborIds(neighbor_ids); });
+    }
+    m_node_map = NodeMap(partition_files, m_metadata.m_config_path);
+    log_huge_page_stats();
+}
+
+void Graph::PrefetchNode(std::span<const uint64_t> indices, size_t position) const
+{
+    if (position + prefetch_lookahead < indices.size())
+    {
+        const auto index = indices[position + prefetch_lookahead];
+        if (index != NodeMap::npos)
+        {
+            m_partitions[m_node_map.PartitionIndex(index)].PrefetchNode(m_node_map.InternalId(index));
+        }
+    }
+}
+
+void Graph::PrefetchNeighbors(std::span<const uint64_t> indices, size_t position) const
+{
+    if (position + prefetch_lookahead < indices.size())
+    {
+        const auto index = indices[position + prefetch_lookahead];
+        if (index != NodeMap::npos)
+        {
+            m_partitions[m_node_map.PartitionIndex(index)].PrefetchNeighbors(m_node_map.InternalId(index));
         }
     }
 }
@@ -102,20 +213,22 @@ void Graph::GetNodeType(std::span<const NodeId> node_ids, std::span<Type> output
 {
     assert(output.size() == node_ids.size());
     auto curr_type = std::begin(output);
-    for (auto node : node_ids)
+    std::vector<uint64_t> indices(node_ids.size());
+    m_node_map.Find(node_ids, indices);
+    for (size_t node_index = 0; node_index < indices.size(); ++node_index)
     {
-        auto internal_id = m_node_map.find(node);
-        if (internal_id == std::end(m_node_map))
+        PrefetchNode(indices, node_index);
+        auto index = indices[node_index];
+        if (index == NodeMap::npos)
         {
             *curr_type = default_type;
         }
         else
         {
-            auto index = internal_id->second;
-            size_t partition_count = m_counts[index];
+            size_t partition_count = m_node_map.Count(index);
             for (size_t partition = 0; partition < partition_count; ++partition, ++index)
             {
-                *curr_type = m_partitions[m_partitions_indices[index]].GetNodeType(m_internal_indices[index]);
+                *curr_type = m_partitions[m_node_map.PartitionIndex(index)].GetNodeType(m_node_map.InternalId(index));
                 if (*curr_type != snark::PLACEHOLDER_NODE_TYPE)
                     break;
             }
@@ -133,31 +246,98 @@ void Graph::GetNodeFeature(std::span<const NodeId> node_ids, std::span<snark::Fe
            output.size());
 
     const size_t feature_size = output.size() / node_ids.size();
-    size_t feature_offset = 0;
-    for (auto node : node_ids)
+    std::vector<uint64_t> indices(node_ids.size());
+    m_node_map.Find(node_ids, indices);
+
+    // Features kept in columns and dense tensors are located first and gathered for the whole batch, other
+    // nodes are read one by one. Reads from disk partitions are collected and submitted together.
+    std::vector<const uint8_t *> data(indices.size() * features.size());
+    std::vector<uint64_t> sizes(data.size());
+    std::vector<bool> gathered(indices.size(), true);
+    std::vector<ReadRequest> requests;
+    std::vector<PendingNodeFeature> pending;
+    for (size_t node_index = 0; node_index < indices.size(); ++node_index)
     {
-        auto internal_id = m_node_map.find(node);
-        if (internal_id == std::end(m_node_map))
+        PrefetchNode(indices, node_index);
+        auto index = indices[node_index];
+        if (index == NodeMap::npos)
         {
-            std::fill_n(std::begin(output) + feature_offset, feature_size, 0);
+            continue;
         }
-        else
+
+        size_t partition_count = m_node_map.Count(index);
+        for (size_t partition = 0; partition < partition_count; ++partition, ++index)
         {
-            auto output_span = output.subspan(feature_offset, feature_size);
+            const auto &graph_partition = m_partitions[m_node_map.PartitionIndex(index)];
+            const auto internal_id = m_node_map.InternalId(index);
+            if (!graph_partition.HasNodeFeatures(internal_id))
+            {
+                continue;
+            }
 
-            auto index = internal_id->second;
-            size_t partition_count = m_counts[index];
-            bool found = false;
-            for (size_t partition = 0; partition < partition_count && !found; ++partition, ++index)
+            if (!graph_partition.GetNodeFeatureData(
+                    internal_id, features, std::span(data).subspan(node_index * features.size(), features.size()),
+                    std::span(sizes).subspan(node_index * features.size(), features.size())))
             {
-                found = m_partitions[m_partitions_indices[index]].GetNodeFeature(m_internal_indices[index], features,
-                                                                                 output_span);
+                gathered[node_index] = false;
+                graph_partition.GetNodeFeature(internal_id, features,
+                                               output.subspan(node_index * feature_size, feature_size), &requests,
+                                               &pending);
             }
+            break;
         }
-        feature_offset += feature_size;
+    }
+
+    gather_node_features(data, sizes, gathered, features, output);
+    m_reader.Read(requests);
+    for (const auto &node : pending)
+    {
+        node.m_partition->FinishNodeFeature(node);
     }
 }
 
+bool Graph::GetNodeFeatureViews(std::span<const NodeId> node_ids, std::span<const snark::FeatureId> features,
+                                std::span<std::span<const uint8_t>> output) const
+{
+    assert(node_ids.size() * features.size() == output.size());
+
+    std::fill(std::begin(output), std::end(output), std::span<const uint8_t>());
+    std::vector<uint64_t> indices(node_ids.size());
+    m_node_map.Find(node_ids, indices);
+    for (size_t node_index = 0; node_index < indices.size(); ++node_index)
+    {
+        PrefetchNode(indices, node_index);
+        auto index = indices[node_index];
+        if (index == NodeMap::npos)
+        {
+            continue;
+        }
+
+        size_t partition_count = m_node_map.Count(index);
+        for (size_t partition = 0; partition < partition_count; ++partition, ++index)
+        {
+            const auto &graph_partition = m_partitions[m_node_map.PartitionIndex(index)];
+            const auto internal_id = m_node_map.InternalId(index);
+            if (!graph_partition.HasNodeFeatures(internal_id))
+            {
+                continue;
+            }
+
+            for (size_t feature = 0; feature < features.size(); ++feature)
+            {
+                if (!graph_partition.GetNodeFeatureView(internal_id, features[feature],
+                                                        output[node_index * features.size() + feature]))
+                {
+                    return false;
+                }
+            }
+            break;
+        }
+    }
+
+    return true;
+}
+
 void Graph::GetNodeSparseFeature(std::span<const NodeId> node_ids, std::span<const snark::FeatureId> features,
                                  std::span<int64_t> out_dimensions, std::vector<std::vector<int64_t>> &out_indices,
                                  std::vector<std::vector<uint8_t>> &out_data) const
@@ -169,21 +349,22 @@ void Graph::GetNodeSparseFeature(std::span<const NodeId> node_ids, std::span<con
     // Fill out_dimensions in case nodes don't have some features.
     std::fill(std::begin(out_dimensions), std::end(out_dimensions), 0);
     const int64_t len = node_ids.size();
+    std::vector<uint64_t> indices(node_ids.size());
+    m_node_map.Find(node_ids, indices);
     for (int64_t node_index = 0; node_index < len; ++node_index)
     {
-        auto internal_id = m_node_map.find(node_ids[node_index]);
-        if (internal_id == std::end(m_node_map))
+        auto index = indices[node_index];
+        if (index == NodeMap::npos)
         {
             continue;
         }
 
-        auto index = internal_id->second;
-        size_t partition_count = m_counts[index];
+        size_t partition_count = m_node_map.Count(index);
         bool found = false;
         for (size_t partition = 0; partition < partition_count && !found; ++partition, ++index)
         {
-            found = m_partitions[m_partitions_indices[index]].GetNodeSparseFeature(
-                m_internal_indices[index], features, node_index, out_dimensions, out_indices, out_data);
+            found = m_partitions[m_node_map.PartitionIndex(index)].GetNodeSparseFeature(
+                m_node_map.InternalId(index), features, node_index, out_dimensions, out_indices, out_data);
         }
     }
 }
@@ -195,23 +376,24 @@ void Graph::GetNodeStringFeature(std::span<const NodeId> node_ids, std::span<con
     assert(out_dimensions.size() == features_size * node_ids.size());
 
     const int64_t len = node_ids.size();
+    std::vector<uint64_t> indices(node_ids.size());
+    m_node_map.Find(node_ids, indices);
     for (int64_t node_index = 0; node_index < len; ++node_index)
     {
-        auto internal_id = m_node_map.find(node_ids[node_index]);
-        if (internal_id == std::end(m_node_map))
+        auto index = indices[node_index];
+        if (index == NodeMap::npos)
         {
             continue;
         }
 
         auto dims_span = out_dimensions.subspan(features_size * node_index, features_size);
 
-        auto index = internal_id->second;
-        size_t partition_count = m_counts[index];
+        size_t partition_count = m_node_map.Count(index);
         bool found = false;
         for (size_t partition = 0; partition < partition_count && !found; ++partition, ++index)
         {
-            found = m_partitions[m_partitions_indices[index]].GetNodeStringFeature(m_internal_indices[index], features,
-                                                                                   dims_span, out_data);
+            found = m_partitions[m_node_map.PartitionIndex(index)].GetNodeStringFeature(
+                m_node_map.InternalId(index), features, dims_span, out_data);
         }
     }
 }
@@ -228,21 +410,21 @@ void Graph::GetEdgeFeature(std::span<const NodeId> input_edge_src, std::span<con
     const size_t feature_size = output.size() / input_edge_src.size();
     size_t feature_offset = 0;
     size_t edge_offset = 0;
-    for (auto src_node : input_edge_src)
+    std::vector<uint64_t> indices(input_edge_src.size());
+    m_node_map.Find(input_edge_src, indices);
+    for (auto index : indices)
     {
-        auto internal_id = m_node_map.find(src_node);
-        if (internal_id == std::end(m_node_map))
+        if (index == NodeMap::npos)
         {
             std::fill_n(std::begin(output) + feature_offset, feature_size, 0);
         }
         else
         {
-            auto index = internal_id->second;
-            size_t partition_count = m_counts[index];
+            size_t partition_count = m_node_map.Count(index);
             for (size_t partition = 0; partition < partition_count; ++partition, ++index)
             {
-                auto found = m_partitions[m_partitions_indices[index]].GetEdgeFeature(
-                    m_internal_indices[index], input_edge_dst[edge_offset], input_edge_type[edge_offset], features,
+                auto found = m_partitions[m_node_map.PartitionIndex(index)].GetEdgeFeature(
+                    m_node_map.InternalId(index), input_edge_dst[edge_offset], input_edge_type[edge_offset], features,
                     output.subspan(feature_offset, feature_size));
                 if (found)
                 {
@@ -266,17 +448,17 @@ void Graph::GetEdgeSparseFeature(std::span<const NodeId> input_edge_src, std::sp
     assert(features.size() == out_values.size());
 
     int64_t edge_offset = 0;
-    for (auto src_node : input_edge_src)
+    std::vector<uint64_t> indices(input_edge_src.size());
+    m_node_map.Find(input_edge_src, indices);
+    for (auto index : indices)
     {
-        auto internal_id = m_node_map.find(src_node);
-        if (internal_id != std::end(m_node_map))
+        if (index != NodeMap::npos)
         {
-            auto index = internal_id->second;
-            size_t partition_count = m_counts[index];
+            size_t partition_count = m_node_map.Count(index);
             for (size_t partition = 0; partition < partition_count; ++partition, ++index)
             {
-                auto found = m_partitions[m_partitions_indices[index]].GetEdgeSparseFeature(
-                    m_internal_indices[index], input_edge_dst[edge_offset], input_edge_type[edge_offset], features,
+                auto found = m_partitions[m_node_map.PartitionIndex(index)].GetEdgeSparseFeature(
+                    m_node_map.InternalId(index), input_edge_dst[edge_offset], input_edge_type[edge_offset], features,
                     edge_offset, out_dimensions, out_indices, out_values);
                 if (found)
                 {
@@ -297,17 +479,17 @@ void Graph::GetEdgeStringFeature(std::span<const NodeId> input_edge_src, std::sp
     assert(features_size * input_edge_src.size() == out_dimensions.size());
 
     int64_t edge_offset = 0;
-    for (auto src_node : input_edge_src)
+    std::vector<uint64_t> indices(input_edge_src.size());
+    m_node_map.Find(input_edge_src, indices);
+    for (auto index : indices)
     {
-        auto internal_id = m_node_map.find(src_node);
-        if (internal_id != std::end(m_node_map))
+        if (index != NodeMap::npos)
         {
-            auto index = internal_id->second;
-            size_t partition_count = m_counts[index];
+            size_t partition_count = m_node_map.Count(index);
             for (size_t partition = 0; partition < partition_count; ++partition, ++index)
             {
-                auto found = m_partitions[m_partitions_indices[index]].GetEdgeStringFeature(
-                    m_internal_indices[index], input_edge_dst[edge_offset], input_edge_type[edge_offset], features,
+                auto found = m_partitions[m_node_map.PartitionIndex(index)].GetEdgeStringFeature(
+                    m_node_map.InternalId(index), input_edge_dst[edge_offset], input_edge_type[edge_offset], features,
                     out_dimensions.subspan(edge_offset * features_size, features_size), out_values);
                 if (found)
                 {
@@ -327,23 +509,25 @@ void Graph::NeighborCount(std::span<const NodeId> input_node_ids, std::span<cons
     size_t num_nodes = input_node_ids.size();
     std::fill_n(std::begin(output_neighbors_counts), num_nodes, 0);
 
+    std::vector<uint64_t> indices(input_node_ids.size());
+    m_node_map.Find(input_node_ids, indices);
     for (size_t idx = 0; idx < num_nodes; ++idx)
     {
-        auto internal_id = m_node_map.find(input_node_ids[idx]);
+        PrefetchNeighbors(indices, idx);
+        auto index = indices[idx];
 
-        if (internal_id == std::end(m_node_map))
+        if (index == NodeMap::npos)
         {
             continue;
         }
         else
         {
-            auto index = internal_id->second;
-            size_t partition_count = m_counts[index];
+            size_t partition_count = m_node_map.Count(index);
 
             for (size_t partition = 0; partition < partition_count; ++partition, ++index)
             {
-                output_neighbors_counts[idx] += m_partitions[m_partitions_indices[index]].NeighborCount(
-                    m_internal_indices[index], input_edge_types);
+                output_neighbors_counts[idx] += m_partitions[m_node_map.PartitionIndex(index)].NeighborCount(
+                    m_node_map.InternalId(index), input_edge_types);
             }
         }
     }
@@ -354,21 +538,23 @@ void Graph::FullNeighbor(std::span<const NodeId> input_node_ids, std::span<const
                          std::vector<float> &output_neighbors_weights,
                          std::span<uint64_t> output_neighbors_counts) const
 {
+    std::vector<uint64_t> indices(input_node_ids.size());
+    m_node_map.Find(input_node_ids, indices);
     for (size_t node_index = 0; node_index < input_node_ids.size(); ++node_index)
     {
-        auto internal_id = m_node_map.find(input_node_ids[node_index]);
-        if (internal_id == std::end(m_node_map))
+        PrefetchNeighbors(indices, node_index);
+        auto index = indices[node_index];
+        if (index == NodeMap::npos)
         {
             continue;
         }
         else
         {
-            auto index = internal_id->second;
-            size_t partition_count = m_counts[index];
+            size_t partition_count = m_node_map.Count(index);
             for (size_t partition = 0; partition < partition_count; ++partition, ++index)
             {
-                output_neighbors_counts[node_index] += m_partitions[m_partitions_indices[index]].FullNeighbor(
-                    m_internal_indices[index], input_edge_types, output_neighbor_ids, output_neighbor_types,
+                output_neighbors_counts[node_index] += m_partitions[m_node_map.PartitionIndex(index)].FullNeighbor(
+                    m_node_map.InternalId(index), input_edge_types, output_neighbor_ids, output_neighbor_types,
                     output_neighbors_weights);
             }
         }
@@ -387,10 +573,13 @@ void Graph::SampleNeighbor(int64_t seed, std::span<const NodeId> input_node_ids,
         input_edge_types = input_edge_types.subspan(0, last - std::begin(input_edge_types));
     }
 
+    std::vector<uint64_t> indices(input_node_ids.size());
+    m_node_map.Find(input_node_ids, indices);
     for (size_t node_index = 0; node_index < input_node_ids.size(); ++node_index)
     {
-        auto internal_id = m_node_map.find(input_node_ids[node_index]);
-        if (internal_id == std::end(m_node_map))
+        PrefetchNeighbors(indices, node_index);
+        auto index = indices[node_index];
+        if (index == NodeMap::npos)
         {
             std::fill_n(std::begin(output_neighbor_ids) + count * node_index, count, default_node_id);
             std::fill_n(std::begin(output_neighbor_types) + count * node_index, count, default_edge_type);
@@ -398,12 +587,11 @@ void Graph::SampleNeighbor(int64_t seed, std::span<const NodeId> input_node_ids,
         }
         else
         {
-            const auto index = internal_id->second;
-            size_t partition_count = m_counts[index];
+            size_t partition_count = m_node_map.Count(index);
             for (size_t partition = 0; partition < partition_count; ++partition)
             {
-                m_partitions[m_partitions_indices[index + partition]].SampleNeighbor(
-                    seed++, m_internal_indices[index + partition], input_edge_types, count,
+                m_partitions[m_node_map.PartitionIndex(index + partition)].SampleNeighbor(
+                    seed++, m_node_map.InternalId(index + partition), input_edge_types, count,
                     output_neighbor_ids.subspan(count * node_index, count),
                     output_neighbor_types.subspan(count * node_index, count),
                     neighbors_weights.subspan(count * node_index, count), neighbors_total_weights[node_index],
@@ -425,21 +613,23 @@ void Graph::UniformSampleNeighbor(bool without_replacement, int64_t seed, std::s
         input_edge_types = input_edge_types.subspan(0, last - std::begin(input_edge_types));
     }
 
+    std::vector<uint64_t> indices(input_node_ids.size());
+    m_node_map.Find(input_node_ids, indices);
     for (size_t node_index = 0; node_index < input_node_ids.size(); ++node_index)
     {
-        auto internal_id = m_node_map.find(input_node_ids[node_index]);
-        if (internal_id == std::end(m_node_map))
+        PrefetchNeighbors(indices, node_index);
+        auto index = indices[node_index];
+        if (index == NodeMap::npos)
         {
             std::fill_n(std::begin(output_neighbor_ids) + count * node_index, count, default_node_id);
             std::fill_n(std::begin(output_neighbor_types) + count * node_index, count, default_edge_type);
         }
         else
         {
-            const auto index = internal_id->second;
-            for (size_t partition = 0; partition < m_counts[index]; ++partition)
+            for (size_t partition = 0; partition < m_node_map.Count(index); ++partition)
             {
-                m_partitions[m_partitions_indices[index + partition]].UniformSampleNeighbor(
-                    without_replacement, seed++, m_internal_indices[index + partition], input_edge_types, count,
+                m_partitions[m_node_map.PartitionIndex(index + partition)].UniformSampleNeighbor(
+                    without_replacement, seed++, m_node_map.InternalId(index + partition), input_edge_types, count,
                     output_neighbor_ids.subspan(count * node_index, count),
                     output_neighbor_types.subspan(count * node_index, count), neighbors_total_count[node_index],
                     default_node_id, default_edge_type);
@@ -453,62 +643,17 @@ Metadata Graph::GetMetadata() const
     return m_metadata;
 }
 
-void Graph::ReadNodeMap(std::filesystem::path path, std::string suffix, uint32_t index)
+FeatureCache::Stats Graph::GetFeatureCacheStats() const
 {
-    std::shared_ptr<BaseStorage<uint8_t>> node_map;
-    if (!is_hdfs_path(path))
+    FeatureCache::Stats result;
+    for (const auto &partition : m_partitions)
     {
-        node_map = std::make_shared<DiskStorage<uint8_t>>(std::move(path), std::move(suffix), open_node_map);
+        const auto stats = partition.GetFeatureCacheStats();
+        result.m_hits += stats.m_hits;
+        result.m_misses += stats.m_misses;
     }
-    else
-    {
-        auto full_path = path / ("node_" + suffix + ".map");
-        node_map = std::make_shared<HDFSStreamStorage<uint8_t>>(full_path.c_str(), m_metadata.m_config_path);
-    }
-    auto node_map_ptr = node_map->start();
-    size_t size = node_map->size() / 20; // 20 = 8(node_id) + 8(internal_id) + 4(node_type)
-    m_node_map.reserve(size);
-    m_partitions_indices.reserve(size);
-    m_internal_indices.reserve(size);
-    m_counts.reserve(size);
-    for (size_t i = 0; i < size; ++i)
-    {
-        uint64_t pair[2];
-        if (node_map->read(pair, 8, 2, node_map_ptr) != 2)
-        {
-            RAW_LOG_FATAL("Failed to read pair in a node maping");
-        }
 
-        auto el = m_node_map.find(pair[0]);
-        if (el == std::end(m_node_map))
-        {
-            m_node_map[pair[0]] = m_internal_indices.size();
-            m_internal_indices.emplace_back(pair[1]);
-            m_partitions_indices.emplace_back(index);
-            m_counts.emplace_back(1);
-        }
-        else
-        {
-            auto old_offset = el->second;
-            auto old_count = m_counts[old_offset];
-            m_node_map[pair[0]] = m_internal_indices.size();
-
-            std::copy_n(std::begin(m_internal_indices) + old_offset, old_count, std::back_inserter(m_internal_indices));
-            m_internal_indices.emplace_back(pair[1]);
-            std::copy_n(std::begin(m_partitions_indices) + old_offset, old_count,
-                        std::back_inserter(m_partitions_indices));
-            m_partitions_indices.emplace_back(index);
-
-            std::fill_n(std::back_inserter(m_counts), old_count + 1, old_count + 1);
-        }
-
-        assert(pair[1] == i);
-        Type node_type;
-        if (node_map->read(&node_type, sizeof(Type), 1, node_map_ptr) != 1)
-        {
-            RAW_LOG_FATAL("Failed to read node type in a node maping");
-        }
-    }
+    return result;
 }
 
 } // namespace snark
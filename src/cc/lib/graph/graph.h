@@ -11,8 +11,8 @@
 #include <utility>
 #include <vector>
 
-#include "absl/container/flat_hash_map.h"
-
+#include "async_reader.h"
+#include "node_map.h"
 #include "partition.h"
 #include "sampler.h"
 #include "types.h"
@@ -23,14 +23,23 @@ namespace snark
 class Graph
 {
   public:
+    // Options enable caches and alternative layouts of partitions, see GraphOptions. numa is ignored, it is
+    // only supported by graph engine servers.
     Graph(snark::Metadata metadata, std::vector<std::string> paths, std::vector<uint32_t> partitions,
-          PartitionStorageType storage_type);
+          PartitionStorageType storage_type, GraphOptions options = {});
 
     void GetNodeType(std::span<const NodeId> node_ids, std::span<Type> output, Type default_type) const;
 
     void GetNodeFeature(std::span<const NodeId> node_ids, std::span<snark::FeatureMeta> features,
                         std::span<uint8_t> output) const;
 
+    // Stored bytes of node features without copying them, valid while the graph is alive. Output has a view per
+    // node and feature ordered by nodes first, views of missing nodes and features are empty. Return false if
+    // some feature is not stored in memory or memory mapped storage or has to be decoded, GetNodeFeature and
+    // GetNodeStringFeature copy such features.
+    bool GetNodeFeatureViews(std::span<const NodeId> node_ids, std::span<const snark::FeatureId> features,
+                             std::span<std::span<const uint8_t>> output) const;
+
     void GetNodeSparseFeature(std::span<const NodeId> node_ids, std::span<const snark::FeatureId> features,
                               std::span<int64_t> out_dimensions, std::vector<std::vector<int64_t>> &out_indices,
                               std::vector<std::vector<uint8_t>> &out_data) const;
@@ -70,15 +79,19 @@ class Graph
 
     Metadata GetMetadata() const;
 
+    // Hits and misses of feature caches of all partitions.
+    FeatureCache::Stats GetFeatureCacheStats() const;
+
   private:
-    void ReadNodeMap(std::filesystem::path path, std::string suffix, uint32_t index);
+    // Prefetch partition entries of the node lookahead positions after position in a batch,
+    // so they are in cache by the time the loop reaches it.
+    void PrefetchNode(std::span<const uint64_t> indices, size_t position) const;
+    void PrefetchNeighbors(std::span<const uint64_t> indices, size_t position) const;
 
     std::vector<Partition> m_partitions;
-    absl::flat_hash_map<NodeId, uint64_t> m_node_map;
-    std::vector<uint32_t> m_partitions_indices;
-    std::vector<uint64_t> m_internal_indices;
-    std::vector<uint32_t> m_counts;
+    NodeMap m_node_map;
     Metadata m_metadata;
+    AsyncReader m_reader;
 };
 
 } // namespace snark
@@ -258,7 +258,7 @@ std::vector<std::string> hdfs_list_directory(std::string full_path, std::string
     return connection.list_directory(data_path);
 }
 
-template <typename T> std::vector<T> read_hdfs(std::string full_path, std::string config_path)
+template <typename T> snark::huge_vector<T> read_hdfs(std::string full_path, std::string config_path)
 {
     std::string data_path_str;
     std::string host_str;
@@ -269,7 +269,7 @@ template <typename T> std::vector<T> read_hdfs(std::string full_path, std::strin
 
     auto connection = HDFSConnection(full_path, config_path);
     auto read_size = connection.get_file_size(data_path, host, port);
-    std::vector<T> output(read_size / sizeof(T));
+    snark::huge_vector<T> output(read_size / sizeof(T));
     auto file = connection.open_file(data_path);
     connection.read(file, read_size, static_cast<void *>(output.data()));
     connection.close_file(file);
@@ -323,10 +323,10 @@ std::vector<std::string> hdfs_list_directory(std::string full_path, std::string
     return std::vector<std::string>();
 }
 
-template <typename T> std::vector<T> read_hdfs(std::string full_path, std::string config_path)
+template <typename T> snark::huge_vector<T> read_hdfs(std::string full_path, std::string config_path)
 {
     RAW_LOG_FATAL("HDFS only supported for linux!");
-    return std::vector<T>();
+    return snark::huge_vector<T>();
 }
 
 #endif
@@ -337,8 +337,8 @@ bool is_hdfs_path(std::filesystem::path path)
            path.string().find("file:///") == 0;
 }
 
-template std::vector<uint8_t> read_hdfs(std::string full_path, std::string config_path);
-template std::vector<uint16_t> read_hdfs(std::string full_path, std::string config_path);
-template std::vector<uint32_t> read_hdfs(std::string full_path, std::string config_path);
-template std::vector<uint64_t> read_hdfs(std::string full_path, std::string config_path);
-template std::vector<char> read_hdfs(std::string full_path, std::string config_path);
+template snark::huge_vector<uint8_t> read_hdfs(std::string full_path, std::string config_path);
+template snark::huge_vector<uint16_t> read_hdfs(std::string full_path, std::string config_path);
+template snark::huge_vector<uint32_t> read_hdfs(std::string full_path, std::string config_path);
+template snark::huge_vector<uint64_t> read_hdfs(std::string full_path, std::string config_path);
+template snark::huge_vector<char> read_hdfs(std::string full_path, std::string config_path);
@@ -7,6 +7,8 @@
 #include <filesystem>
 #include <vector>
 
+#include "huge_pages.h"
+
 typedef int32_t hdfs_int;
 
 struct hdfs_internal_so;
@@ -73,7 +75,8 @@ void parse_hdfs_path(std::string full_path, std::string &data_path, std::string
 
 std::vector<std::string> hdfs_list_directory(std::string full_path, std::string config_path);
 
-template <typename T> std::vector<T> read_hdfs(std::string full_path, std::string config_path);
+// Read a whole file into memory backed by huge pages when they are enabled.
+template <typename T> snark::huge_vector<T> read_hdfs(std::string full_path, std::string config_path);
 
 bool is_hdfs_path(std::filesystem::path path);
 
@@ -0,0 +1,196 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#include "huge_pages.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+#ifdef SNARK_PLATFORM_LINUX
+#include <sys/mman.h>
+#endif
+
+#include "absl/container/flat_hash_map.h"
+#include <glog/logging.h>
+#include <glog/raw_logging.h>
+
+namespace snark
+{
+namespace
+{
+struct Allocation
+{
+    size_t m_size;
+    bool m_explicit;
+};
+
+thread_local bool huge_pages_thread_enabled = false;
+std::mutex allocations_mutex;
+absl::flat_hash_map<uintptr_t, Allocation> allocations;
+
+#ifdef SNARK_PLATFORM_LINUX
+// Map size bytes aligned to huge_page_size, size must be a multiple of huge_page_size.
+void *map_aligned(size_t size)
+{
+    // Map extra space and cut the unaligned head and the tail off.
+    const size_t mapped_size = size + huge_page_size;
+    auto address = ::mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (address == MAP_FAILED)
+    {
+        return nullptr;
+    }
+
+    const auto begin = reinterpret_cast<uintptr_t>(address);
+    const auto aligned = (begin + huge_page_size - 1) & ~(uintptr_t(huge_page_size) - 1);
+    if (aligned > begin)
+    {
+        ::munmap(address, aligned - begin);
+    }
+    if (begin + mapped_size > aligned + size)
+    {
+        ::munmap(reinterpret_cast<void *>(aligned + size), begin + mapped_size - aligned - size);
+    }
+    return reinterpret_cast<void *>(aligned);
+}
+#endif
+} // namespace
+
+HugePageScope::HugePageScope(bool enabled) : m_previous(huge_pages_thread_enabled)
+{
+    huge_pages_thread_enabled = enabled;
+}
+
+HugePageScope::~HugePageScope()
+{
+    huge_pages_thread_enabled = m_previous;
+}
+
+bool huge_pages_enabled()
+{
+    return huge_pages_thread_enabled;
+}
+
+void *allocate_huge_pages(size_t size)
+{
+#ifdef SNARK_PLATFORM_LINUX
+    if (!huge_pages_thread_enabled || size < huge_page_size)
+    {
+        return nullptr;
+    }
+
+    const size_t rounded = (size + huge_page_size - 1) / huge_page_size * huge_page_size;
+    Allocation allocation{rounded, true};
+    auto address =
+        ::mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (address == MAP_FAILED)
+    {
+        // Pages are not touched yet, so faults will allocate huge pages if the kernel has them.
+        allocation.m_explicit = false;
+        address = map_aligned(rounded);
+        if (address == nullptr)
+        {
+            return nullptr;
+        }
+        if (::madvise(address, rounded, MADV_HUGEPAGE) != 0)
+        {
+            RAW_LOG_WARNING("Transparent huge pages are not available: %s", strerror(errno));
+        }
+    }
+
+    std::lock_guard lock(allocations_mutex);
+    allocations.emplace(reinterpret_cast<uintptr_t>(address), allocation);
+    return address;
+#else
+    return nullptr;
+#endif
+}
+
+bool deallocate_huge_pages(void *address, size_t size)
+{
+#ifdef SNARK_PLATFORM_LINUX
+    if (size < huge_page_size)
+    {
+        return false;
+    }
+
+    {
+        std::lock_guard lock(allocations_mutex);
+        auto it = allocations.find(reinterpret_cast<uintptr_t>(address));
+        if (it == std::end(allocations))
+        {
+            return false;
+        }
+        size = it->second.m_size;
+        allocations.erase(it);
+    }
+    ::munmap(address, size);
+    return true;
+#else
+    return false;
+#endif
+}
+
+HugePageStats huge_page_stats()
+{
+    HugePageStats stats;
+    std::vector<std::pair<uintptr_t, uintptr_t>> transparent;
+    {
+        std::lock_guard lock(allocations_mutex);
+        for (const auto &[address, allocation] : allocations)
+        {
+            stats.m_allocated += allocation.m_size;
+            if (allocation.m_explicit)
+            {
+                stats.m_explicit += allocation.m_size;
+            }
+            else
+            {
+                transparent.emplace_back(address, address + allocation.m_size);
+            }
+        }
+    }
+
+#ifdef SNARK_PLATFORM_LINUX
+    // Sum huge pages of mappings overlapping allocations, adjacent allocations can be merged into one mapping.
+    std::ifstream smaps("/proc/self/smaps");
+    std::string line;
+    bool overlaps = false;
+    while (std::getline(smaps, line))
+    {
+        unsigned long begin = 0;
+        unsigned long end = 0;
+        unsigned long kb = 0;
+        if (sscanf(line.c_str(), "%lx-%lx ", &begin, &end) == 2 && line.find(':') > line.find(' '))
+        {
+            overlaps = false;
+            for (const auto &[first, last] : transparent)
+            {
+                overlaps |= begin < last && first < end;
+            }
+        }
+        else if (overlaps && sscanf(line.c_str(), "AnonHugePages: %lu kB", &kb) == 1)
+        {
+            stats.m_transparent += uint64_t(kb) << 10;
+        }
+    }
+#endif
+
+    return stats;
+}
+
+void log_huge_page_stats()
+{
+    if (!huge_pages_thread_enabled)
+    {
+        return;
+    }
+
+    const auto stats = huge_page_stats();
+    RAW_LOG_INFO("Huge pages back %lu of %lu bytes allocated for them: %lu explicit, %lu transparent",
+                 stats.m_explicit + stats.m_transparent, stats.m_allocated, stats.m_explicit, stats.m_transparent);
+}
+
+} // namespace snark
@@ -0,0 +1,95 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#ifndef SNARK_HUGE_PAGES_H
+#define SNARK_HUGE_PAGES_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+namespace snark
+{
+
+// Arrays of at least this size are allocated in multiples of it when huge pages are enabled.
+const size_t huge_page_size = size_t(2) << 20;
+
+// Arrays allocated by the calling thread while the scope is alive use huge pages if enabled is set, threads started
+// by parallel_for and run_on_numa_node inherit the setting. Explicit huge pages reserved with hugetlbfs are tried
+// first, then transparent huge pages, and regular pages if both are not available.
+class HugePageScope
+{
+  public:
+    explicit HugePageScope(bool enabled);
+    ~HugePageScope();
+
+    HugePageScope(const HugePageScope &) = delete;
+    HugePageScope &operator=(const HugePageScope &) = delete;
+
+  private:
+    bool m_previous;
+};
+
+// Whether arrays allocated by the calling thread use huge pages.
+bool huge_pages_enabled();
+
+struct HugePageStats
+{
+    // Size of live arrays allocated for huge pages.
+    uint64_t m_allocated = 0;
+    // Bytes backed by explicit huge pages.
+    uint64_t m_explicit = 0;
+    // Bytes backed by transparent huge pages according to /proc/self/smaps, the kernel can collapse
+    // more pages later.
+    uint64_t m_transparent = 0;
+};
+
+HugePageStats huge_page_stats();
+
+// Log huge page stats if huge pages are enabled for the calling thread.
+void log_huge_page_stats();
+
+// Return nullptr if huge pages are disabled or size is less than huge_page_size.
+void *allocate_huge_pages(size_t size);
+// Return false if address was not allocated by allocate_huge_pages.
+bool deallocate_huge_pages(void *address, size_t size);
+
+// Allocator for large random access arrays, which spend a lot of time on TLB misses with regular pages.
+template <typename T> struct HugePageAllocator
+{
+    using value_type = T;
+
+    HugePageAllocator() = default;
+    template <typename U> HugePageAllocator(const HugePageAllocator<U> &)
+    {
+    }
+
+    T *allocate(size_t count)
+    {
+        if (auto address = allocate_huge_pages(count * sizeof(T)))
+        {
+            return static_cast<T *>(address);
+        }
+        return std::allocator<T>().allocate(count);
+    }
+
+    void deallocate(T *address, size_t count)
+    {
+        if (!deallocate_huge_pages(address, count * sizeof(T)))
+        {
+            std::allocator<T>().deallocate(address, count);
+        }
+    }
+
+    template <typename U> bool operator==(const HugePageAllocator<U> &) const
+    {
+        return true;
+    }
+};
+
+template <typename T> using huge_vector = std::vector<T, HugePageAllocator<T>>;
+
+} // namespace snark
+
+#endif // SNARK_HUGE_PAGES_H
@@ -4,6 +4,13 @@
 #include "locator.h"
 #include <cstring>
 
+#ifdef SNARK_PLATFORM_WINDOWS
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
 #include <glog/logging.h>
 #include <glog/raw_logging.h>
 
@@ -26,6 +33,11 @@ FILE *open_meta(std::filesystem::path path, std::string mode)
     return open_file(path / "meta.txt", mode.c_str());
 }
 
+FILE *open_node_map_index(std::filesystem::path path, std::string mode)
+{
+    return open_file(path / "node_map.index", mode.c_str());
+}
+
 FILE *open_node_map(std::filesystem::path path, std::string suffix)
 {
     return open_file(path / ("node_" + suffix + ".map"), "rb");
@@ -46,6 +58,11 @@ FILE *open_node_features_data(std::filesystem::path path, std::string suffix)
     return open_file(path / ("node_features_" + suffix + ".data"), "rb");
 }
 
+FILE *open_node_features_compressed(std::filesystem::path path, std::string suffix)
+{
+    return open_file(path / ("node_features_" + suffix + ".zdata"), "rb");
+}
+
 FILE *open_neighbor_index(std::filesystem::path path, std::string suffix)
 {
     return open_file(path / ("neighbors_" + suffix + ".index"), "rb");
@@ -66,6 +83,16 @@ FILE *open_edge_features_data(std::filesystem::path path, std::string suffix)
     return open_file(path / ("edge_features_" + suffix + ".data"), "rb");
 }
 
+FILE *open_edge_features_compressed(std::filesystem::path path, std::string suffix)
+{
+    return open_file(path / ("edge_features_" + suffix + ".zdata"), "rb");
+}
+
+FILE *open_snapshot(std::filesystem::path path, std::string suffix)
+{
+    return open_file(path / ("snapshot_" + suffix + ".bin"), "rb");
+}
+
 FILE *open_edge_alias(std::filesystem::path path, size_t partition, Type type)
 {
     return open_file(path / ("edge_" + std::to_string(type) + "_" + std::to_string(partition) + ".alias"), "rb");
@@ -95,4 +122,42 @@ size_t platform_ftell(FILE *f)
 #endif
 }
 
+size_t platform_pread(FILE *f, void *output, size_t size, uint64_t offset)
+{
+    auto curr = static_cast<char *>(output);
+    size_t total = 0;
+    while (total < size)
+    {
+#ifdef SNARK_PLATFORM_WINDOWS
+        auto handle = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(f)));
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = DWORD(offset + total);
+        overlapped.OffsetHigh = DWORD((offset + total) >> 32);
+        DWORD bytes_read = 0;
+        const auto chunk = DWORD(size - total < MAXDWORD ? size - total : MAXDWORD);
+        if (!ReadFile(handle, curr + total, chunk, &bytes_read, &overlapped) && GetLastError() != ERROR_HANDLE_EOF)
+        {
+            RAW_LOG_FATAL("Failed to read file: error %lu", GetLastError());
+        }
+#else
+        const auto bytes_read = pread(fileno(f), curr + total, size - total, offset + total);
+        if (bytes_read < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            RAW_LOG_FATAL("Failed to read file: %s", strerror(errno));
+        }
+#endif
+        if (bytes_read == 0)
+        {
+            break;
+        }
+        total += bytes_read;
+    }
+
+    return total;
+}
+
 } // namespace snark
@@ -14,19 +14,27 @@ namespace snark
 {
 FILE *open_file(std::filesystem::path s, const char *mode);
 FILE *open_meta(std::filesystem::path path, std::string mode);
+FILE *open_node_map_index(std::filesystem::path path, std::string mode);
 FILE *open_node_map(std::filesystem::path path, std::string suffix);
 FILE *open_node_index(std::filesystem::path path, std::string suffix);
 FILE *open_node_features_index(std::filesystem::path path, std::string suffix);
 FILE *open_node_features_data(std::filesystem::path path, std::string suffix);
+FILE *open_node_features_compressed(std::filesystem::path path, std::string suffix);
 FILE *open_neighbor_index(std::filesystem::path path, std::string suffix);
 FILE *open_edge_index(std::filesystem::path path, std::string suffix);
 FILE *open_edge_features_index(std::filesystem::path path, std::string suffix);
 FILE *open_edge_features_data(std::filesystem::path path, std::string suffix);
+FILE *open_edge_features_compressed(std::filesystem::path path, std::string suffix);
+FILE *open_snapshot(std::filesystem::path path, std::string suffix);
 FILE *open_edge_alias(std::filesystem::path path, size_t partition, Type type);
 FILE *open_node_alias(std::filesystem::path path, size_t partition, Type type);
 
 void platform_fseek(FILE *f, int offset, int origin);
 size_t platform_ftell(FILE *f);
+
+// Read size bytes starting at offset without moving the file position or using stdio buffers.
+// Safe to call concurrently on the same file. Returns number of bytes read.
+size_t platform_pread(FILE *f, void *output, size_t size, uint64_t offset);
 }; // namespace snark
 
 #endif // SNARK_LOCATOR_H
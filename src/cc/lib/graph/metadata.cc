@@ -131,6 +131,22 @@ Metadata::Metadata(std::filesystem::path path, std::string config_path)
         }
         m_edge_count_per_type[i] = count;
     }
+
+    // Graphs without quantized features don't have this section.
+    if (fscanf(meta, "q%zu\n", &count) == 1)
+    {
+        m_node_feature_quantization.resize(count);
+        for (auto &quantization : m_node_feature_quantization)
+        {
+            uint32_t encoding;
+            if (fscanf(meta, "%u %f %f\n", &encoding, &quantization.m_scale, &quantization.m_zero_point) != 3 ||
+                encoding > uint32_t(FeatureEncoding::int8))
+            {
+                RAW_LOG_FATAL("Failed to read node feature encodings from meta file");
+            }
+            quantization.m_encoding = FeatureEncoding(encoding);
+        }
+    }
     fclose(meta);
 }
 
@@ -206,6 +222,22 @@ void Metadata::Write(std::filesystem::path path) const
             exit(errno);
         }
     }
+    if (!m_node_feature_quantization.empty())
+    {
+        if (fprintf(meta, "q%zu\n", m_node_feature_quantization.size()) <= 0)
+        {
+            exit(errno);
+        }
+        for (const auto &quantization : m_node_feature_quantization)
+        {
+            // 9 significant digits restore floats exactly.
+            if (fprintf(meta, "%u %.9g %.9g\n", uint32_t(quantization.m_encoding), quantization.m_scale,
+                        quantization.m_zero_point) <= 0)
+            {
+                exit(errno);
+            }
+        }
+    }
     fclose(meta);
 }
 
@@ -8,6 +8,8 @@
 #include <string>
 #include <vector>
 
+#include "quantization.h"
+
 namespace snark
 {
 
@@ -37,6 +39,10 @@ struct Metadata
     std::vector<std::vector<float>> m_partition_edge_weights;
     std::vector<size_t> m_node_count_per_type;
     std::vector<size_t> m_edge_count_per_type;
+
+    // Storage encodings of node features indexed by feature id, empty for graphs with raw features.
+    // Written to an optional section at the end of the meta file.
+    std::vector<FeatureQuantization> m_node_feature_quantization;
 };
 } // namespace snark
 
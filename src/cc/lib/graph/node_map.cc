@@ -0,0 +1,611 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#include "node_map.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <numeric>
+#include <span>
+#include <system_error>
+
+#include "absl/container/flat_hash_map.h"
+
+#include <glog/logging.h>
+#include <glog/raw_logging.h>
+
+#include "huge_pages.h"
+#include "locator.h"
+#include "parallel.h"
+#include "snapshot.h"
+#include "storage.h"
+
+namespace snark
+{
+namespace
+{
+const size_t shard_bits = 6;
+
+size_t shard_index(NodeId node)
+{
+    // Fibonacci hashing to use different bits from the ones picked by hash maps inside shards.
+    return (uint64_t(node) * 0x9E3779B97F4A7C15ull) >> (64 - shard_bits);
+}
+
+// Pair of a node id and its internal id in a partition.
+using NodeRecord = std::pair<NodeId, uint64_t>;
+
+// Interpolation search finds evenly spread ids in a step or two, binary search bounds the worst case.
+const size_t interpolation_steps = 4;
+
+// Number of nodes processed by every stage of batch lookups before moving to the next stage,
+// it bounds the number of prefetches in flight.
+const size_t find_block_size = 16;
+
+// Increment version on any change of the index file layout.
+const uint64_t index_magic = 0x58444950414D4E53ull; // "SNMAPIDX" in little endian.
+const uint32_t index_version = 4;
+const uint64_t index_alignment = 64;
+
+struct IndexHeader
+{
+    uint64_t m_magic;
+    uint32_t m_version;
+    uint32_t m_partition_count;
+    uint64_t m_node_count;
+    uint64_t m_spill_count;
+    uint64_t m_fingerprint;
+    uint64_t m_flags;
+};
+
+// Index has no arrays, see NodeMap::Mode::identity.
+const uint64_t index_identity_flag = 1;
+
+// Offsets of arrays in the index file.
+struct IndexLayout
+{
+    IndexLayout(uint64_t node_count, uint64_t spill_count)
+    {
+        uint64_t offset = sizeof(IndexHeader);
+        auto next = [&offset](uint64_t size) {
+            const uint64_t start = (offset + index_alignment - 1) / index_alignment * index_alignment;
+            offset = start + size;
+            return start;
+        };
+        m_ids = next(node_count * sizeof(NodeId));
+        m_locations = next(node_count * sizeof(uint64_t));
+        m_spill_partitions = next(spill_count * sizeof(uint32_t));
+        m_spill_internal_ids = next(spill_count * sizeof(uint64_t));
+        m_spill_counts = next(spill_count * sizeof(uint32_t));
+        m_end = offset;
+    }
+
+    uint64_t m_ids;
+    uint64_t m_locations;
+    uint64_t m_spill_partitions;
+    uint64_t m_spill_internal_ids;
+    uint64_t m_spill_counts;
+    uint64_t m_end;
+};
+
+// Index is valid only for the same list of partitions with unchanged node maps. Hashing contents would cost
+// a full read of every node map on each load, so a rewritten map is detected by its size and modification time.
+uint64_t fingerprint(const std::vector<std::pair<std::filesystem::path, std::string>> &partitions)
+{
+    // FNV-1a is stable across platforms and compilers unlike std::hash.
+    uint64_t hash = 0xCBF29CE484222325ull;
+    auto add = [&hash](const void *data, size_t size) {
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash = (hash ^ static_cast<const uint8_t *>(data)[i]) * 0x100000001B3ull;
+        }
+    };
+    for (const auto &[path, suffix] : partitions)
+    {
+        const auto map_path = path / ("node_" + suffix + ".map");
+        std::error_code error;
+        const uint64_t size = std::filesystem::file_size(map_path, error);
+        const int64_t time = std::filesystem::last_write_time(map_path, error).time_since_epoch().count();
+        const auto name = map_path.string();
+        add(name.c_str(), name.size() + 1);
+        add(&size, sizeof(size));
+        add(&time, sizeof(time));
+    }
+
+    return hash;
+}
+
+void write_bytes(FILE *file, const void *data, size_t size)
+{
+    if (size > 0 && fwrite(data, 1, size, file) != size)
+    {
+        RAW_LOG_FATAL("Failed to write node map index: %s", strerror(errno));
+    }
+}
+
+// Arrays of a node map built in memory.
+struct NodeMapData
+{
+    huge_vector<NodeId> m_ids;
+    huge_vector<uint64_t> m_locations;
+    std::vector<uint32_t> m_spill_partitions;
+    std::vector<uint64_t> m_spill_internal_ids;
+    std::vector<uint32_t> m_spill_counts;
+};
+
+} // namespace
+
+NodeMap::NodeMap(const std::vector<std::pair<std::filesystem::path, std::string>> &partitions,
+                 std::string config_path)
+{
+    if (!Map(partitions))
+    {
+        Build(partitions, std::move(config_path));
+    }
+}
+
+bool NodeMap::Map(const std::vector<std::pair<std::filesystem::path, std::string>> &partitions)
+{
+#ifdef SNARK_PLATFORM_WINDOWS
+    return false;
+#else
+    std::error_code error;
+    if (partitions.empty() || is_hdfs_path(partitions.front().first) ||
+        !std::filesystem::is_regular_file(partitions.front().first / "node_map.index", error))
+    {
+        return false;
+    }
+
+    auto index = std::make_shared<MmapStorage<uint8_t>>(partitions.front().first, "rb", open_node_map_index);
+    IndexHeader header;
+    if (index->size() < sizeof(header))
+    {
+        RAW_LOG_WARNING("Ignoring node map index: truncated file");
+        return false;
+    }
+
+    std::memcpy(&header, index->data(), sizeof(header));
+    if (header.m_magic != index_magic || header.m_version != index_version)
+    {
+        RAW_LOG_WARNING("Ignoring node map index: unknown format or version");
+        return false;
+    }
+
+    if (header.m_partition_count != partitions.size() || header.m_fingerprint != fingerprint(partitions))
+    {
+        RAW_LOG_WARNING("Ignoring node map index: it was written for different partitions");
+        return false;
+    }
+
+    if ((header.m_flags & index_identity_flag) != 0)
+    {
+        m_mode = Mode::identity;
+        m_node_count = header.m_node_count;
+        return true;
+    }
+
+    const IndexLayout layout(header.m_node_count, header.m_spill_count);
+    if (index->size() < layout.m_end)
+    {
+        RAW_LOG_WARNING("Ignoring node map index: truncated file");
+        return false;
+    }
+
+    const auto data = index->data();
+    m_ids = std::span(reinterpret_cast<const NodeId *>(data + layout.m_ids), header.m_node_count);
+    m_locations = std::span(reinterpret_cast<const uint64_t *>(data + layout.m_locations), header.m_node_count);
+    m_spill_partitions =
+        std::span(reinterpret_cast<const uint32_t *>(data + layout.m_spill_partitions), header.m_spill_count);
+    m_spill_internal_ids =
+        std::span(reinterpret_cast<const uint64_t *>(data + layout.m_spill_internal_ids), header.m_spill_count);
+    m_spill_counts = std::span(reinterpret_cast<const uint32_t *>(data + layout.m_spill_counts), header.m_spill_count);
+    m_data = std::move(index);
+    DetectDenseIds();
+    return true;
+#endif
+}
+
+void NodeMap::Build(const std::vector<std::pair<std::filesystem::path, std::string>> &partitions,
+                    std::string config_path)
+{
+    const size_t shard_count = size_t(1) << shard_bits;
+
+    // Whether internal ids of every partition equal node ids, flags are combined after partitions are read.
+    std::vector<char> identities(partitions.size(), 1);
+
+    // Internal ids of all nodes have to fit into packed records, otherwise all locations are spilled.
+    std::vector<uint64_t> partition_sizes(partitions.size());
+
+    // Split records of every partition by shards.
+    std::vector<std::vector<std::vector<NodeRecord>>> records(partitions.size(),
+                                                              std::vector<std::vector<NodeRecord>>(shard_count));
+    parallel_for(partitions.size(), [&](size_t partition) {
+        auto &[path, suffix] = partitions[partition];
+        auto &partition_records = records[partition];
+        if (!is_hdfs_path(path) && has_snapshot(path, suffix))
+        {
+            SnapshotReader snapshot(path, suffix);
+            if (snapshot.Valid())
+            {
+                std::vector<NodeId> node_ids;
+                snapshot.Read(SnapshotArray::node_ids, node_ids);
+                partition_sizes[partition] = node_ids.size();
+                bool identity = true;
+                for (size_t i = 0; i < node_ids.size(); ++i)
+                {
+                    identity = identity && node_ids[i] == NodeId(i);
+                    partition_records[shard_index(node_ids[i])].emplace_back(node_ids[i], i);
+                }
+                identities[partition] = identity;
+                return;
+            }
+        }
+
+        std::shared_ptr<BaseStorage<uint8_t>> node_map;
+        if (!is_hdfs_path(path))
+        {
+            node_map = std::make_shared<DiskStorage<uint8_t>>(path, suffix, open_node_map);
+        }
+        else
+        {
+            auto full_path = path / ("node_" + suffix + ".map");
+            node_map = std::make_shared<HDFSStreamStorage<uint8_t>>(full_path.c_str(), config_path);
+        }
+
+        auto node_map_ptr = node_map->start();
+        size_t size = node_map->size() / sizeof(NodeMapRecord);
+        partition_sizes[partition] = size;
+        bool identity = true;
+        read_records<NodeMapRecord>(
+            *node_map, node_map_ptr, size, [&](size_t offset, std::span<const NodeMapRecord> chunk) {
+                for (size_t i = 0; i < chunk.size(); ++i)
+                {
+                    assert(chunk[i].m_internal_id == offset + i);
+                    identity = identity && chunk[i].m_node_id == NodeId(offset + i);
+                    partition_records[shard_index(chunk[i].m_node_id)].emplace_back(chunk[i].m_node_id,
+                                                                                     chunk[i].m_internal_id);
+                }
+            });
+        identities[partition] = identity;
+    });
+
+    // Only a graph of a single partition can be indexed directly by node id.
+    const bool identity = partitions.size() == 1 && identities.front();
+
+    const bool packable = partitions.size() <= max_packed_partitions &&
+                          std::all_of(std::begin(partition_sizes), std::end(partition_sizes),
+                                      [](uint64_t size) { return size <= internal_mask + 1; });
+    if (identity && packable)
+    {
+        m_mode = Mode::identity;
+        m_node_count = partition_sizes.front();
+        return;
+    }
+
+    // Node ids are split between shards to build them in parallel.
+    std::vector<absl::flat_hash_map<NodeId, uint64_t>> shards(shard_count);
+
+    // Number nodes in every shard in order of their first appearance and count their locations.
+    // Node ids in records are replaced with these numbers for the next pass.
+    std::vector<std::vector<uint32_t>> shard_counts(shard_count);
+    parallel_for(shard_count, [&](size_t shard) {
+        auto &map = shards[shard];
+        auto &counts = shard_counts[shard];
+        size_t total = 0;
+        for (const auto &partition_records : records)
+        {
+            total += partition_records[shard].size();
+        }
+
+        map.reserve(total);
+        for (auto &partition_records : records)
+        {
+            for (auto &record : partition_records[shard])
+            {
+                auto [it, inserted] = map.try_emplace(record.first, counts.size());
+                if (inserted)
+                {
+                    counts.emplace_back(1);
+                }
+                else
+                {
+                    ++counts[it->second];
+                }
+                record.first = it->second;
+            }
+        }
+    });
+
+    // Every shard owns a consecutive range of the side table.
+    std::vector<uint64_t> shard_offsets(shard_count + 1, 0);
+    for (size_t shard = 0; shard < shard_count; ++shard)
+    {
+        uint64_t spill_count = 0;
+        for (auto count : shard_counts[shard])
+        {
+            spill_count += (count > 1 || !packable) ? count : 0;
+        }
+        shard_offsets[shard + 1] = shard_offsets[shard] + spill_count;
+    }
+
+    auto data = std::make_shared<NodeMapData>();
+    data->m_spill_partitions.resize(shard_offsets.back());
+    data->m_spill_internal_ids.resize(shard_offsets.back());
+    data->m_spill_counts.resize(shard_offsets.back());
+
+    // Sorted runs of node ids with their location records, one per shard.
+    std::vector<std::vector<std::pair<NodeId, uint64_t>>> runs(shard_count);
+    parallel_for(shard_count, [&](size_t shard) {
+        const auto &counts = shard_counts[shard];
+        std::vector<uint64_t> locations(counts.size());
+        uint64_t offset = shard_offsets[shard];
+        for (size_t node = 0; node < counts.size(); ++node)
+        {
+            if (counts[node] == 1 && packable)
+            {
+                continue;
+            }
+
+            locations[node] = offset;
+            data->m_spill_counts[offset] = counts[node];
+            offset += counts[node];
+        }
+
+        // Visiting partitions in order keeps spilled locations of every node sorted by partition index.
+        for (size_t partition = 0; partition < records.size(); ++partition)
+        {
+            for (const auto &record : records[partition][shard])
+            {
+                if (counts[record.first] == 1 && packable)
+                {
+                    locations[record.first] = (uint64_t(partition) << internal_bits) | record.second;
+                    continue;
+                }
+
+                const auto location = locations[record.first]++;
+                data->m_spill_partitions[location] = uint32_t(partition);
+                data->m_spill_internal_ids[location] = record.second;
+            }
+
+            std::vector<NodeRecord>().swap(records[partition][shard]);
+        }
+
+        auto &run = runs[shard];
+        run.reserve(shards[shard].size());
+        for (const auto &el : shards[shard])
+        {
+            const auto count = counts[el.second];
+            auto location = locations[el.second];
+            if (count > 1 || !packable)
+            {
+                // Locations were advanced past the last location of the node.
+                location = spilled | (location - count);
+            }
+            run.emplace_back(el.first, location);
+        }
+        absl::flat_hash_map<NodeId, uint64_t>().swap(shards[shard]);
+        std::sort(std::begin(run), std::end(run));
+    });
+
+    // Merge runs pairwise until a single one is left.
+    while (runs.size() > 1)
+    {
+        std::vector<std::vector<std::pair<NodeId, uint64_t>>> merged((runs.size() + 1) / 2);
+        parallel_for(merged.size(), [&](size_t index) {
+            auto &left = runs[2 * index];
+            if (2 * index + 1 == runs.size())
+            {
+                merged[index] = std::move(left);
+                return;
+            }
+
+            auto &right = runs[2 * index + 1];
+            merged[index].resize(left.size() + right.size());
+            std::merge(std::begin(left), std::end(left), std::begin(right), std::end(right),
+                       std::begin(merged[index]));
+            std::vector<std::pair<NodeId, uint64_t>>().swap(left);
+            std::vector<std::pair<NodeId, uint64_t>>().swap(right);
+        });
+        runs = std::move(merged);
+    }
+
+    const auto &sorted = runs.front();
+    data->m_ids.resize(sorted.size());
+    data->m_locations.resize(sorted.size());
+    for (size_t i = 0; i < sorted.size(); ++i)
+    {
+        data->m_ids[i] = sorted[i].first;
+        data->m_locations[i] = sorted[i].second;
+    }
+
+    m_ids = data->m_ids;
+    m_locations = data->m_locations;
+    m_spill_partitions = data->m_spill_partitions;
+    m_spill_internal_ids = data->m_spill_internal_ids;
+    m_spill_counts = data->m_spill_counts;
+    DetectDenseIds();
+    if (m_mode == Mode::dense)
+    {
+        huge_vector<NodeId>().swap(data->m_ids);
+    }
+    m_data = std::move(data);
+}
+
+void NodeMap::DetectDenseIds()
+{
+    // Ids are sorted and unique, so they are dense if the first and last ones match.
+    m_node_count = m_ids.size();
+    if (!m_ids.empty() && m_ids.front() == 0 && m_ids.back() == NodeId(m_ids.size() - 1))
+    {
+        m_mode = Mode::dense;
+        m_ids = {};
+    }
+}
+
+void NodeMap::Write(const std::vector<std::pair<std::filesystem::path, std::string>> &partitions,
+                    std::filesystem::path path) const
+{
+    IndexHeader header = {};
+    header.m_magic = index_magic;
+    header.m_version = index_version;
+    header.m_partition_count = uint32_t(partitions.size());
+    header.m_node_count = m_node_count;
+    header.m_spill_count = m_spill_counts.size();
+    header.m_fingerprint = fingerprint(partitions);
+    if (m_mode == Mode::identity)
+    {
+        header.m_flags = index_identity_flag;
+    }
+
+    // Dense ids are not stored in memory, but are written to keep a single layout.
+    std::vector<NodeId> dense_ids;
+    auto ids = m_ids;
+    if (m_mode == Mode::dense)
+    {
+        dense_ids.resize(m_node_count);
+        std::iota(std::begin(dense_ids), std::end(dense_ids), NodeId(0));
+        ids = dense_ids;
+    }
+    const IndexLayout layout(ids.size(), header.m_spill_count);
+
+    // Write to a temporary file first, so graphs never map a partially written index.
+    const auto final_path = path / "node_map.index";
+    auto temp_path = final_path;
+    temp_path += ".tmp";
+    {
+        FilePtr file(open_file(temp_path, "wb"));
+        uint64_t position = 0;
+        const std::vector<uint8_t> padding(index_alignment, 0);
+        auto write = [&](uint64_t offset, const void *data, size_t size) {
+            write_bytes(*file, padding.data(), offset - position);
+            write_bytes(*file, data, size);
+            position = offset + size;
+        };
+        write(0, &header, sizeof(header));
+        write(layout.m_ids, ids.data(), ids.size_bytes());
+        write(layout.m_locations, m_locations.data(), m_locations.size_bytes());
+        write(layout.m_spill_partitions, m_spill_partitions.data(), m_spill_partitions.size_bytes());
+        write(layout.m_spill_internal_ids, m_spill_internal_ids.data(), m_spill_internal_ids.size_bytes());
+        write(layout.m_spill_counts, m_spill_counts.data(), m_spill_counts.size_bytes());
+    }
+
+    std::filesystem::rename(temp_path, final_path);
+}
+
+size_t NodeMap::Probe(NodeId node, size_t lo, size_t hi) const
+{
+    // Differences are computed on unsigned values to avoid overflows for ids of different signs.
+    const NodeId first = m_ids[lo];
+    const NodeId last = m_ids[hi - 1];
+    const double fraction = double(uint64_t(node) - uint64_t(first)) / double(uint64_t(last) - uint64_t(first));
+    return lo + std::min(hi - lo - 1, size_t(fraction * double(hi - lo - 1)));
+}
+
+size_t NodeMap::Position(NodeId node) const
+{
+    size_t lo = 0;
+    size_t hi = m_ids.size();
+    for (size_t step = 0; step < interpolation_steps && hi - lo > 1; ++step)
+    {
+        if (node < m_ids[lo] || node > m_ids[hi - 1])
+        {
+            return npos;
+        }
+
+        const size_t pos = Probe(node, lo, hi);
+        if (m_ids[pos] < node)
+        {
+            lo = pos + 1;
+        }
+        else if (m_ids[pos] > node)
+        {
+            hi = pos;
+        }
+        else
+        {
+            return pos;
+        }
+    }
+
+    auto end = std::begin(m_ids) + hi;
+    auto it = std::lower_bound(std::begin(m_ids) + lo, end, node);
+    return it == end || *it != node ? npos : size_t(it - std::begin(m_ids));
+}
+
+uint64_t NodeMap::Search(NodeId node) const
+{
+    const auto pos = Position(node);
+    return pos == npos ? npos : m_locations[pos];
+}
+
+void NodeMap::Find(std::span<const NodeId> nodes, std::span<uint64_t> output) const
+{
+    assert(nodes.size() == output.size());
+    if (m_mode == Mode::identity)
+    {
+        for (size_t i = 0; i < nodes.size(); ++i)
+        {
+            output[i] = Find(nodes[i]);
+        }
+        return;
+    }
+
+    // Lookups of a block are split into stages, every stage prefetches memory for the next one,
+    // so cache misses of nodes in the block overlap instead of being resolved one after another.
+    std::array<size_t, find_block_size> positions;
+    for (size_t start = 0; start < nodes.size(); start += find_block_size)
+    {
+        const auto block = nodes.subspan(start, std::min(find_block_size, nodes.size() - start));
+        const auto block_output = output.subspan(start, block.size());
+        if (m_mode == Mode::dense)
+        {
+            for (auto node : block)
+            {
+                if (uint64_t(node) < m_node_count)
+                {
+                    prefetch(&m_locations[node]);
+                }
+            }
+
+            for (size_t i = 0; i < block.size(); ++i)
+            {
+                block_output[i] = Find(block[i]);
+            }
+            continue;
+        }
+
+        // Stage 1: first interpolation probes, they hit the node for evenly spread ids.
+        if (m_ids.size() > 1)
+        {
+            for (auto node : block)
+            {
+                if (node >= m_ids.front() && node <= m_ids.back())
+                {
+                    prefetch(&m_ids[Probe(node, 0, m_ids.size())]);
+                }
+            }
+        }
+
+        // Stage 2: finish searches and prefetch location records.
+        for (size_t i = 0; i < block.size(); ++i)
+        {
+            positions[i] = Position(block[i]);
+            if (positions[i] != npos)
+            {
+                prefetch(&m_locations[positions[i]]);
+            }
+        }
+
+        // Stage 3: read location records.
+        for (size_t i = 0; i < block.size(); ++i)
+        {
+            block_output[i] = positions[i] == npos ? npos : m_locations[positions[i]];
+        }
+    }
+}
+
+} // namespace snark
@@ -0,0 +1,125 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#ifndef SNARK_NODE_MAP_H
+#define SNARK_NODE_MAP_H
+
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "types.h"
+
+namespace snark
+{
+
+// Locations of nodes in partitions. A node might be present in several partitions, in that case
+// its locations are stored consecutively and ordered by partition index.
+// Node ids are kept in a sorted array searched with interpolation, which takes 8 bytes per node
+// instead of a hash map and can be memory mapped from an index file built offline.
+// Dense ids 0..N-1 are used as indices directly, without any search.
+// Every node has a packed location record: for nodes in a single partition it holds the partition
+// index and internal id, so they are resolved without any extra memory accesses. Records of nodes
+// present in several partitions refer to a side table with their locations.
+class NodeMap
+{
+  public:
+    // Returned by Find for nodes not present in any partition.
+    static constexpr uint64_t npos = std::numeric_limits<uint64_t>::max();
+
+    NodeMap() = default;
+
+    // Map node_map.index from the folder of the first partition if it was written for the same list of partitions,
+    // otherwise build map from partition snapshots or node_*.map files. Partition index of a location is the position
+    // of the partition in the list. Files are read and merged on multiple threads, the result doesn't depend on the
+    // number of threads.
+    NodeMap(const std::vector<std::pair<std::filesystem::path, std::string>> &partitions, std::string config_path);
+
+    // Write index file to path, it will be mapped by graphs loading the same list of partitions.
+    void Write(const std::vector<std::pair<std::filesystem::path, std::string>> &partitions,
+               std::filesystem::path path) const;
+
+    // Index of the first location of a node or npos. Indices of the next locations are consecutive.
+    uint64_t Find(NodeId node) const
+    {
+        // Negative ids are out of range after conversion to unsigned.
+        switch (m_mode)
+        {
+        case Mode::identity:
+            return uint64_t(node) < m_node_count ? uint64_t(node) : npos;
+        case Mode::dense:
+            return uint64_t(node) < m_node_count ? m_locations[node] : npos;
+        default:
+            return Search(node);
+        }
+    }
+
+    // Batch version of Find, output must have the same size as nodes. Nodes are looked up in blocks
+    // with software prefetching, which is faster than calling Find for every node on large graphs.
+    void Find(std::span<const NodeId> nodes, std::span<uint64_t> output) const;
+
+    // Number of locations of the node starting at index.
+    uint32_t Count(uint64_t index) const
+    {
+        return (index & spilled) != 0 ? m_spill_counts[index ^ spilled] : 1;
+    }
+
+    uint32_t PartitionIndex(uint64_t index) const
+    {
+        return (index & spilled) != 0 ? m_spill_partitions[index ^ spilled] : uint32_t(index >> internal_bits);
+    }
+
+    uint64_t InternalId(uint64_t index) const
+    {
+        return (index & spilled) != 0 ? m_spill_internal_ids[index ^ spilled] : index & internal_mask;
+    }
+
+    // Packed record layout, the highest bit marks records referring to the side table.
+    static constexpr uint64_t spilled = uint64_t(1) << 63;
+    static constexpr uint64_t internal_bits = 48;
+    static constexpr uint64_t internal_mask = (uint64_t(1) << internal_bits) - 1;
+    static constexpr uint64_t max_packed_partitions = uint64_t(1) << (63 - internal_bits);
+
+  private:
+    enum class Mode
+    {
+        // Search node ids in the sorted array.
+        sorted,
+        // Node ids are 0..N-1, so they index the array of locations directly.
+        dense,
+        // Node ids are 0..N-1 stored in order in a single partition, so ids are packed locations
+        // themselves and no arrays are allocated.
+        identity
+    };
+
+    uint64_t Search(NodeId node) const;
+    // Position of node in m_ids or npos.
+    size_t Position(NodeId node) const;
+    // Interpolated position of node between m_ids[lo] and m_ids[hi - 1], node must be in that range.
+    size_t Probe(NodeId node, size_t lo, size_t hi) const;
+    void DetectDenseIds();
+    bool Map(const std::vector<std::pair<std::filesystem::path, std::string>> &partitions);
+    void Build(const std::vector<std::pair<std::filesystem::path, std::string>> &partitions, std::string config_path);
+
+    Mode m_mode = Mode::sorted;
+    uint64_t m_node_count = 0;
+
+    // Arrays point either to a memory mapped index file or to vectors built in memory, both owned by m_data.
+    std::shared_ptr<const void> m_data;
+    std::span<const NodeId> m_ids;
+    std::span<const uint64_t> m_locations;
+
+    // Side table with locations of nodes which don't fit into packed records, mostly nodes present in
+    // several partitions. Count is stored at the first location of every node.
+    std::span<const uint32_t> m_spill_partitions;
+    std::span<const uint64_t> m_spill_internal_ids;
+    std::span<const uint32_t> m_spill_counts;
+};
+
+} // namespace snark
+
+#endif // SNARK_NODE_MAP_H
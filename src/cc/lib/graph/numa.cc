@@ -0,0 +1,221 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#include "numa.h"
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifdef SNARK_PLATFORM_LINUX
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "huge_pages.h"
+#include <glog/logging.h>
+#include <glog/raw_logging.h>
+
+namespace snark
+{
+namespace
+{
+#ifdef SNARK_PLATFORM_LINUX
+const char numa_node_path[] = "/sys/devices/system/node/";
+
+// Parse lists in sysfs format, e.g. "0-3,8-11".
+std::vector<size_t> read_list(const std::string &path)
+{
+    std::ifstream file(path);
+    std::string line;
+    std::vector<size_t> result;
+    if (!std::getline(file, line))
+    {
+        return result;
+    }
+
+    std::stringstream ranges(line);
+    std::string range;
+    while (std::getline(ranges, range, ','))
+    {
+        const auto dash = range.find('-');
+        try
+        {
+            const size_t first = std::stoul(range.substr(0, dash));
+            const size_t last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+            for (size_t i = first; i <= last; ++i)
+            {
+                result.emplace_back(i);
+            }
+        }
+        catch (const std::exception &)
+        {
+            RAW_LOG_WARNING("Failed to parse %s", path.c_str());
+            return {};
+        }
+    }
+
+    return result;
+}
+#endif
+} // namespace
+
+size_t numa_node_count()
+{
+#ifdef SNARK_PLATFORM_LINUX
+    const auto nodes = read_list(std::string(numa_node_path) + "online");
+    return nodes.empty() ? 1 : nodes.back() + 1;
+#else
+    return 1;
+#endif
+}
+
+void bind_thread_to_numa_node(size_t node)
+{
+#ifdef SNARK_PLATFORM_LINUX
+    const auto cpus = read_list(std::string(numa_node_path) + "node" + std::to_string(node) + "/cpulist");
+    if (cpus.empty())
+    {
+        return;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (auto cpu : cpus)
+    {
+        if (cpu < CPU_SETSIZE)
+        {
+            CPU_SET(cpu, &set);
+        }
+    }
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+    {
+        RAW_LOG_WARNING("Failed to bind thread to NUMA node %zu", node);
+    }
+#endif
+}
+
+void run_on_numa_node(size_t node, std::function<void()> f)
+{
+    std::exception_ptr error;
+    const bool huge_pages = huge_pages_enabled();
+    std::thread thread([&]() {
+        bind_thread_to_numa_node(node);
+        HugePageScope scope(huge_pages);
+        try
+        {
+            f();
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+    });
+    thread.join();
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+NumaWorkers::NumaWorkers(size_t node_count, size_t threads_per_node)
+{
+    for (size_t node = 0; node < node_count; ++node)
+    {
+        m_queues.emplace_back(std::make_unique<Queue>());
+    }
+    for (size_t node = 0; node < node_count; ++node)
+    {
+        for (size_t i = 0; i < std::max<size_t>(threads_per_node, 1); ++i)
+        {
+            m_threads.emplace_back([this, node]() {
+                bind_thread_to_numa_node(node);
+                Work(*m_queues[node]);
+            });
+        }
+    }
+}
+
+NumaWorkers::~NumaWorkers()
+{
+    for (auto &queue : m_queues)
+    {
+        std::lock_guard lock(queue->m_mutex);
+        queue->m_stop = true;
+        queue->m_ready.notify_all();
+    }
+    for (auto &thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+size_t NumaWorkers::NodeCount() const
+{
+    return m_queues.size();
+}
+
+void NumaWorkers::Run(std::span<const size_t> nodes, std::function<void(size_t)> f)
+{
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t pending = nodes.size();
+    std::exception_ptr error;
+    for (auto node : nodes)
+    {
+        auto &queue = *m_queues[node];
+        std::lock_guard lock(queue.m_mutex);
+        queue.m_tasks.emplace_back([&, node]() {
+            try
+            {
+                f(node);
+            }
+            catch (...)
+            {
+                std::lock_guard error_lock(mutex);
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+            }
+
+            std::lock_guard done_lock(mutex);
+            if (--pending == 0)
+            {
+                done.notify_one();
+            }
+        });
+        queue.m_ready.notify_one();
+    }
+
+    std::unique_lock lock(mutex);
+    done.wait(lock, [&pending]() { return pending == 0; });
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+void NumaWorkers::Work(Queue &queue)
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(queue.m_mutex);
+            queue.m_ready.wait(lock, [&queue]() { return queue.m_stop || !queue.m_tasks.empty(); });
+            if (queue.m_tasks.empty())
+            {
+                return;
+            }
+
+            task = std::move(queue.m_tasks.front());
+            queue.m_tasks.pop_front();
+        }
+        task();
+    }
+}
+
+} // namespace snark
@@ -0,0 +1,61 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#ifndef SNARK_NUMA_H
+#define SNARK_NUMA_H
+
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace snark
+{
+
+// Number of NUMA nodes of the machine, 1 if the topology is not available.
+size_t numa_node_count();
+
+// Restrict the calling thread to CPUs of a NUMA node. Memory first touched by the thread is allocated
+// on that node by the default memory policy. No-op if the topology is not available.
+void bind_thread_to_numa_node(size_t node);
+
+// Run f on a new thread bound to node and wait for it, to allocate data f creates on that node.
+void run_on_numa_node(size_t node, std::function<void()> f);
+
+// Worker threads bound to every NUMA node, so work can be executed next to the memory it reads.
+class NumaWorkers
+{
+  public:
+    // Every node gets threads_per_node workers.
+    NumaWorkers(size_t node_count, size_t threads_per_node);
+    ~NumaWorkers();
+
+    size_t NodeCount() const;
+
+    // Call f(node) on a worker of every node from nodes in parallel and wait for all calls to finish.
+    // The first exception thrown by f is rethrown on the calling thread.
+    void Run(std::span<const size_t> nodes, std::function<void(size_t)> f);
+
+  private:
+    struct Queue
+    {
+        std::mutex m_mutex;
+        std::condition_variable m_ready;
+        std::deque<std::function<void()>> m_tasks;
+        bool m_stop = false;
+    };
+
+    void Work(Queue &queue);
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+};
+
+} // namespace snark
+
+#endif // SNARK_NUMA_H
@@ -0,0 +1,79 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#ifndef SNARK_PARALLEL_H
+#define SNARK_PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "huge_pages.h"
+
+namespace snark
+{
+
+// Call f(i) for every i in [0, count) on at most max_threads threads, items are picked up in increasing order.
+// The first exception thrown by f is rethrown on the calling thread after all threads finish.
+template <typename F>
+void parallel_for(size_t count, F f, size_t max_threads = std::thread::hardware_concurrency())
+{
+    const size_t thread_count = std::min(count, std::max<size_t>(1, max_threads));
+    if (thread_count <= 1)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            f(i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next = 0;
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    const bool huge_pages = huge_pages_enabled();
+    auto worker = [&]() {
+        HugePageScope scope(huge_pages);
+        try
+        {
+            for (size_t i = next++; i < count; i = next++)
+            {
+                f(i);
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard lock(error_mutex);
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+            next = count;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1);
+    for (size_t i = 1; i < thread_count; ++i)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace snark
+
+#endif // SNARK_PARALLEL_H
@@ -1,19 +1,32 @@
 // Copyright (c) Microsoft Corporation.
 // Licensed under the MIT License.
 #include <algorithm>
+#include <array>
+#include <bit>
 #include <cassert>
+#include <cmath>
 #include <cstdio>
 #include <cstring>
 #include <limits>
+#include <numeric>
 #include <string>
 
 #include "boost/random/binomial_distribution.hpp"
 #include "boost/random/uniform_real_distribution.hpp"
+#include "compressed_storage.h"
 #include "locator.h"
+#include "parallel.h"
 #include "partition.h"
+#include "quantization.h"
 #include "sampler.h"
+#include "snapshot.h"
 #include <glog/logging.h>
 #include <glog/raw_logging.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 namespace snark
 {
 namespace
@@ -25,71 +38,676 @@ struct EdgeRecord
     Type m_type;
     float m_weight;
 };
-} // namespace
-Partition::Partition(Metadata metadata, std::filesystem::path path, std::string suffix,
-                     PartitionStorageType storage_type)
-    : m_metadata(std::move(metadata)), m_storage_type(storage_type)
+
+// Copy a feature stored in memory truncated or zero padded to feature_size bytes.
+std::span<uint8_t>::iterator copy_feature(const uint8_t *data, uint64_t stored_size, uint64_t feature_size,
+                                          std::span<uint8_t>::iterator output)
 {
-    ReadNodeMap(path, suffix);
-    ReadNodeFeatures(path, suffix);
-    ReadEdges(std::move(path), std::move(suffix));
+    const auto copied = std::min(stored_size, feature_size);
+    output = std::copy_n(data, copied, output);
+    return std::fill_n(output, feature_size - copied, 0);
 }
-void Partition::ReadNodeMap(std::filesystem::path path, std::string suffix)
+
+// Whole sparse feature blob, viewed in place for memory storages and read with a single call otherwise.
+std::span<const uint8_t> read_sparse_feature(const BaseStorage<uint8_t> &storage, uint64_t data_offset,
+                                             uint64_t stored_size, std::vector<uint8_t> &buffer)
 {
-    std::shared_ptr<BaseStorage<uint8_t>> node_map;
-    if (!is_hdfs_path(path))
+    const auto view = storage.view();
+    if (data_offset + stored_size <= view.size())
     {
-        node_map = std::make_shared<DiskStorage<uint8_t>>(std::move(path), std::move(suffix), open_node_map);
+        return view.subspan(data_offset, stored_size);
+    }
+
+    buffer.resize(stored_size);
+    auto output = std::span(buffer);
+    storage.read(data_offset, stored_size, std::begin(output), nullptr);
+    return output;
+}
+
+// Decode a sparse feature blob: number of indices and their dimension as uint32 values, int64 indices and values.
+// Rows of indices are appended to out_indices with prefix in front of them. Return dimension of indices.
+int64_t decode_sparse_feature(std::span<const uint8_t> blob, int64_t prefix, std::vector<int64_t> &out_indices,
+                              std::vector<uint8_t> &out_values)
+{
+    uint32_t indices_size = 0;
+    uint32_t indices_dim = 0;
+    memcpy(&indices_size, blob.data(), 4);
+    memcpy(&indices_dim, blob.data() + 4, 4);
+    assert(indices_dim > 0 && indices_size % indices_dim == 0);
+
+    const size_t num_values = indices_size / indices_dim;
+    const size_t row_size = indices_dim + 1;
+    const auto old_len = out_indices.size();
+    out_indices.resize(old_len + indices_size + num_values);
+    auto output = out_indices.data() + old_len;
+    const auto indices = blob.data() + 8;
+    if (indices_dim == 1)
+    {
+        // Interleave the prefix column with indices, two rows per iteration.
+        size_t i = 0;
+#ifdef __SSE2__
+        const auto prefixes = _mm_set1_epi64x(prefix);
+        for (; i + 2 <= num_values; i += 2)
+        {
+            const auto pair = _mm_loadu_si128(reinterpret_cast<const __m128i *>(indices + i * 8));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(output + 2 * i), _mm_unpacklo_epi64(prefixes, pair));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(output + 2 * i + 2), _mm_unpackhi_epi64(prefixes, pair));
+        }
+#endif
+        for (; i < num_values; ++i)
+        {
+            output[2 * i] = prefix;
+            memcpy(output + 2 * i + 1, indices + i * 8, 8);
+        }
     }
     else
     {
-        auto full_path = path / ("node_" + suffix + ".map");
-        node_map = std::make_shared<HDFSStreamStorage<uint8_t>>(full_path.c_str(), m_metadata.m_config_path);
+        for (size_t i = 0; i < num_values; ++i)
+        {
+            output[i * row_size] = prefix;
+            memcpy(output + i * row_size + 1, indices + i * indices_dim * 8, indices_dim * 8);
+        }
     }
-    auto node_map_ptr = node_map->start();
-    size_t size = node_map->size() / 20;
-    m_node_types.reserve(size);
+
+    const auto values = blob.subspan(8 + size_t(indices_size) * 8);
+    out_values.insert(std::end(out_values), std::begin(values), std::end(values));
+    return int64_t(indices_dim);
+}
+
+// Fill an alias table of edges with cumulative weights with Vose's method: every entry keeps its edge with
+// probability m_threshold and redirects the rest of its 1 / size share to the edge at m_alias.
+template <typename Alias> void build_alias_table(std::span<const float> cumulative_weights, std::span<Alias> table)
+{
+    const auto size = cumulative_weights.size();
+    const double scale = double(size) / double(cumulative_weights.back());
+    std::vector<double> shares(size);
+    std::vector<uint32_t> small;
+    std::vector<uint32_t> large;
     for (size_t i = 0; i < size; ++i)
     {
-        uint64_t pair[2];
-        if (node_map->read(pair, 8, 2, node_map_ptr) != 2)
+        const double weight = i == 0 ? cumulative_weights[0] : cumulative_weights[i] - cumulative_weights[i - 1];
+        shares[i] = weight * scale;
+        (shares[i] < 1.0 ? small : large).emplace_back(uint32_t(i));
+    }
+
+    while (!small.empty() && !large.empty())
+    {
+        const auto less = small.back();
+        small.pop_back();
+        const auto more = large.back();
+        table[less] = Alias{float(shares[less]), more};
+        shares[more] -= 1.0 - shares[less];
+        if (shares[more] < 1.0)
         {
-            RAW_LOG_FATAL("Failed to read pair in a node maping");
+            large.pop_back();
+            small.emplace_back(more);
         }
-        Type node_type;
-        if (node_map->read(&node_type, 4, 1, node_map_ptr) != 1)
+    }
+
+    // Leftovers are within rounding errors of a full share.
+    for (auto i : small)
+    {
+        table[i] = Alias{1.0f, i};
+    }
+    for (auto i : large)
+    {
+        table[i] = Alias{1.0f, i};
+    }
+}
+
+// Cumulative weights of a type run are searched in a tree of blocks of search_tree_fanout entries. Every level
+// keeps the largest weight of every block of the level below, the bottom level is built over the cumulative weights
+// themselves and the top level fits into a single block. Levels are stored from the top and padded with infinity to
+// whole blocks, so a search compares a single block per level.
+const uint64_t search_tree_fanout = 16;
+using SearchTreeLevels = std::array<uint64_t, 16>;
+
+// Fill counts of entries on every level above size weights from the bottom up and return the number of levels.
+size_t search_tree_levels(uint64_t size, SearchTreeLevels &counts)
+{
+    size_t levels = 0;
+    for (; size > search_tree_fanout; ++levels)
+    {
+        size = (size + search_tree_fanout - 1) / search_tree_fanout;
+        counts[levels] = size;
+    }
+    return levels;
+}
+
+uint64_t search_tree_padded(uint64_t count)
+{
+    return (count + search_tree_fanout - 1) / search_tree_fanout * search_tree_fanout;
+}
+
+uint64_t search_tree_size(uint64_t size)
+{
+    SearchTreeLevels counts;
+    const auto levels = search_tree_levels(size, counts);
+    uint64_t result = 0;
+    for (size_t level = 0; level < levels; ++level)
+    {
+        result += search_tree_padded(counts[level]);
+    }
+    return result;
+}
+
+void build_search_tree(std::span<const float> cumulative_weights, std::span<float> tree)
+{
+    SearchTreeLevels counts;
+    const auto levels = search_tree_levels(cumulative_weights.size(), counts);
+    std::fill(std::begin(tree), std::end(tree), std::numeric_limits<float>::infinity());
+    auto below = cumulative_weights;
+    auto offset = tree.size();
+    for (size_t level = 0; level < levels; ++level)
+    {
+        offset -= search_tree_padded(counts[level]);
+        const auto current = tree.subspan(offset, counts[level]);
+        for (uint64_t i = 0; i < counts[level]; ++i)
         {
-            RAW_LOG_FATAL("Failed to read node type in a node maping");
+            current[i] = below[std::min((i + 1) * search_tree_fanout, below.size()) - 1];
         }
-        m_node_types.emplace_back(node_type);
+        below = current;
+    }
+}
+
+// Number of entries less than value in a sorted block of search_tree_fanout entries.
+uint64_t count_less(const float *block, float value)
+{
+#ifdef __SSE2__
+    const auto values = _mm_set1_ps(value);
+    uint32_t mask = 0;
+    for (size_t i = 0; i < search_tree_fanout; i += 4)
+    {
+        mask |= uint32_t(_mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(block + i), values))) << i;
+    }
+    return std::popcount(mask);
+#else
+    uint64_t count = 0;
+    for (size_t i = 0; i < search_tree_fanout; ++i)
+    {
+        count += block[i] < value;
+    }
+    return count;
+#endif
+}
+
+// Offset of the first cumulative weight not less than value, same as std::lower_bound for values up to
+// the last weight.
+uint64_t search_tree_lower_bound(const float *tree, const float *cumulative_weights, uint64_t size, float value)
+{
+    value = std::min(value, cumulative_weights[size - 1]);
+    SearchTreeLevels counts;
+    uint64_t index = 0;
+    for (auto level = search_tree_levels(size, counts); level > 0; --level)
+    {
+        index = index * search_tree_fanout + count_less(tree + index * search_tree_fanout, value);
+        tree += search_tree_padded(counts[level - 1]);
+    }
+
+    // Weights of the last block are compared one by one to stay within the type run.
+    const auto block = cumulative_weights + index * search_tree_fanout;
+    const auto block_size = std::min(search_tree_fanout, size - index * search_tree_fanout);
+    if (block_size == search_tree_fanout)
+    {
+        return index * search_tree_fanout + count_less(block, value);
+    }
+
+    uint64_t count = 0;
+    for (uint64_t i = 0; i < block_size; ++i)
+    {
+        count += block[i] < value;
     }
+    return index * search_tree_fanout + count;
 }
-void Partition::ReadEdges(std::filesystem::path path, std::string suffix)
+} // namespace
+Partition::Partition(Metadata metadata, std::filesystem::path path, std::string suffix,
+                     PartitionStorageType storage_type, GraphOptions options, size_t max_threads)
+    : m_metadata(std::move(metadata)),
+      // Hybrid partitions read features like disk partitions, unless they are pinned.
+      m_storage_type(storage_type == PartitionStorageType::hybrid ? PartitionStorageType::disk : storage_type)
 {
-    ReadNeighborsIndex(path, suffix);
-    ReadEdgeIndex(path, suffix);
+    // Other storage types already serve features from memory.
+    if (m_storage_type == PartitionStorageType::disk && options.m_feature_cache_size > 0 && !is_hdfs_path(path))
+    {
+        m_feature_cache = std::make_shared<FeatureCache>(options.m_feature_cache_size);
+    }
+
+    if (is_hdfs_path(path) || !has_snapshot(path, suffix) || !ReadSnapshot(path, suffix))
+    {
+        ReadNodeMap(path, suffix);
+        ReadNodeIndex(path, suffix);
+        if (m_metadata.m_node_feature_count > 0)
+        {
+            ReadNodeFeaturesIndex(path, suffix);
+        }
+        ReadNeighborsIndex(path, suffix);
+        ReadEdgeIndex(path, suffix);
+        if (m_metadata.m_edge_feature_count > 0)
+        {
+            ReadEdgeFeaturesIndex(path, suffix);
+        }
+    }
+
+    DropUnitEdgeWeights();
+    if (options.m_alias_degree_threshold > 0)
+    {
+        BuildAliasTables(options.m_alias_degree_threshold, max_threads);
+    }
+    if (options.m_search_tree_degree_threshold > 0)
+    {
+        BuildSearchTrees(options.m_search_tree_degree_threshold, max_threads);
+    }
+
+    // It's ok to miss feature files if there are no features.
+    if (m_metadata.m_node_feature_count > 0)
+    {
+        ReadNodeFeaturesData(path, suffix, options.m_block_cache_size / 2);
+    }
+    else
+    {
+        m_node_features = std::make_shared<MemoryStorage<uint8_t>>(path, suffix, nullptr);
+    }
+
     if (m_metadata.m_edge_feature_count > 0)
     {
-        ReadEdgeFeaturesIndex(path, suffix);
-        ReadEdgeFeaturesData(std::move(path), std::move(suffix));
+        ReadEdgeFeaturesData(std::move(path), std::move(suffix), options.m_block_cache_size / 2);
     }
     else
     {
         m_edge_features = std::make_shared<MemoryStorage<uint8_t>>(path, suffix, nullptr);
     }
+    if (storage_type == PartitionStorageType::hybrid && options.m_pinned_features_size > 0)
+    {
+        PinNodeFeatures(options.m_pinned_features_size);
+    }
+    if (options.m_columnar_features && m_storage_type == PartitionStorageType::memory)
+    {
+        BuildFeatureColumns();
+    }
+    if (options.m_dense_features && m_storage_type == PartitionStorageType::memory)
+    {
+        BuildDenseFeatures();
+    }
+    if (options.m_compressed_neighbors)
+    {
+        CompressNeighbors();
+    }
 }
-void Partition::ReadNeighborsIndex(std::filesystem::path path, std::string suffix)
+void Partition::PinNodeFeatures(size_t budget)
 {
-    std::shared_ptr<BaseStorage<uint8_t>> neighbors_index;
+    if (m_node_feature_index.empty())
+    {
+        return;
+    }
+
+    const size_t node_count = m_node_types.size();
+    std::vector<uint64_t> degrees(node_count);
+    if (!m_neighbors_index.empty())
+    {
+        for (size_t node = 0; node < node_count; ++node)
+        {
+            degrees[node] =
+                m_edge_type_offset[m_neighbors_index[node + 1]] - m_edge_type_offset[m_neighbors_index[node]];
+        }
+    }
+
+    // Features of high degree nodes are requested the most often by neighbor sampling in power law graphs.
+    std::vector<uint64_t> order(node_count);
+    std::iota(std::begin(order), std::end(order), 0);
+    std::stable_sort(std::begin(order), std::end(order),
+                     [&degrees](uint64_t left, uint64_t right) { return degrees[left] > degrees[right]; });
+
+    // Nodes with too many features are skipped to fill the budget with next nodes.
+    std::vector<uint64_t> pinned;
+    size_t size = 0;
+    for (auto node : order)
+    {
+        const auto begin = m_node_feature_index[m_node_index[node]];
+        const auto end = m_node_feature_index[m_node_index[node + 1]];
+        if (begin == end || size + (end - begin) > budget)
+        {
+            continue;
+        }
+
+        pinned.emplace_back(node);
+        size += end - begin;
+        if (size == budget)
+        {
+            break;
+        }
+    }
+
+    // Read features in file order.
+    std::sort(std::begin(pinned), std::end(pinned));
+    m_pinned_features.resize(size);
+    m_pinned_nodes.reserve(pinned.size());
+    auto output = std::begin(std::span(m_pinned_features));
+    for (auto node : pinned)
+    {
+        const auto begin = m_node_feature_index[m_node_index[node]];
+        const auto end = m_node_feature_index[m_node_index[node + 1]];
+        m_pinned_nodes.emplace(node, output - std::begin(std::span(m_pinned_features)));
+        output = m_node_features->read(begin, end - begin, output, nullptr);
+    }
+}
+void Partition::BuildFeatureColumns()
+{
+    const auto storage = std::dynamic_pointer_cast<MemoryStorage<uint8_t>>(m_node_features);
+    if (storage == nullptr || m_node_feature_index.empty())
+    {
+        return;
+    }
+
+    // Find features with the same size for every node, zero stride marks features stored node-major.
+    const size_t node_count = m_node_types.size();
+    const uint64_t unknown = std::numeric_limits<uint64_t>::max();
+    std::vector<uint64_t> strides(m_metadata.m_node_feature_count, unknown);
+    for (size_t node = 0; node < node_count; ++node)
+    {
+        if (!HasNodeFeatures(node))
+        {
+            continue;
+        }
+
+        const auto begin = m_node_index[node];
+        const auto end = m_node_index[node + 1];
+        for (size_t feature = 0; feature < strides.size(); ++feature)
+        {
+            const auto entry = begin + feature;
+            const auto size = entry < end ? m_node_feature_index[entry + 1] - m_node_feature_index[entry] : 0;
+            strides[feature] = strides[feature] == unknown || strides[feature] == size ? size : 0;
+        }
+    }
+
+    bool found = false;
+    for (size_t feature = 0; feature < strides.size(); ++feature)
+    {
+        // Quantized features are decoded from the node-major data.
+        if (strides[feature] == unknown || (feature < m_metadata.m_node_feature_quantization.size() &&
+                                            m_metadata.m_node_feature_quantization[feature].m_encoding !=
+                                                FeatureEncoding::float32))
+        {
+            strides[feature] = 0;
+        }
+        found |= strides[feature] > 0;
+    }
+    if (!found)
+    {
+        return;
+    }
+
+    // Rows of nodes without features stay zero.
+    const auto data = storage->view();
+    m_node_feature_columns.resize(strides.size());
+    for (size_t feature = 0; feature < strides.size(); ++feature)
+    {
+        const auto stride = strides[feature];
+        if (stride == 0)
+        {
+            continue;
+        }
+
+        huge_vector<uint8_t> column(node_count * stride);
+        for (size_t node = 0; node < node_count; ++node)
+        {
+            if (HasNodeFeatures(node))
+            {
+                std::copy_n(std::begin(data) + m_node_feature_index[m_node_index[node] + feature], stride,
+                            std::begin(column) + node * stride);
+            }
+        }
+        m_node_feature_columns[feature] =
+            FeatureColumn{.m_stride = stride, .m_data = std::make_shared<MemoryStorage<uint8_t>>(std::move(column))};
+    }
+
+    // Drop columnar features from node-major data, their index entries become empty.
+    huge_vector<uint8_t> rest;
+    std::vector<uint64_t> index(m_node_feature_index.size());
+    size_t node = 0;
+    for (size_t entry = 0; entry < index.size(); ++entry)
+    {
+        index[entry] = rest.size();
+        while (node < node_count && m_node_index[node + 1] <= entry)
+        {
+            ++node;
+        }
+        if (node == node_count || entry < m_node_index[node] || entry + 1 == index.size())
+        {
+            continue;
+        }
+
+        const auto feature = entry - m_node_index[node];
+        if (feature < strides.size() && strides[feature] > 0)
+        {
+            continue;
+        }
+        rest.insert(std::end(rest), std::begin(data) + m_node_feature_index[entry],
+                    std::begin(data) + m_node_feature_index[entry + 1]);
+    }
+    m_node_feature_index = std::move(index);
+    m_node_features = std::make_shared<MemoryStorage<uint8_t>>(std::move(rest));
+}
+void Partition::BuildDenseFeatures()
+{
+    const auto storage = std::dynamic_pointer_cast<MemoryStorage<uint8_t>>(m_node_features);
+    if (storage == nullptr || m_node_feature_index.empty())
+    {
+        return;
+    }
+
+    // Compare feature offsets of every node with the first node of its type.
+    const size_t node_count = m_node_types.size();
+    std::vector<std::vector<uint64_t>> offsets(m_metadata.m_node_type_count);
+    std::vector<uint64_t> rows(offsets.size());
+    std::vector<bool> dense(offsets.size(), true);
+    for (size_t node = 0; node < node_count; ++node)
+    {
+        const auto type = size_t(m_node_types[node]);
+        if (!HasNodeFeatures(node) || type >= offsets.size() || !dense[type])
+        {
+            continue;
+        }
+
+        const auto begin = m_node_index[node];
+        const auto end = m_node_index[node + 1];
+        auto &type_offsets = offsets[type];
+        if (rows[type] == 0)
+        {
+            type_offsets.resize(end - begin + 1);
+            for (size_t entry = begin; entry <= end; ++entry)
+            {
+                type_offsets[entry - begin] = m_node_feature_index[entry] - m_node_feature_index[begin];
+            }
+        }
+        else if (type_offsets.size() != end - begin + 1)
+        {
+            dense[type] = false;
+        }
+        else
+        {
+            for (size_t entry = begin; entry <= end && dense[type]; ++entry)
+            {
+                dense[type] = type_offsets[entry - begin] == m_node_feature_index[entry] - m_node_feature_index[begin];
+            }
+        }
+        ++rows[type];
+    }
+
+    bool found = false;
+    for (size_t type = 0; type < dense.size(); ++type)
+    {
+        dense[type] = dense[type] && rows[type] > 0;
+        found |= dense[type];
+    }
+    if (!found)
+    {
+        return;
+    }
+
+    // Copy nodes of dense types to their tensors and the rest to new node-major data and index.
+    const auto data = storage->view();
+    std::vector<huge_vector<uint8_t>> tensors(offsets.size());
+    for (size_t type = 0; type < dense.size(); ++type)
+    {
+        if (dense[type])
+        {
+            tensors[type].reserve(rows[type] * offsets[type].back());
+            rows[type] = 0;
+        }
+    }
+    m_dense_rows.assign(node_count, 0);
+    huge_vector<uint8_t> rest;
+    std::vector<uint64_t> node_index(m_node_index.size());
+    std::vector<uint64_t> index;
+    for (size_t node = 0; node < node_count; ++node)
+    {
+        node_index[node] = index.size();
+        const auto type = size_t(m_node_types[node]);
+        const auto begin = m_node_index[node];
+        const auto end = m_node_index[node + 1];
+        if (HasNodeFeatures(node) && type < dense.size() && dense[type])
+        {
+            m_dense_rows[node] = rows[type]++;
+            tensors[type].insert(std::end(tensors[type]), std::begin(data) + m_node_feature_index[begin],
+                                 std::begin(data) + m_node_feature_index[end]);
+            continue;
+        }
+
+        for (size_t entry = begin; entry < end; ++entry)
+        {
+            index.emplace_back(rest.size());
+            rest.insert(std::end(rest), std::begin(data) + m_node_feature_index[entry],
+                        std::begin(data) + m_node_feature_index[entry + 1]);
+        }
+    }
+    std::fill(std::begin(node_index) + node_count, std::end(node_index), index.size());
+    index.emplace_back(rest.size());
+
+    m_dense_features.resize(offsets.size());
+    for (size_t type = 0; type < dense.size(); ++type)
+    {
+        if (dense[type])
+        {
+            m_dense_features[type] =
+                DenseFeatures{.m_offsets = std::move(offsets[type]),
+                              .m_data = std::make_shared<MemoryStorage<uint8_t>>(std::move(tensors[type]))};
+        }
+    }
+    m_node_index = std::move(node_index);
+    m_node_feature_index = std::move(index);
+    m_node_features = std::make_shared<MemoryStorage<uint8_t>>(std::move(rest));
+}
+bool Partition::ReadSnapshot(std::filesystem::path path, std::string suffix)
+{
+    SnapshotReader snapshot(std::move(path), std::move(suffix));
+    if (!snapshot.Valid())
+    {
+        return false;
+    }
+
+    snapshot.Read(SnapshotArray::node_types, m_node_types);
+    snapshot.Read(SnapshotArray::node_index, m_node_index);
+    snapshot.Read(SnapshotArray::node_feature_index, m_node_feature_index);
+    snapshot.Read(SnapshotArray::edge_feature_index, m_edge_feature_index);
+    snapshot.Read(SnapshotArray::edge_feature_offset, m_edge_feature_offset);
+    snapshot.Read(SnapshotArray::edge_types, m_edge_types);
+    snapshot.Read(SnapshotArray::edge_type_offset, m_edge_type_offset);
+    snapshot.Read(SnapshotArray::edge_destination, m_edge_destination);
+    snapshot.Read(SnapshotArray::edge_weights, m_edge_weights);
+    snapshot.Read(SnapshotArray::neighbors_index, m_neighbors_index);
+    return true;
+}
+void Partition::WriteSnapshot(std::filesystem::path path, std::string suffix) const
+{
+    if (is_hdfs_path(path))
+    {
+        RAW_LOG_FATAL("Snapshots are supported only for local partitions");
+    }
+    if (!m_node_feature_columns.empty() || !m_dense_features.empty())
+    {
+        RAW_LOG_FATAL("Snapshots can't be written from partitions with columnar or dense features");
+    }
+    if (!m_compressed_destination.empty() || m_neighbor_ids != nullptr)
+    {
+        RAW_LOG_FATAL("Snapshots can't be written from partitions with compressed or compact neighbors");
+    }
+
+    // Node ids are not needed to serve requests, so they are loaded only for the snapshot.
+    std::vector<NodeId> node_ids(m_node_types.size());
+    DiskStorage<uint8_t> node_map(path, suffix, open_node_map);
+    if (node_map.size() != node_ids.size() * sizeof(NodeMapRecord))
+    {
+        RAW_LOG_FATAL("Node map doesn't match partition");
+    }
+    read_records<NodeMapRecord>(node_map, node_map.start(), node_ids.size(),
+                                [&node_ids](size_t offset, std::span<const NodeMapRecord> records) {
+                                    for (size_t i = 0; i < records.size(); ++i)
+                                    {
+                                        node_ids[offset + i] = records[i].m_node_id;
+                                    }
+                                });
+
+    SnapshotWriter snapshot;
+    snapshot.Add<NodeId>(SnapshotArray::node_ids, node_ids);
+    snapshot.Add<Type>(SnapshotArray::node_types, m_node_types);
+    snapshot.Add<uint64_t>(SnapshotArray::node_index, m_node_index);
+    snapshot.Add<uint64_t>(SnapshotArray::node_feature_index, m_node_feature_index);
+    snapshot.Add<uint64_t>(SnapshotArray::edge_feature_index, m_edge_feature_index);
+    snapshot.Add<uint64_t>(SnapshotArray::edge_feature_offset, m_edge_feature_offset);
+    snapshot.Add<Type>(SnapshotArray::edge_types, m_edge_types);
+    snapshot.Add<uint64_t>(SnapshotArray::edge_type_offset, m_edge_type_offset);
+    snapshot.Add<NodeId>(SnapshotArray::edge_destination, m_edge_destination);
+    // Unit weights are restored, so snapshots are the same for weighted and unweighted partitions.
+    huge_vector<float> unit_edge_weights;
+    if (m_unit_edge_weights)
+    {
+        unit_edge_weights.resize(m_edge_type_offset.back());
+        for (size_t i = 0; i + 1 < m_edge_type_offset.size(); ++i)
+        {
+            std::iota(std::begin(unit_edge_weights) + m_edge_type_offset[i],
+                      std::begin(unit_edge_weights) + m_edge_type_offset[i + 1], 1.0f);
+        }
+    }
+    snapshot.Add<float>(SnapshotArray::edge_weights, m_unit_edge_weights ? unit_edge_weights : m_edge_weights);
+    snapshot.Add<uint64_t>(SnapshotArray::neighbors_index, m_neighbors_index);
+    snapshot.Write(std::move(path), std::move(suffix));
+}
+void Partition::ReadNodeMap(std::filesystem::path path, std::string suffix)
+{
+    std::shared_ptr<BaseStorage<uint8_t>> node_map;
     if (!is_hdfs_path(path))
     {
-        neighbors_index =
-            std::make_shared<DiskStorage<uint8_t>>(std::move(path), std::move(suffix), open_neighbor_index);
+        node_map = std::make_shared<DiskStorage<uint8_t>>(std::move(path), std::move(suffix), open_node_map);
     }
     else
     {
-        auto full_path = path / ("neighbors_" + suffix + ".index");
-        neighbors_index = std::make_shared<HDFSStreamStorage<uint8_t>>(full_path.c_str(), m_metadata.m_config_path);
+        auto full_path = path / ("node_" + suffix + ".map");
+        node_map = std::make_shared<HDFSStreamStorage<uint8_t>>(full_path.c_str(), m_metadata.m_config_path);
+    }
+    auto node_map_ptr = node_map->start();
+    size_t size = node_map->size() / sizeof(NodeMapRecord);
+    m_node_types.resize(size);
+    read_records<NodeMapRecord>(*node_map, node_map_ptr, size,
+                                [this](size_t offset, std::span<const NodeMapRecord> records) {
+                                    auto out = m_node_types.data() + offset;
+                                    for (size_t i = 0; i < records.size(); ++i)
+                                    {
+                                        out[i] = records[i].m_type;
+                                    }
+                                });
+}
+void Partition::ReadNeighborsIndex(std::filesystem::path path, std::string suffix)
+{
+    std::shared_ptr<BaseStorage<uint8_t>> neighbors_index;
+    if (!is_hdfs_path(path))
+    {
+        neighbors_index =
+            std::make_shared<DiskStorage<uint8_t>>(std::move(path), std::move(suffix), open_neighbor_index);
+    }
+    else
+    {
+        auto full_path = path / ("neighbors_" + suffix + ".index");
+        neighbors_index = std::make_shared<HDFSStreamStorage<uint8_t>>(full_path.c_str(), m_metadata.m_config_path);
     }
     auto neighbors_index_ptr = neighbors_index->start();
     size_t size_64 = neighbors_index->size() / 8;
@@ -99,226 +717,800 @@ void Partition::ReadNeighborsIndex(std::filesystem::path path, std::string suffi
         RAW_LOG_FATAL("Failed to read neighbor index file");
     }
 }
-void Partition::ReadEdgeIndex(std::filesystem::path path, std::string suffix)
+void Partition::ReadEdgeIndex(std::filesystem::path path, std::string suffix)
+{
+    assert(sizeof(EdgeRecord) == (sizeof(NodeId) + sizeof(uint64_t) + sizeof(Type) + sizeof(float)));
+    std::shared_ptr<BaseStorage<uint8_t>> edge_index;
+    if (!is_hdfs_path(path))
+    {
+        edge_index = std::make_shared<DiskStorage<uint8_t>>(std::move(path), std::move(suffix), open_edge_index);
+    }
+    else
+    {
+        auto full_path = path / ("edge_" + suffix + ".index");
+        edge_index = std::make_shared<HDFSStreamStorage<uint8_t>>(full_path.c_str(), m_metadata.m_config_path);
+    }
+    auto edge_index_ptr = edge_index->start();
+    size_t num_edges = edge_index->size() / sizeof(EdgeRecord);
+    if (num_edges == 0)
+    {
+        RAW_LOG_FATAL("Failed to read edge index file");
+    }
+
+    const bool has_edge_features = m_metadata.m_edge_feature_count > 0;
+    m_edge_destination.resize(num_edges);
+    m_edge_weights.resize(num_edges);
+    if (has_edge_features)
+    {
+        m_edge_feature_offset.resize(num_edges);
+    }
+
+    // Edges are sorted by source node and type, track where we are while streaming records.
+    size_t curr_src = 0;
+    size_t src_edges_left = 0;
+    Type curr_type = -1;
+    float acc_weight = 0;
+    size_t edge_count = 0;
+    bool padding_read = false;
+    read_records<EdgeRecord>(
+        *edge_index, edge_index_ptr, num_edges, [&](size_t offset, std::span<const EdgeRecord> records) {
+            // Split records into columns first, it is a simple loop compilers can vectorize.
+            auto dst = m_edge_destination.data() + offset;
+            auto weights = m_edge_weights.data() + offset;
+            for (size_t i = 0; i < records.size(); ++i)
+            {
+                dst[i] = records[i].m_dst;
+                weights[i] = records[i].m_weight;
+            }
+            if (has_edge_features)
+            {
+                auto feature_offsets = m_edge_feature_offset.data() + offset;
+                for (size_t i = 0; i < records.size(); ++i)
+                {
+                    feature_offsets[i] = records[i].m_feature_offset;
+                }
+            }
+
+            for (size_t i = 0; i < records.size() && !padding_read; ++i)
+            {
+                while (src_edges_left == 0 && curr_src + 1 < m_neighbors_index.size())
+                {
+                    src_edges_left = m_neighbors_index[curr_src + 1] - m_neighbors_index[curr_src];
+                    m_neighbors_index[curr_src] = m_edge_types.size();
+                    ++curr_src;
+                    curr_type = -1;
+                }
+
+                if (src_edges_left == 0)
+                {
+                    // Extra padding to simplify edge type count calculations.
+                    edge_count = offset + i;
+                    m_neighbors_index.back() = m_edge_types.size();
+                    m_edge_types.push_back(records[i].m_type);
+                    m_edge_type_offset.push_back(edge_count);
+                    padding_read = true;
+                    break;
+                }
+
+                if (records[i].m_type != curr_type)
+                {
+                    curr_type = records[i].m_type;
+                    m_edge_types.emplace_back(curr_type);
+                    m_edge_type_offset.emplace_back(offset + i);
+                    acc_weight = 0;
+                }
+
+                // Accumulate weights for faster binary search in sampling
+                acc_weight += weights[i];
+                weights[i] = acc_weight;
+                --src_edges_left;
+            }
+        });
+
+    if (!padding_read)
+    {
+        RAW_LOG_FATAL("Failed to read edge index file");
+    }
+
+    m_edge_destination.resize(edge_count + 1);
+    m_edge_weights.resize(edge_count);
+    if (has_edge_features)
+    {
+        m_edge_feature_offset.resize(edge_count + 1);
+    }
+}
+void Partition::ReadNodeIndex(std::filesystem::path path, std::string suffix)
+{
+    std::shared_ptr<BaseStorage<uint8_t>> node_index;
+    if (!is_hdfs_path(path))
+    {
+        node_index = std::make_shared<DiskStorage<uint8_t>>(std::move(path), std::move(suffix), open_node_index);
+    }
+    else
+    {
+        auto full_path = path / ("node_" + suffix + ".index");
+        node_index = std::make_shared<HDFSStreamStorage<uint8_t>>(full_path.c_str(), m_metadata.m_config_path);
+    }
+    auto node_index_ptr = node_index->start();
+    size_t size = node_index->size() / 8;
+    m_node_index.resize(size);
+    if (size != node_index->read(m_node_index.data(), 8, size, node_index_ptr))
+    {
+        RAW_LOG_FATAL("Failed to read node index file");
+    }
+}
+void Partition::ReadNodeFeaturesIndex(std::filesystem::path path, std::string suffix)
+{
+    std::shared_ptr<BaseStorage<uint8_t>> node_features_index;
+    if (!is_hdfs_path(path))
+    {
+        node_features_index =
+            std::make_shared<DiskStorage<uint8_t>>(std::move(path), std::move(suffix), open_node_features_index);
+    }
+    else
+    {
+        auto full_path = path / ("node_features_" + suffix + ".index");
+        node_features_index = std::make_shared<HDFSStreamStorage<uint8_t>>(full_path.c_str(), m_metadata.m_config_path);
+    }
+    auto node_features_index_ptr = node_features_index->start();
+    size_t size = node_features_index->size() / 8;
+    m_node_feature_index.resize(size);
+    if (size != node_features_index->read(m_node_feature_index.data(), 8, size, node_features_index_ptr))
+    {
+        RAW_LOG_FATAL("Failed to read node feature index file");
+    }
+}
+void Partition::ReadNodeFeaturesData(std::filesystem::path path, std::string suffix, size_t block_cache_size)
+{
+    if (is_hdfs_path(path))
+    {
+        auto full_path = path / ("node_features_" + suffix + ".data");
+        m_node_features = std::make_shared<HDFSStorage<uint8_t>>(full_path.c_str(), m_metadata.m_config_path,
+                                                                 std::move(suffix), &open_node_features_data);
+    }
+    else if (m_storage_type == PartitionStorageType::memory)
+    {
+        m_node_features =
+            std::make_shared<MemoryStorage<uint8_t>>(std::move(path), std::move(suffix), &open_node_features_data);
+    }
+    else if (m_storage_type == PartitionStorageType::disk && has_compressed_data(path, "node_features_" + suffix))
+    {
+        m_node_features = std::make_shared<CompressedStorage>(std::move(path), std::move(suffix),
+                                                              &open_node_features_compressed, block_cache_size);
+    }
+    else if (m_storage_type == PartitionStorageType::disk)
+    {
+        m_node_features =
+            std::make_shared<DiskStorage<uint8_t>>(std::move(path), std::move(suffix), &open_node_features_data);
+    }
+    else if (m_storage_type == PartitionStorageType::mmap)
+    {
+        m_node_features =
+            std::make_shared<MmapStorage<uint8_t>>(std::move(path), std::move(suffix), &open_node_features_data);
+    }
+}
+void Partition::ReadEdgeFeaturesIndex(std::filesystem::path path, std::string suffix)
+{
+    std::shared_ptr<BaseStorage<uint8_t>> edge_features_index;
+    if (!is_hdfs_path(path))
+    {
+        edge_features_index =
+            std::make_shared<DiskStorage<uint8_t>>(std::move(path), std::move(suffix), open_edge_features_index);
+    }
+    else
+    {
+        auto full_path = path / ("edge_features_" + suffix + ".index");
+        edge_features_index = std::make_shared<HDFSStreamStorage<uint8_t>>(full_path.c_str(), m_metadata.m_config_path);
+    }
+    auto edge_features_index_ptr = edge_features_index->start();
+    size_t size = edge_features_index->size();
+    size_t size_64 = size / 8;
+    m_edge_feature_index.resize(size_64);
+    if (size != edge_features_index->read(m_edge_feature_index.data(), 1, size, edge_features_index_ptr))
+    {
+        RAW_LOG_FATAL("Failed to read node feature index file");
+    }
+}
+void Partition::ReadEdgeFeaturesData(std::filesystem::path path, std::string suffix, size_t block_cache_size)
+{
+    if (is_hdfs_path(path))
+    {
+        auto full_path = path / ("edge_features_" + suffix + ".data");
+        m_edge_features = std::make_shared<HDFSStorage<uint8_t>>(full_path.c_str(), m_metadata.m_config_path,
+                                                                 std::move(suffix), &open_edge_features_data);
+    }
+    else if (m_storage_type == PartitionStorageType::memory)
+    {
+        m_edge_features =
+            std::make_shared<MemoryStorage<uint8_t>>(std::move(path), std::move(suffix), &open_edge_features_data);
+    }
+    else if (m_storage_type == PartitionStorageType::disk && has_compressed_data(path, "edge_features_" + suffix))
+    {
+        m_edge_features = std::make_shared<CompressedStorage>(std::move(path), std::move(suffix),
+                                                              &open_edge_features_compressed, block_cache_size);
+    }
+    else if (m_storage_type == PartitionStorageType::disk)
+    {
+        m_edge_features =
+            std::make_shared<DiskStorage<uint8_t>>(std::move(path), std::move(suffix), &open_edge_features_data);
+    }
+    else if (m_storage_type == PartitionStorageType::mmap)
+    {
+        m_edge_features =
+            std::make_shared<MmapStorage<uint8_t>>(std::move(path), std::move(suffix), &open_edge_features_data);
+    }
+}
+void Partition::PrefetchNode(uint64_t internal_node_id) const
+{
+    prefetch(&m_node_types[internal_node_id]);
+    if (!m_node_index.empty())
+    {
+        prefetch(&m_node_index[internal_node_id]);
+    }
+    if (!m_dense_rows.empty())
+    {
+        prefetch(&m_dense_rows[internal_node_id]);
+    }
+}
+
+void Partition::PrefetchNeighbors(uint64_t internal_node_id) const
+{
+    prefetch(&m_neighbors_index[internal_node_id]);
+}
+
+Type Partition::GetNodeType(uint64_t internal_node_id) const
+{
+    return m_node_types[internal_node_id];
+}
+
+bool Partition::HasNodeFeatures(uint64_t internal_node_id) const
+{
+    return GetNodeType(internal_node_id) != snark::PLACEHOLDER_NODE_TYPE;
+}
+
+bool Partition::GetNodeFeature(uint64_t internal_id, std::span<snark::FeatureMeta> features,
+                               std::span<uint8_t> output) const
+{
+    return GetNodeFeature(internal_id, features, output, nullptr, nullptr);
+}
+
+bool Partition::GetNodeFeature(uint64_t internal_id, std::span<snark::FeatureMeta> features, std::span<uint8_t> output,
+                               std::vector<ReadRequest> *requests, std::vector<PendingNodeFeature> *pending) const
+{
+    if (!HasNodeFeatures(internal_id))
+        return false;
+
+    auto curr = std::begin(output);
+    if (const auto dense = GetDenseFeatures(internal_id); dense != nullptr)
+    {
+        // Features of dense types are located in the row of the node without index lookups.
+        const auto row = dense->m_data->view().data() + m_dense_rows[internal_id] * dense->m_offsets.back();
+        for (const auto &[feature_id, feature_size] : features)
+        {
+            uint64_t stride = 0;
+            if (const auto column = GetNodeFeatureColumn(feature_id, stride); column != nullptr)
+            {
+                curr = copy_feature(column + internal_id * stride, stride, feature_size, curr);
+                continue;
+            }
+            if (feature_id < 0 || size_t(feature_id) + 1 >= dense->m_offsets.size())
+            {
+                curr = std::fill_n(curr, feature_size, 0);
+                continue;
+            }
+
+            const auto data_offset = dense->m_offsets[feature_id];
+            const auto stored_size = dense->m_offsets[feature_id + 1] - data_offset;
+            if (size_t(feature_id) < m_metadata.m_node_feature_quantization.size() &&
+                m_metadata.m_node_feature_quantization[feature_id].m_encoding != FeatureEncoding::float32)
+            {
+                curr = ReadQuantizedFeature(m_metadata.m_node_feature_quantization[feature_id], data_offset,
+                                            stored_size, feature_size, curr, row + data_offset);
+                continue;
+            }
+            curr = copy_feature(row + data_offset, stored_size, feature_size, curr);
+        }
+        return true;
+    }
+
+    const auto feature_index_offset = m_node_index[internal_id];
+    const auto next_offset = m_node_index[internal_id + 1];
+
+    // Pinned and cached nodes are served from memory, misses read all features of the node at once to cache them.
+    if (auto pinned = m_pinned_nodes.find(internal_id); pinned != std::end(m_pinned_nodes))
+    {
+        CopyNodeFeature(internal_id, features, output, m_pinned_features.data() + pinned->second,
+                        m_node_feature_index[feature_index_offset], requests);
+        return true;
+    }
+    if (m_feature_cache == nullptr || m_node_feature_index.empty())
+    {
+        CopyNodeFeature(internal_id, features, output, nullptr, 0, requests);
+        return true;
+    }
+
+    const auto begin = m_node_feature_index[feature_index_offset];
+    const auto end = m_node_feature_index[next_offset];
+    FILE *file = requests == nullptr ? nullptr : m_node_features->handle();
+    if (file == nullptr)
+    {
+        const auto cached = GetCachedFeatures(*m_node_features, internal_id, begin, end);
+        CopyNodeFeature(internal_id, features, output, cached->data(), begin, nullptr);
+        return true;
+    }
+    if (const auto cached = m_feature_cache->Get(internal_id))
+    {
+        CopyNodeFeature(internal_id, features, output, cached->data(), begin, nullptr);
+        return true;
+    }
+
+    // Misses are read with the rest of the batch instead of one synchronous read per node.
+    auto data = std::make_shared<std::vector<uint8_t>>(end - begin);
+    if (!data->empty())
+    {
+        requests->emplace_back(ReadRequest{file, begin, data->size(), data->data()});
+    }
+    pending->emplace_back(PendingNodeFeature{this, internal_id, features, output, std::move(data)});
+    return true;
+}
+
+void Partition::FinishNodeFeature(const PendingNodeFeature &pending) const
+{
+    m_feature_cache->Put(pending.m_internal_id, pending.m_data);
+    CopyNodeFeature(pending.m_internal_id, pending.m_features, pending.m_output, pending.m_data->data(),
+                    m_node_feature_index[m_node_index[pending.m_internal_id]], nullptr);
+}
+
+void Partition::CopyNodeFeature(uint64_t internal_id, std::span<snark::FeatureMeta> features,
+                                std::span<uint8_t> output, const uint8_t *in_memory, uint64_t in_memory_offset,
+                                std::vector<ReadRequest> *requests) const
+{
+    FILE *file = requests == nullptr ? nullptr : m_node_features->handle();
+    const auto feature_index_offset = m_node_index[internal_id];
+    const auto next_offset = m_node_index[internal_id + 1];
+    auto curr = std::begin(output);
+    for (const auto &feature : features)
+    {
+        const auto feature_id = feature.first;
+        const auto feature_size = feature.second;
+        uint64_t stride = 0;
+        if (const auto column = GetNodeFeatureColumn(feature_id, stride); column != nullptr)
+        {
+            curr = copy_feature(column + internal_id * stride, stride, feature_size, curr);
+            continue;
+        }
+
+        // Requested feature_id is larger than known features, fill with 0s.
+        if (next_offset - feature_index_offset <= uint64_t(feature_id) || m_node_feature_index.empty())
+        {
+            curr = std::fill_n(curr, feature_size, 0);
+            continue;
+        }
+        const auto data_offset = m_node_feature_index[feature_index_offset + feature_id];
+        const auto stored_size = m_node_feature_index[feature_index_offset + feature_id + 1] - data_offset;
+        if (size_t(feature_id) < m_metadata.m_node_feature_quantization.size() &&
+            m_metadata.m_node_feature_quantization[feature_id].m_encoding != FeatureEncoding::float32)
+        {
+            curr = ReadQuantizedFeature(m_metadata.m_node_feature_quantization[feature_id], data_offset, stored_size,
+                                        feature_size, curr,
+                                        in_memory == nullptr ? nullptr : in_memory + data_offset - in_memory_offset);
+            continue;
+        }
+
+        const auto read_size = std::min<uint64_t>(feature_size, stored_size);
+        if (in_memory != nullptr)
+        {
+            curr = std::copy_n(in_memory + data_offset - in_memory_offset, read_size, curr);
+        }
+        else if (file != nullptr)
+        {
+            requests->emplace_back(
+                ReadRequest{file, data_offset, read_size, output.data() + (curr - std::begin(output))});
+            curr += read_size;
+        }
+        else
+        {
+            curr = m_node_features->read(data_offset, read_size, curr, nullptr);
+        }
+        if (stored_size < feature_size)
+        {
+            curr = std::fill_n(curr, feature_size - stored_size, 0);
+        }
+    }
+}
+
+std::span<uint8_t>::iterator Partition::ReadQuantizedFeature(const FeatureQuantization &quantization,
+                                                             uint64_t data_offset, uint64_t stored_size,
+                                                             uint64_t feature_size,
+                                                             std::span<uint8_t>::iterator output,
+                                                             const uint8_t *cached) const
 {
-    assert(sizeof(EdgeRecord) == (sizeof(NodeId) + sizeof(uint64_t) + sizeof(Type) + sizeof(float)));
-    std::shared_ptr<BaseStorage<uint8_t>> edge_index;
-    if (!is_hdfs_path(path))
+    // Encoded values are read synchronously even for disk storage, they have to be decoded before returning.
+    const auto value_size = encoded_value_size(quantization.m_encoding);
+    const auto count = std::min<uint64_t>(feature_size / sizeof(float), stored_size / value_size);
+    std::vector<uint8_t> buffer;
+    if (cached == nullptr)
+    {
+        buffer.resize(count * value_size);
+        m_node_features->read(data_offset, buffer.size(), std::begin(std::span(buffer)), nullptr);
+        cached = buffer.data();
+    }
+    dequantize(quantization, cached, count, &*output);
+    output += count * sizeof(float);
+    return std::fill_n(output, feature_size - count * sizeof(float), 0);
+}
+
+const uint8_t *Partition::GetNodeFeatureColumn(FeatureId feature, uint64_t &stride) const
+{
+    if (feature < 0 || size_t(feature) >= m_node_feature_columns.size() ||
+        m_node_feature_columns[feature].m_stride == 0)
     {
-        edge_index = std::make_shared<DiskStorage<uint8_t>>(std::move(path), std::move(suffix), open_edge_index);
+        return nullptr;
     }
-    else
+
+    stride = m_node_feature_columns[feature].m_stride;
+    return m_node_feature_columns[feature].m_data->view().data();
+}
+
+void Partition::DropUnitEdgeWeights()
+{
+    if (m_edge_weights.empty())
     {
-        auto full_path = path / ("edge_" + suffix + ".index");
-        edge_index = std::make_shared<HDFSStreamStorage<uint8_t>>(full_path.c_str(), m_metadata.m_config_path);
+        return;
     }
-    auto edge_index_ptr = edge_index->start();
-    size_t num_edges = edge_index->size() / sizeof(EdgeRecord);
-    m_edge_weights.reserve(num_edges);
-    size_t next = 1;
-    for (size_t curr_src = 0; next < m_neighbors_index.size(); ++curr_src, ++next)
+
+    for (size_t i = 0; i + 1 < m_edge_type_offset.size(); ++i)
     {
-        size_t start_offset = m_neighbors_index[curr_src];
-        size_t end_offset = m_neighbors_index[next];
-        m_neighbors_index[curr_src] = m_edge_types.size();
-        size_t nb_count = end_offset - start_offset;
-        if (nb_count == 0)
+        const auto first = m_edge_type_offset[i];
+        for (auto edge = first; edge < m_edge_type_offset[i + 1]; ++edge)
         {
-            continue;
-        }
-        Type curr_type = -1;
-        // Accumulate weights for faster binary search in sampling
-        float acc_weight = 0;
-        for (size_t curr = start_offset; curr < end_offset; ++curr)
-        {
-            EdgeRecord edge;
-            if (1 != edge_index->read(&edge, sizeof(EdgeRecord), 1, edge_index_ptr))
-            {
-                RAW_LOG_FATAL("Failed to read edge index file");
-            }
-            if (edge.m_type != curr_type)
-            {
-                curr_type = edge.m_type;
-                m_edge_types.emplace_back(curr_type);
-                m_edge_type_offset.emplace_back(m_edge_destination.size());
-                acc_weight = 0;
-            }
-            m_edge_destination.push_back(edge.m_dst);
-            acc_weight += edge.m_weight;
-            m_edge_weights.push_back(acc_weight);
-            if (m_metadata.m_edge_feature_count > 0)
+            if (m_edge_weights[edge] != float(edge - first + 1))
             {
-                m_edge_feature_offset.push_back(edge.m_feature_offset);
+                return;
             }
         }
     }
-    EdgeRecord edge;
-    if (1 != edge_index->read(&edge, sizeof(EdgeRecord), 1, edge_index_ptr))
+
+    m_unit_edge_weights = true;
+    huge_vector<float>().swap(m_edge_weights);
+}
+
+float Partition::GetCumulativeWeight(uint64_t first, uint64_t edge) const
+{
+    return m_unit_edge_weights ? float(edge - first + 1) : m_edge_weights[edge];
+}
+
+void Partition::BuildAliasTables(uint64_t degree_threshold, size_t max_threads)
+{
+    // Unit weights are already sampled by index.
+    if (m_unit_edge_weights || m_edge_weights.empty())
     {
-        RAW_LOG_FATAL("Failed to read edge index file");
+        return;
     }
-    // Extra padding to simplify edge type count calculations.
-    m_neighbors_index.back() = m_edge_types.size();
-    m_edge_types.push_back(edge.m_type);
-    m_edge_type_offset.push_back(m_edge_destination.size());
-    m_edge_destination.push_back(edge.m_dst);
-    if (m_metadata.m_edge_feature_count > 0)
+
+    // Type runs with their table offsets.
+    std::vector<std::pair<uint64_t, uint64_t>> runs;
+    uint64_t size = 0;
+    for (size_t i = 0; i + 1 < m_edge_type_offset.size(); ++i)
     {
-        m_edge_feature_offset.push_back(edge.m_feature_offset);
+        const auto first = m_edge_type_offset[i];
+        const auto run_size = m_edge_type_offset[i + 1] - first;
+        if (run_size < std::max<uint64_t>(degree_threshold, 1) || run_size > std::numeric_limits<uint32_t>::max() ||
+            !(m_edge_weights[first + run_size - 1] > 0))
+        {
+            continue;
+        }
+
+        m_alias_offsets[i] = size;
+        runs.emplace_back(i, size);
+        size += run_size;
     }
-}
-void Partition::ReadNodeFeatures(std::filesystem::path path, std::string suffix)
-{
-    ReadNodeIndex(path, suffix);
-    if (m_metadata.m_node_feature_count == 0)
+
+    if (runs.empty())
     {
-        // It's ok to miss files if there are no features.
-        m_node_features = std::make_shared<MemoryStorage<uint8_t>>(path, suffix, nullptr);
         return;
     }
-    ReadNodeFeaturesIndex(path, suffix);
-    ReadNodeFeaturesData(path, suffix);
+
+    m_alias_tables.resize(size);
+    parallel_for(
+        runs.size(),
+        [&](size_t index) {
+            const auto [run, offset] = runs[index];
+            const auto first = m_edge_type_offset[run];
+            const auto run_size = m_edge_type_offset[run + 1] - first;
+            build_alias_table(std::span<const float>(m_edge_weights).subspan(first, run_size),
+                              std::span(m_alias_tables).subspan(offset, run_size));
+        },
+        max_threads);
+
+    RAW_LOG_INFO("Built alias tables for %lu edges of %lu nodes and types", size, runs.size());
 }
-void Partition::ReadNodeIndex(std::filesystem::path path, std::string suffix)
+
+void Partition::BuildSearchTrees(uint64_t degree_threshold, size_t max_threads)
 {
-    std::shared_ptr<BaseStorage<uint8_t>> node_index;
-    if (!is_hdfs_path(path))
+    if (m_unit_edge_weights || m_edge_weights.empty())
     {
-        node_index = std::make_shared<DiskStorage<uint8_t>>(std::move(path), std::move(suffix), open_node_index);
+        return;
     }
-    else
+
+    // Type runs with their tree offsets, runs of a single block keep the binary search.
+    std::vector<std::pair<uint64_t, uint64_t>> runs;
+    uint64_t size = 0;
+    for (size_t i = 0; i + 1 < m_edge_type_offset.size(); ++i)
     {
-        auto full_path = path / ("node_" + suffix + ".index");
-        node_index = std::make_shared<HDFSStreamStorage<uint8_t>>(full_path.c_str(), m_metadata.m_config_path);
+        const auto run_size = m_edge_type_offset[i + 1] - m_edge_type_offset[i];
+        if (run_size < degree_threshold || run_size <= search_tree_fanout || m_alias_offsets.contains(i))
+        {
+            continue;
+        }
+
+        m_search_tree_offsets[i] = size;
+        runs.emplace_back(i, size);
+        size += search_tree_size(run_size);
     }
-    auto node_index_ptr = node_index->start();
-    size_t size = node_index->size() / 8;
-    m_node_index.resize(size);
-    if (size != node_index->read(m_node_index.data(), 8, size, node_index_ptr))
+
+    if (runs.empty())
     {
-        RAW_LOG_FATAL("Failed to read node index file");
+        return;
     }
+
+    m_search_trees.resize(size);
+    parallel_for(
+        runs.size(),
+        [&](size_t index) {
+            const auto [run, offset] = runs[index];
+            const auto first = m_edge_type_offset[run];
+            const auto run_size = m_edge_type_offset[run + 1] - first;
+            build_search_tree(std::span<const float>(m_edge_weights).subspan(first, run_size),
+                              std::span(m_search_trees).subspan(offset, search_tree_size(run_size)));
+        },
+        max_threads);
+
+    RAW_LOG_INFO("Built search trees of %lu weights for %lu nodes and types", size, runs.size());
 }
-void Partition::ReadNodeFeaturesIndex(std::filesystem::path path, std::string suffix)
+
+void Partition::CompressNeighbors()
 {
-    std::shared_ptr<BaseStorage<uint8_t>> node_features_index;
-    if (!is_hdfs_path(path))
+    if (m_edge_destination.empty())
     {
-        node_features_index =
-            std::make_shared<DiskStorage<uint8_t>>(std::move(path), std::move(suffix), open_node_features_index);
+        return;
     }
-    else
+
+    m_compressed_destination = CompressedNeighbors(m_edge_destination);
+    RAW_LOG_INFO("Compressed %lu neighbors from %lu to %lu bytes", m_edge_destination.size(),
+                 m_edge_destination.size() * sizeof(NodeId), m_compressed_destination.memory_size());
+    huge_vector<NodeId>().swap(m_edge_destination);
+}
+
+std::shared_ptr<const huge_vector<NodeId>> Partition::NeighborIdTable(std::span<const Partition> partitions)
+{
+    std::vector<std::vector<NodeId>> partition_ids(partitions.size());
+    parallel_for(partitions.size(), [&](size_t index) {
+        const auto &partition = partitions[index];
+        const auto size = partition.m_compressed_destination.empty() ? partition.m_edge_destination.size()
+                                                                     : partition.m_compressed_destination.size();
+        auto &ids = partition_ids[index];
+        ids.resize(size);
+        partition.GetEdgeDestinations(0, size, ids.data());
+        std::sort(std::begin(ids), std::end(ids));
+        ids.erase(std::unique(std::begin(ids), std::end(ids)), std::end(ids));
+    });
+
+    auto table = std::make_shared<huge_vector<NodeId>>();
+    for (auto &ids : partition_ids)
     {
-        auto full_path = path / ("node_features_" + suffix + ".index");
-        node_features_index = std::make_shared<HDFSStreamStorage<uint8_t>>(full_path.c_str(), m_metadata.m_config_path);
+        table->insert(std::end(*table), std::begin(ids), std::end(ids));
+        std::vector<NodeId>().swap(ids);
     }
-    auto node_features_index_ptr = node_features_index->start();
-    size_t size = node_features_index->size() / 8;
-    m_node_feature_index.resize(size);
-    if (size != node_features_index->read(m_node_feature_index.data(), 8, size, node_features_index_ptr))
+    std::sort(std::begin(*table), std::end(*table));
+    table->erase(std::unique(std::begin(*table), std::end(*table)), std::end(*table));
+    if (table->size() > std::numeric_limits<uint32_t>::max())
     {
-        RAW_LOG_FATAL("Failed to read node feature index file");
+        RAW_LOG_WARNING("Too many neighbors for compact neighbor ids: %lu", table->size());
+        return nullptr;
     }
+
+    return table;
 }
-void Partition::ReadNodeFeaturesData(std::filesystem::path path, std::string suffix)
+
+void Partition::CompactNeighborIds(std::shared_ptr<const huge_vector<NodeId>> neighbor_ids)
 {
-    if (is_hdfs_path(path))
+    if (neighbor_ids == nullptr || m_neighbor_ids != nullptr)
     {
-        auto full_path = path / ("node_features_" + suffix + ".data");
-        m_node_features = std::make_shared<HDFSStorage<uint8_t>>(full_path.c_str(), m_metadata.m_config_path,
-                                                                 std::move(suffix), &open_node_features_data);
+        return;
     }
-    else if (m_storage_type == PartitionStorageType::memory)
+
+    const bool compressed = !m_compressed_destination.empty();
+    std::vector<NodeId> destinations(compressed ? m_compressed_destination.size() : m_edge_destination.size());
+    GetEdgeDestinations(0, destinations.size(), destinations.data());
+    const auto &ids = *neighbor_ids;
+    auto compact_id = [&ids](NodeId id) {
+        return uint32_t(std::lower_bound(std::begin(ids), std::end(ids), id) - std::begin(ids));
+    };
+
+    // Dense ids have smaller differences, so compressed neighbors become even smaller.
+    if (compressed)
     {
-        m_node_features =
-            std::make_shared<MemoryStorage<uint8_t>>(std::move(path), std::move(suffix), &open_node_features_data);
+        std::transform(std::begin(destinations), std::end(destinations), std::begin(destinations), compact_id);
+        m_compressed_destination = CompressedNeighbors(destinations);
     }
-    else if (m_storage_type == PartitionStorageType::disk)
+    else
     {
-        m_node_features =
-            std::make_shared<DiskStorage<uint8_t>>(std::move(path), std::move(suffix), &open_node_features_data);
+        m_compact_destination.resize(destinations.size());
+        std::transform(std::begin(destinations), std::end(destinations), std::begin(m_compact_destination),
+                       compact_id);
+        huge_vector<NodeId>().swap(m_edge_destination);
     }
+    m_neighbor_ids = std::move(neighbor_ids);
 }
-void Partition::ReadEdgeFeaturesIndex(std::filesystem::path path, std::string suffix)
+
+NodeId Partition::GetEdgeDestination(uint64_t edge_index) const
 {
-    std::shared_ptr<BaseStorage<uint8_t>> edge_features_index;
-    if (!is_hdfs_path(path))
+    if (!m_compressed_destination.empty())
     {
-        edge_features_index =
-            std::make_shared<DiskStorage<uint8_t>>(std::move(path), std::move(suffix), open_edge_features_index);
-    }
-    else
-    {
-        auto full_path = path / ("edge_features_" + suffix + ".index");
-        edge_features_index = std::make_shared<HDFSStreamStorage<uint8_t>>(full_path.c_str(), m_metadata.m_config_path);
+        const auto id = m_compressed_destination[edge_index];
+        return m_neighbor_ids == nullptr ? id : (*m_neighbor_ids)[id];
     }
-    auto edge_features_index_ptr = edge_features_index->start();
-    size_t size = edge_features_index->size();
-    size_t size_64 = size / 8;
-    m_edge_feature_index.resize(size_64);
-    if (size != edge_features_index->read(m_edge_feature_index.data(), 1, size, edge_features_index_ptr))
+    if (m_neighbor_ids != nullptr)
     {
-        RAW_LOG_FATAL("Failed to read node feature index file");
+        return (*m_neighbor_ids)[m_compact_destination[edge_index]];
     }
+
+    return m_edge_destination[edge_index];
 }
-void Partition::ReadEdgeFeaturesData(std::filesystem::path path, std::string suffix)
+
+void Partition::GetEdgeDestinations(uint64_t begin, uint64_t end, NodeId *output) const
 {
-    if (is_hdfs_path(path))
+    if (!m_compressed_destination.empty())
     {
-        auto full_path = path / ("edge_features_" + suffix + ".data");
-        m_edge_features = std::make_shared<HDFSStorage<uint8_t>>(full_path.c_str(), m_metadata.m_config_path,
-                                                                 std::move(suffix), &open_edge_features_data);
+        m_compressed_destination.Decode(begin, end, output);
+        if (m_neighbor_ids != nullptr)
+        {
+            std::transform(output, output + (end - begin), output, [this](NodeId id) { return (*m_neighbor_ids)[id]; });
+        }
     }
-    else if (m_storage_type == PartitionStorageType::memory)
+    else if (m_neighbor_ids != nullptr)
     {
-        m_edge_features =
-            std::make_shared<MemoryStorage<uint8_t>>(std::move(path), std::move(suffix), &open_edge_features_data);
+        std::transform(std::begin(m_compact_destination) + begin, std::begin(m_compact_destination) + end, output,
+                       [this](uint32_t id) { return (*m_neighbor_ids)[id]; });
     }
-    else if (m_storage_type == PartitionStorageType::disk)
+    else
     {
-        m_edge_features =
-            std::make_shared<DiskStorage<uint8_t>>(std::move(path), std::move(suffix), &open_edge_features_data);
+        std::copy(std::begin(m_edge_destination) + begin, std::begin(m_edge_destination) + end, output);
     }
 }
-Type Partition::GetNodeType(uint64_t internal_node_id) const
+
+uint64_t Partition::FindEdge(uint64_t begin, uint64_t end, NodeId dst) const
 {
-    return m_node_types[internal_node_id];
+    if (m_neighbor_ids != nullptr)
+    {
+        // Compact ids keep the order of neighbor ids, so edges are searched by the position of dst in the table.
+        const auto compact_dst =
+            uint32_t(std::lower_bound(std::begin(*m_neighbor_ids), std::end(*m_neighbor_ids), dst) -
+                     std::begin(*m_neighbor_ids));
+        if (!m_compressed_destination.empty())
+        {
+            return m_compressed_destination.LowerBound(begin, end, compact_dst);
+        }
+
+        return std::lower_bound(std::begin(m_compact_destination) + begin, std::begin(m_compact_destination) + end,
+                                compact_dst) -
+               std::begin(m_compact_destination);
+    }
+    if (!m_compressed_destination.empty())
+    {
+        return m_compressed_destination.LowerBound(begin, end, dst);
+    }
+
+    return std::lower_bound(std::begin(m_edge_destination) + begin, std::begin(m_edge_destination) + end, dst) -
+           std::begin(m_edge_destination);
 }
 
-bool Partition::HasNodeFeatures(uint64_t internal_node_id) const
+const Partition::DenseFeatures *Partition::GetDenseFeatures(uint64_t internal_id) const
 {
-    return GetNodeType(internal_node_id) != snark::PLACEHOLDER_NODE_TYPE;
+    const auto type = size_t(m_node_types[internal_id]);
+    if (type >= m_dense_features.size() || m_dense_features[type].m_offsets.empty())
+    {
+        return nullptr;
+    }
+
+    return &m_dense_features[type];
 }
 
-bool Partition::GetNodeFeature(uint64_t internal_id, std::span<snark::FeatureMeta> features,
-                               std::span<uint8_t> output) const
+bool Partition::GetNodeFeatureData(uint64_t internal_id, std::span<const snark::FeatureMeta> features,
+                                   std::span<const uint8_t *> out_data, std::span<uint64_t> out_sizes) const
 {
-    if (!HasNodeFeatures(internal_id))
-        return false;
-
-    auto file_ptr = m_node_features->start();
-    auto curr = std::begin(output);
-    auto feature_index_offset = m_node_index[internal_id];
-    auto next_offset = m_node_index[internal_id + 1];
-    for (const auto &feature : features)
+    assert(features.size() == out_data.size());
+    assert(features.size() == out_sizes.size());
+    const auto dense = GetDenseFeatures(internal_id);
+    for (size_t feature_index = 0; feature_index < features.size(); ++feature_index)
     {
-        const auto feature_id = feature.first;
-        const auto feature_size = feature.second;
-        // Requested feature_id is larger than known features, fill with 0s.
-        if (next_offset - feature_index_offset <= uint64_t(feature_id) || m_node_feature_index.empty())
+        const auto feature = features[feature_index].first;
+        uint64_t stride = 0;
+        if (const auto column = GetNodeFeatureColumn(feature, stride); column != nullptr)
         {
-            curr = std::fill_n(curr, feature_size, 0);
+            out_data[feature_index] = column + internal_id * stride;
+            out_sizes[feature_index] = stride;
             continue;
         }
-        const auto data_offset = m_node_feature_index[feature_index_offset + feature_id];
-        const auto stored_size = m_node_feature_index[feature_index_offset + feature_id + 1] - data_offset;
-        curr = m_node_features->read(data_offset, std::min<uint64_t>(feature_size, stored_size), curr, file_ptr);
-        if (stored_size < feature_size)
+        // Quantized features have to be decoded.
+        const auto &quantization = m_metadata.m_node_feature_quantization;
+        if (dense == nullptr ||
+            (size_t(feature) < quantization.size() && quantization[feature].m_encoding != FeatureEncoding::float32))
         {
-            curr = std::fill_n(curr, feature_size - stored_size, 0);
+            return false;
+        }
+        if (feature < 0 || size_t(feature) + 1 >= dense->m_offsets.size())
+        {
+            out_data[feature_index] = nullptr;
+            out_sizes[feature_index] = 0;
+            continue;
+        }
+
+        out_data[feature_index] = dense->m_data->view().data() +
+                                  m_dense_rows[internal_id] * dense->m_offsets.back() + dense->m_offsets[feature];
+        out_sizes[feature_index] = dense->m_offsets[feature + 1] - dense->m_offsets[feature];
+    }
+
+    return true;
+}
+
+bool Partition::GetNodeFeatureView(uint64_t internal_id, FeatureId feature, std::span<const uint8_t> &out_view) const
+{
+    const BaseStorage<uint8_t> *storage = nullptr;
+    uint64_t data_offset = 0;
+    uint64_t stored_size = 0;
+    if (!FindNodeFeature(internal_id, feature, storage, data_offset, stored_size) || stored_size == 0)
+    {
+        out_view = {};
+        return true;
+    }
+
+    const auto &quantization = m_metadata.m_node_feature_quantization;
+    const auto data = storage->view();
+    if ((size_t(feature) < quantization.size() && quantization[feature].m_encoding != FeatureEncoding::float32) ||
+        data_offset + stored_size > data.size())
+    {
+        return false;
+    }
+
+    out_view = data.subspan(data_offset, stored_size);
+    return true;
+}
+
+bool Partition::FindNodeFeature(uint64_t internal_id, FeatureId feature, const BaseStorage<uint8_t> *&storage,
+                                uint64_t &data_offset, uint64_t &stored_size) const
+{
+    if (const auto column = GetNodeFeatureColumn(feature, stored_size); column != nullptr)
+    {
+        storage = m_node_feature_columns[feature].m_data.get();
+        data_offset = internal_id * stored_size;
+        return true;
+    }
+    if (const auto dense = GetDenseFeatures(internal_id); dense != nullptr)
+    {
+        if (feature < 0 || size_t(feature) + 1 >= dense->m_offsets.size())
+        {
+            return false;
         }
+
+        storage = dense->m_data.get();
+        data_offset = m_dense_rows[internal_id] * dense->m_offsets.back() + dense->m_offsets[feature];
+        stored_size = dense->m_offsets[feature + 1] - dense->m_offsets[feature];
+        return true;
+    }
+
+    const auto feature_index_offset = m_node_index[internal_id];
+    const auto next_offset = m_node_index[internal_id + 1];
+    // Requested feature_id is larger than known features.
+    if (next_offset - feature_index_offset <= uint64_t(feature) || m_node_feature_index.empty())
+    {
+        return false;
     }
 
+    storage = m_node_features.get();
+    data_offset = m_node_feature_index[feature_index_offset + feature];
+    stored_size = m_node_feature_index[feature_index_offset + feature + 1] - data_offset;
     return true;
 }
 
@@ -331,21 +1523,15 @@ bool Partition::GetNodeSparseFeature(uint64_t internal_node_id, std::span<const
         return false;
 
     assert(features.size() == out_dimensions.size());
-    auto file_ptr = m_node_features->start();
-    auto feature_index_offset = m_node_index[internal_node_id];
-    auto next_offset = m_node_index[internal_node_id + 1];
+    std::vector<uint8_t> buffer;
     for (size_t feature_index = 0; feature_index < features.size(); ++feature_index)
     {
         const auto feature = features[feature_index];
-        // Requested feature_id is larger than known features, skip.
-        if (next_offset - feature_index_offset <= uint64_t(feature) || m_node_feature_index.empty())
-        {
-            continue;
-        }
-        const auto data_offset = m_node_feature_index[feature_index_offset + feature];
-        const auto stored_size = m_node_feature_index[feature_index_offset + feature + 1] - data_offset;
-        // Check if the feature is empty
-        if (stored_size == 0)
+        const BaseStorage<uint8_t> *storage = nullptr;
+        uint64_t data_offset = 0;
+        uint64_t stored_size = 0;
+        // Skip features larger than known features and empty features.
+        if (!FindNodeFeature(internal_node_id, feature, storage, data_offset, stored_size) || stored_size == 0)
         {
             continue;
         }
@@ -361,34 +1547,9 @@ bool Partition::GetNodeSparseFeature(uint64_t internal_node_id, std::span<const
                             feature_string.c_str(), node_id_string.c_str());
             continue;
         }
-        uint32_t indices_size = 0;
-        auto indices_size_output = std::span(reinterpret_cast<uint8_t *>(&indices_size), 4);
-        m_node_features->read(data_offset, indices_size_output.size(), std::begin(indices_size_output), file_ptr);
-        uint32_t indices_dim = 0;
-        auto indices_dim_output = std::span(reinterpret_cast<uint8_t *>(&indices_dim), 4);
-        m_node_features->read(data_offset + 4, indices_dim_output.size(), std::begin(indices_dim_output), file_ptr);
-        out_dimensions[feature_index] = int64_t(indices_dim);
-        assert(indices_size % indices_dim == 0);
-        size_t num_values = indices_size / indices_dim;
-        const auto old_len = out_indices[feature_index].size();
-        out_indices[feature_index].resize(old_len + indices_size + num_values, prefix);
-        auto output = std::span(reinterpret_cast<uint8_t *>(out_indices[feature_index].data()) + old_len * 8,
-                                (indices_size + num_values) * 8);
-        // Read expected feature_dim indices in bytes
-        size_t indices_offset = data_offset + 8;
-        auto curr = std::begin(output);
-        for (size_t i = 0; i < num_values; ++i)
-        {
-            curr += 8;
-            curr = m_node_features->read(indices_offset, indices_dim * 8, curr, file_ptr);
-            indices_offset += 8 * indices_dim;
-        }
-        // Read values
-        const auto values_length = stored_size - indices_size * 8 - 8;
-        const auto old_values_length = out_values[feature_index].size();
-        out_values[feature_index].resize(old_values_length + values_length);
-        auto out_values_span = std::span(out_values[feature_index]).subspan(old_values_length);
-        m_node_features->read(indices_offset, values_length, std::begin(out_values_span), file_ptr);
+        const auto blob = read_sparse_feature(*storage, data_offset, stored_size, buffer);
+        out_dimensions[feature_index] =
+            decode_sparse_feature(blob, prefix, out_indices[feature_index], out_values[feature_index]);
     }
 
     return true;
@@ -401,21 +1562,14 @@ bool Partition::GetNodeStringFeature(uint64_t internal_node_id, std::span<const
         return false;
 
     assert(features.size() == out_dimensions.size());
-    auto file_ptr = m_node_features->start();
-    auto feature_index_offset = m_node_index[internal_node_id];
-    auto next_offset = m_node_index[internal_node_id + 1];
     for (size_t feature_index = 0; feature_index < features.size(); ++feature_index)
     {
         const auto feature = features[feature_index];
-        // Requested feature_id is larger than known features, skip.
-        if (next_offset - feature_index_offset <= uint64_t(feature) || m_node_feature_index.empty())
-        {
-            continue;
-        }
-        const auto data_offset = m_node_feature_index[feature_index_offset + feature];
-        const auto stored_size = m_node_feature_index[feature_index_offset + feature + 1] - data_offset;
-        // Check if the feature is empty
-        if (stored_size == 0)
+        const BaseStorage<uint8_t> *storage = nullptr;
+        uint64_t data_offset = 0;
+        uint64_t stored_size = 0;
+        // Skip features larger than known features and empty features.
+        if (!FindNodeFeature(internal_node_id, feature, storage, data_offset, stored_size) || stored_size == 0)
         {
             continue;
         }
@@ -424,7 +1578,7 @@ bool Partition::GetNodeStringFeature(uint64_t internal_node_id, std::span<const
         const auto old_values_length = out_values.size();
         out_values.resize(old_values_length + stored_size);
         auto out_values_span = std::span(out_values).subspan(old_values_length);
-        m_node_features->read(data_offset, stored_size, std::begin(out_values_span), file_ptr);
+        storage->read(data_offset, stored_size, std::begin(out_values_span), nullptr);
     }
 
     return true;
@@ -432,7 +1586,7 @@ bool Partition::GetNodeStringFeature(uint64_t internal_node_id, std::span<const
 
 template <class F>
 size_t NeighborIndexIterator(uint64_t internal_id, std::span<const Type> edge_types, F func,
-                             const std::vector<uint64_t> &m_neighbors_index, const std::vector<Type> &m_edge_types,
+                             std::span<const uint64_t> m_neighbors_index, const std::vector<Type> &m_edge_types,
                              const std::vector<uint64_t> &m_edge_type_offset)
 
 {
@@ -489,12 +1643,16 @@ size_t Partition::FullNeighbor(uint64_t internal_id, std::span<const Type> edge_
                                std::vector<float> &out_edge_weights) const
 {
     auto lambda = [&out_neighbors_ids, &out_edge_types, &out_edge_weights, this](auto start, auto last, int i) {
-        // m_edge_destination[last-1]+1 - take the last element and then advance the pointer
-        // to imitate std::end, otherwise we'll have an out of range exception.
-        out_neighbors_ids.insert(std::end(out_neighbors_ids), &m_edge_destination[start],
-                                 &m_edge_destination[last - 1] + 1);
+        const auto original_neighbors_size = out_neighbors_ids.size();
+        out_neighbors_ids.resize(original_neighbors_size + last - start);
+        GetEdgeDestinations(start, last, out_neighbors_ids.data() + original_neighbors_size);
         auto original_type_size = out_edge_types.size();
         out_edge_types.resize(original_type_size + last - start, m_edge_types[i]);
+        if (m_unit_edge_weights)
+        {
+            out_edge_weights.resize(out_edge_weights.size() + last - start, 1.0f);
+            return;
+        }
         out_edge_weights.reserve(out_edge_weights.size() + last - start);
         for (size_t index = start; index < last; ++index)
         {
@@ -510,7 +1668,6 @@ size_t Partition::FullNeighbor(uint64_t internal_id, std::span<const Type> edge_
 bool Partition::GetEdgeFeature(uint64_t internal_src_node_id, NodeId input_edge_dst, Type input_edge_type,
                                std::span<snark::FeatureMeta> features, std::span<uint8_t> output) const
 {
-    auto file_ptr = m_edge_features->start();
     auto curr = std::begin(output);
 
     const auto offset = m_neighbors_index[internal_src_node_id];
@@ -535,11 +1692,9 @@ bool Partition::GetEdgeFeature(uint64_t internal_src_node_id, NodeId input_edge_
     {
         return false;
     }
-    const auto tp_count = m_edge_type_offset[type_offset + 1] - m_edge_type_offset[type_offset];
-    auto fst = std::begin(m_edge_destination) + m_edge_type_offset[type_offset];
-    auto lst = fst + tp_count;
-    auto it = std::lower_bound(fst, lst, input_edge_dst);
-    if (it == lst)
+    const auto type_end = m_edge_type_offset[type_offset + 1];
+    const auto edge_offset = FindEdge(m_edge_type_offset[type_offset], type_end, input_edge_dst);
+    if (edge_offset == type_end)
     {
         // Edge was not found in this partition.
         return false;
@@ -550,10 +1705,22 @@ bool Partition::GetEdgeFeature(uint64_t internal_src_node_id, NodeId input_edge_
         return true;
     }
 
-    auto edge_offset = it - std::begin(m_edge_destination);
     auto feature_index_offset = m_edge_feature_offset[edge_offset];
     auto next_offset = m_edge_feature_offset[edge_offset + 1];
 
+    FeatureCache::Value cached;
+    uint64_t cached_offset = 0;
+    if (m_feature_cache != nullptr)
+    {
+        cached_offset = m_edge_feature_index[feature_index_offset];
+        cached = GetCachedFeatures(*m_edge_features, edge_cache_key | uint64_t(edge_offset), cached_offset,
+                                   m_edge_feature_index[next_offset]);
+    }
+    auto read = [&](uint64_t data_offset, uint64_t size, std::span<uint8_t>::iterator output) {
+        return cached == nullptr ? m_edge_features->read(data_offset, size, output, nullptr)
+                                 : std::copy_n(cached->data() + data_offset - cached_offset, size, output);
+    };
+
     for (const auto &feature : features)
     {
         const auto f_id = feature.first;
@@ -568,7 +1735,7 @@ bool Partition::GetEdgeFeature(uint64_t internal_src_node_id, NodeId input_edge_
 
         const auto data_offset = m_edge_feature_index[feature_index_offset + f_id];
         const auto stored_size = m_edge_feature_index[feature_index_offset + f_id + 1] - data_offset;
-        curr = m_edge_features->read(data_offset, std::min<uint64_t>(f_size, stored_size), curr, file_ptr);
+        curr = read(data_offset, std::min<uint64_t>(f_size, stored_size), curr);
         if (stored_size < f_size)
         {
             const auto f_id = feature.first;
@@ -584,7 +1751,7 @@ bool Partition::GetEdgeFeature(uint64_t internal_src_node_id, NodeId input_edge_
             const auto data_offset = m_edge_feature_index[feature_index_offset + f_id];
             const auto stored_size = m_edge_feature_index[feature_index_offset + f_id + 1] - data_offset;
 
-            curr = m_edge_features->read(data_offset, std::min<uint64_t>(f_size, stored_size), curr, file_ptr);
+            curr = read(data_offset, std::min<uint64_t>(f_size, stored_size), curr);
             if (stored_size < f_size)
             {
                 curr = std::fill_n(curr, f_size - stored_size, 0);
@@ -601,7 +1768,6 @@ bool Partition::GetEdgeSparseFeature(uint64_t internal_src_node_id, NodeId input
                                      std::vector<std::vector<uint8_t>> &out_values) const
 {
     assert(features.size() == out_dimensions.size());
-    auto file_ptr = m_edge_features->start();
     const auto offset = m_neighbors_index[internal_src_node_id];
     const auto nb_count = m_neighbors_index[internal_src_node_id + 1] - offset;
     // Check if node doesn't have any neighbors
@@ -622,11 +1788,9 @@ bool Partition::GetEdgeSparseFeature(uint64_t internal_src_node_id, NodeId input
     {
         return false;
     }
-    const auto tp_count = m_edge_type_offset[type_offset + 1] - m_edge_type_offset[type_offset];
-    auto fst = std::begin(m_edge_destination) + m_edge_type_offset[type_offset];
-    auto lst = fst + tp_count;
-    auto it = std::lower_bound(fst, lst, input_edge_dst);
-    if (it == lst)
+    const auto type_end = m_edge_type_offset[type_offset + 1];
+    const auto edge_offset = FindEdge(m_edge_type_offset[type_offset], type_end, input_edge_dst);
+    if (edge_offset == type_end)
     {
         // Edge was not found in this partition.
         return false;
@@ -635,9 +1799,9 @@ bool Partition::GetEdgeSparseFeature(uint64_t internal_src_node_id, NodeId input
     {
         return true;
     }
-    auto edge_offset = it - std::begin(m_edge_destination);
     auto feature_index_offset = m_edge_feature_offset[edge_offset];
     auto next_offset = m_edge_feature_offset[edge_offset + 1];
+    std::vector<uint8_t> buffer;
     for (size_t feature_index = 0; feature_index < features.size(); ++feature_index)
     {
         const auto feature = features[feature_index];
@@ -668,40 +1832,9 @@ bool Partition::GetEdgeSparseFeature(uint64_t internal_src_node_id, NodeId input
             continue;
         }
 
-        assert(stored_size > 12); // minimum is 4 bytes to record there is a single index, actual index (8 bytes)
-                                  // and some data(>0 bytes).
-        uint32_t indices_size = 0;
-        auto indices_size_output = std::span(reinterpret_cast<uint8_t *>(&indices_size), 4);
-        m_edge_features->read(data_offset, indices_size_output.size(), std::begin(indices_size_output), file_ptr);
-
-        uint32_t indices_dim = 0;
-        auto indices_dim_output = std::span(reinterpret_cast<uint8_t *>(&indices_dim), 4);
-        m_edge_features->read(data_offset + 4, indices_dim_output.size(), std::begin(indices_dim_output), file_ptr);
-        out_dimensions[feature_index] = int64_t(indices_dim);
-
-        assert(indices_size % indices_dim == 0);
-        size_t num_values = indices_size / indices_dim;
-        const auto old_len = out_indices[feature_index].size();
-        out_indices[feature_index].resize(old_len + indices_size + num_values, prefix);
-        auto output = std::span(reinterpret_cast<uint8_t *>(out_indices[feature_index].data()) + old_len * 8,
-                                (indices_size + num_values) * 8);
-
-        // Read expected feature_dim indices in bytes
-        size_t indices_offset = data_offset + 8;
-        auto curr = std::begin(output);
-        for (size_t i = 0; i < num_values; ++i)
-        {
-            curr += 8;
-            curr = m_edge_features->read(indices_offset, indices_dim * 8, curr, file_ptr);
-            indices_offset += 8 * indices_dim;
-        }
-
-        // Read values
-        const auto values_length = stored_size - indices_size * 8 - 8;
-        const auto old_values_length = out_values[feature_index].size();
-        out_values[feature_index].resize(old_values_length + values_length);
-        auto out_values_span = std::span(out_values[feature_index]).subspan(old_values_length);
-        m_edge_features->read(indices_offset, values_length, std::begin(out_values_span), file_ptr);
+        const auto blob = read_sparse_feature(*m_edge_features, data_offset, stored_size, buffer);
+        out_dimensions[feature_index] =
+            decode_sparse_feature(blob, prefix, out_indices[feature_index], out_values[feature_index]);
     }
 
     return true;
@@ -713,7 +1846,6 @@ bool Partition::GetEdgeStringFeature(uint64_t internal_src_node_id, NodeId input
 {
     assert(features.size() == out_dimensions.size());
 
-    auto file_ptr = m_edge_features->start();
     const auto offset = m_neighbors_index[internal_src_node_id];
     const auto nb_count = m_neighbors_index[internal_src_node_id + 1] - offset;
 
@@ -736,11 +1868,9 @@ bool Partition::GetEdgeStringFeature(uint64_t internal_src_node_id, NodeId input
     {
         return false;
     }
-    const auto tp_count = m_edge_type_offset[type_offset + 1] - m_edge_type_offset[type_offset];
-    auto fst = std::begin(m_edge_destination) + m_edge_type_offset[type_offset];
-    auto lst = fst + tp_count;
-    auto it = std::lower_bound(fst, lst, input_edge_dst);
-    if (it == lst)
+    const auto type_end = m_edge_type_offset[type_offset + 1];
+    const auto edge_offset = FindEdge(m_edge_type_offset[type_offset], type_end, input_edge_dst);
+    if (edge_offset == type_end)
     {
         // Edge was not found in this partition.
         return false;
@@ -750,7 +1880,6 @@ bool Partition::GetEdgeStringFeature(uint64_t internal_src_node_id, NodeId input
         return true;
     }
 
-    auto edge_offset = it - std::begin(m_edge_destination);
     auto feature_index_offset = m_edge_feature_offset[edge_offset];
     auto next_offset = m_edge_feature_offset[edge_offset + 1];
 
@@ -776,7 +1905,7 @@ bool Partition::GetEdgeStringFeature(uint64_t internal_src_node_id, NodeId input
         const auto old_values_length = out_values.size();
         out_values.resize(old_values_length + stored_size);
         auto out_values_span = std::span(out_values).subspan(old_values_length);
-        m_edge_features->read(data_offset, stored_size, std::begin(out_values_span), file_ptr);
+        m_edge_features->read(data_offset, stored_size, std::begin(out_values_span), nullptr);
     }
 
     return true;
@@ -790,6 +1919,8 @@ void Partition::SampleNeighbor(int64_t seed, uint64_t internal_node_id, std::spa
     auto pos = 0;
     snark::Xoroshiro128PlusGenerator gen(seed);
     boost::random::uniform_real_distribution<float> real(0, 1.0f);
+    // Alias table slots need more bits than floats have for large type runs.
+    boost::random::uniform_real_distribution<double> slot(0, 1.0);
 
     const auto offset = m_neighbors_index[internal_node_id];
     const auto nb_count = m_neighbors_index[internal_node_id + 1] - offset;
@@ -830,7 +1961,7 @@ void Partition::SampleNeighbor(int64_t seed, uint64_t internal_node_id, std::spa
         if (m_edge_types[i] == in_edge_types[curr_type])
         {
             auto last = m_edge_type_offset[i + 1] - 1;
-            total_weight += m_edge_weights[last];
+            total_weight += GetCumulativeWeight(m_edge_type_offset[i], last);
         }
     }
 
@@ -875,11 +2006,14 @@ void Partition::SampleNeighbor(int64_t seed, uint64_t internal_node_id, std::spa
         {
             const auto first = m_edge_type_offset[i];
             const auto last = m_edge_type_offset[i + 1] - 1;
-            const auto type_weight = m_edge_weights[last];
+            const auto type_weight = GetCumulativeWeight(first, last);
 
             boost::random::binomial_distribution<int32_t> d(left_over_neighbors, type_weight / total_weight);
             size_t type_count = type_weight == total_weight ? left_over_neighbors : d(gen);
             total_weight -= type_weight;
+            const auto alias = m_alias_offsets.empty() ? std::end(m_alias_offsets) : m_alias_offsets.find(i);
+            const auto search_tree =
+                m_search_tree_offsets.empty() ? std::end(m_search_tree_offsets) : m_search_tree_offsets.find(i);
             for (size_t j = 0; j < type_count; ++j)
             {
                 if (overwrite_rate < 1.0f && real(gen) > overwrite_rate)
@@ -887,13 +2021,57 @@ void Partition::SampleNeighbor(int64_t seed, uint64_t internal_node_id, std::spa
                     continue;
                 }
 
-                float rnd = type_weight * real(gen);
-                auto fst_nb = std::begin(m_edge_weights) + first;
-                auto lst_nb =
-                    m_edge_weights.size() == last ? std::end(m_edge_weights) : std::begin(m_edge_weights) + last + 1;
-                auto nb_pos = std::lower_bound(fst_nb, lst_nb, rnd);
-                size_t nb_offset = std::distance(fst_nb, nb_pos);
-                out_nodes[pos] = m_edge_destination[first + nb_offset];
+                if (alias != std::end(m_alias_offsets))
+                {
+                    // Pick an edge uniformly with the integer part of a scaled draw, then keep it or take its alias
+                    // with the fractional part. Doubles keep 21 bits of the fraction for runs of 2^32 edges.
+                    const auto run_size = last - first + 1;
+                    const double scaled = slot(gen) * double(run_size);
+                    auto nb_offset = std::min<uint64_t>(uint64_t(scaled), run_size - 1);
+                    const double coin = scaled - double(nb_offset);
+                    const auto &entry = m_alias_tables[alias->second + nb_offset];
+                    if (!(coin < entry.m_threshold))
+                    {
+                        nb_offset = entry.m_alias;
+                    }
+                    out_nodes[pos] = GetEdgeDestination(first + nb_offset);
+                    out_types[pos] = m_edge_types[i];
+                    out_weights[pos] = nb_offset == 0
+                                           ? m_edge_weights[first]
+                                           : m_edge_weights[first + nb_offset] - m_edge_weights[first + nb_offset - 1];
+                    ++pos;
+                    continue;
+                }
+
+                const auto toss = real(gen);
+                float rnd = type_weight * toss;
+                if (m_unit_edge_weights)
+                {
+                    // Pick the same edge as a search over cumulative weights 1, 2, ..., type_weight.
+                    const auto nb_offset = std::min<uint64_t>(rnd <= 1.0f ? 0 : uint64_t(std::ceil(rnd)) - 1,
+                                                              last - first);
+                    out_nodes[pos] = GetEdgeDestination(first + nb_offset);
+                    out_types[pos] = m_edge_types[i];
+                    out_weights[pos] = 1.0f;
+                    ++pos;
+                    continue;
+                }
+
+                size_t nb_offset = 0;
+                if (search_tree != std::end(m_search_tree_offsets))
+                {
+                    nb_offset = search_tree_lower_bound(m_search_trees.data() + search_tree->second,
+                                                        m_edge_weights.data() + first, last - first + 1, rnd);
+                }
+                else
+                {
+                    auto fst_nb = std::begin(m_edge_weights) + first;
+                    auto lst_nb = m_edge_weights.size() == last ? std::end(m_edge_weights)
+                                                                : std::begin(m_edge_weights) + last + 1;
+                    auto nb_pos = std::lower_bound(fst_nb, lst_nb, rnd);
+                    nb_offset = std::distance(fst_nb, nb_pos);
+                }
+                out_nodes[pos] = GetEdgeDestination(first + nb_offset);
                 out_types[pos] = m_edge_types[i];
                 out_weights[pos] = nb_offset == 0
                                        ? m_edge_weights[first]
@@ -985,7 +2163,7 @@ void Partition::UniformSampleNeighborWithReplacement(int64_t seed, uint64_t inte
             if (merge_rate == 1.0f || toss(gen) < merge_rate)
             {
                 size_t pick = toss(gen) * curr_weight;
-                out_nodes[pos + nb] = m_edge_destination[m_edge_type_offset[neighbor_type_index] + pick];
+                out_nodes[pos + nb] = GetEdgeDestination(m_edge_type_offset[neighbor_type_index] + pick);
                 out_types[pos + nb] = m_edge_types[neighbor_type_index];
             }
         }
@@ -1095,7 +2273,7 @@ void Partition::UniformSampleMergeWithoutReplacement(
             out_edge_types[out_pos] = type_values[type_offset];
             size_t prev_type = type_offset == 0 ? 0 : type_counts[type_offset - 1];
             out_neighbors[out_pos] =
-                m_edge_destination[destination_offsets[type_offset] + interim_neighbors[right_pos] - prev_type];
+                GetEdgeDestination(destination_offsets[type_offset] + interim_neighbors[right_pos] - prev_type);
             ++right_pos;
             --right_weight;
         }
@@ -1183,4 +2361,26 @@ Metadata Partition::GetMetadata() const
 {
     return m_metadata;
 }
+
+FeatureCache::Stats Partition::GetFeatureCacheStats() const
+{
+    return m_feature_cache == nullptr ? FeatureCache::Stats{} : m_feature_cache->GetStats();
+}
+
+FeatureCache::Value Partition::GetCachedFeatures(BaseStorage<uint8_t> &storage, uint64_t key, uint64_t begin,
+                                                 uint64_t end) const
+{
+    if (auto value = m_feature_cache->Get(key))
+    {
+        return value;
+    }
+
+    auto value = std::make_shared<std::vector<uint8_t>>(end - begin);
+    if (!value->empty())
+    {
+        storage.read(begin, value->size(), std::begin(std::span(*value)), nullptr);
+    }
+    m_feature_cache->Put(key, value);
+    return value;
+}
 } // namespace snark
@@ -5,30 +5,78 @@
 #define SNARK_PARTITION_H
 #include <cstdlib>
 #include <filesystem>
+#include <memory>
 #include <random>
 #include <span>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include "async_reader.h"
+#include "compressed_neighbors.h"
+#include "feature_cache.h"
+#include "huge_pages.h"
 #include "metadata.h"
+#include "quantization.h"
 #include "storage.h"
 #include "types.h"
 #include "xoroshiro.h"
 
+#include "absl/container/flat_hash_map.h"
 #include "boost/random/uniform_real_distribution.hpp"
 
 namespace snark
 {
+struct Partition;
+
+// Node missing from the feature cache of a disk partition. All its features are read with a batch of
+// ReadRequests into data, after the batch is processed Partition::FinishNodeFeature caches them and fills output.
+struct PendingNodeFeature
+{
+    const Partition *m_partition;
+    uint64_t m_internal_id;
+    std::span<snark::FeatureMeta> m_features;
+    std::span<uint8_t> m_output;
+    std::shared_ptr<std::vector<uint8_t>> m_data;
+};
+
 struct Partition
 {
     Partition() = default;
-    Partition(Metadata m_metadata, std::filesystem::path path, std::string suffix, PartitionStorageType storage_type);
+    // Feature cache, block cache and pinned features sizes of options are budgets of this partition, options used by
+    // graphs only, e.g. numa or compact_neighbor_ids, are ignored. Columnar and dense features apply to memory
+    // partitions only. Alias tables and search trees are built on at most max_threads threads, graphs loading
+    // partitions in parallel split hardware threads between them.
+    Partition(Metadata m_metadata, std::filesystem::path path, std::string suffix, PartitionStorageType storage_type,
+              GraphOptions options = {}, size_t max_threads = std::thread::hardware_concurrency());
+
+    // Prefetch index entries read first by node type and feature lookups.
+    void PrefetchNode(uint64_t internal_node_id) const;
+    // Prefetch index entries read first by neighbor lookups and sampling.
+    void PrefetchNeighbors(uint64_t internal_node_id) const;
 
     Type GetNodeType(uint64_t internal_node_id) const;
     bool HasNodeFeatures(uint64_t internal_node_id) const;
     bool GetNodeFeature(uint64_t internal_node_id, std::span<snark::FeatureMeta> features,
                         std::span<uint8_t> output) const;
+    // Same as above, but reads from local files are appended to requests instead of being executed and
+    // nodes missing from the feature cache are appended to pending. Output is complete only after requests
+    // are processed with an AsyncReader and FinishNodeFeature is called for every pending node.
+    bool GetNodeFeature(uint64_t internal_node_id, std::span<snark::FeatureMeta> features, std::span<uint8_t> output,
+                        std::vector<ReadRequest> *requests, std::vector<PendingNodeFeature> *pending) const;
+    void FinishNodeFeature(const PendingNodeFeature &pending) const;
+    // Rows of a feature stored feature-major, the row of a node starts at internal id * stride.
+    // Return nullptr if the feature is not columnar.
+    const uint8_t *GetNodeFeatureColumn(FeatureId feature, uint64_t &stride) const;
+    // Location of node features in columns and dense tensors, nullptr with zero size for missing features.
+    // Return false if some feature has to be read with GetNodeFeature.
+    bool GetNodeFeatureData(uint64_t internal_id, std::span<const snark::FeatureMeta> features,
+                            std::span<const uint8_t *> out_data, std::span<uint64_t> out_sizes) const;
+    // Stored bytes of a node feature in memory or memory mapped storage, empty if the node doesn't have it.
+    // Return false if the feature is not stored in memory or has to be decoded.
+    bool GetNodeFeatureView(uint64_t internal_id, FeatureId feature, std::span<const uint8_t> &out_view) const;
+
     bool GetNodeSparseFeature(uint64_t internal_node_id, std::span<const snark::FeatureId> features, int64_t prefix,
                               std::span<int64_t> out_dimensions, std::vector<std::vector<int64_t>> &out_indices,
                               std::vector<std::vector<uint8_t>> &out_values) const;
@@ -75,17 +123,91 @@ struct Partition
 
     Metadata GetMetadata() const;
 
+    // Hits and misses of the feature cache, zeros if there is no cache.
+    FeatureCache::Stats GetFeatureCacheStats() const;
+
+    // Sorted unique neighbor ids of all partitions as a translation table for compact neighbor ids,
+    // nullptr if there are too many neighbors to index them with 32 bits.
+    static std::shared_ptr<const huge_vector<NodeId>> NeighborIdTable(std::span<const Partition> partitions);
+    // Replace neighbor ids with their 32 bit indices in the table, compressed neighbors are compressed again.
+    void CompactNeighborIds(std::shared_ptr<const huge_vector<NodeId>> neighbor_ids);
+
+    // Write a snapshot of the partition next to its files, it is picked up by the next partition
+    // loaded from path instead of the node map, node, neighbor and edge indices.
+    void WriteSnapshot(std::filesystem::path path, std::string suffix) const;
+
   private:
+    // Node features of a type as rows of the same size, features are located by offsets instead of the index.
+    struct DenseFeatures
+    {
+        // Offsets of features in a row, the last one is the row size. Empty for types stored node-major.
+        std::vector<uint64_t> m_offsets;
+        std::shared_ptr<MemoryStorage<uint8_t>> m_data;
+    };
+
+    // Return false if there is no valid snapshot.
+    bool ReadSnapshot(std::filesystem::path path, std::string suffix);
     void ReadNodeMap(std::filesystem::path path, std::string suffix);
     void ReadNodeIndex(std::filesystem::path path, std::string suffix);
-    void ReadEdges(std::filesystem::path path, std::string suffix);
     void ReadNeighborsIndex(std::filesystem::path path, std::string suffix);
     void ReadEdgeIndex(std::filesystem::path path, std::string suffix);
-    void ReadNodeFeatures(std::filesystem::path path, std::string suffix);
     void ReadNodeFeaturesIndex(std::filesystem::path path, std::string suffix);
-    void ReadNodeFeaturesData(std::filesystem::path path, std::string suffix);
+    // Compressed feature data caches decompressed blocks within block_cache_size bytes.
+    void ReadNodeFeaturesData(std::filesystem::path path, std::string suffix, size_t block_cache_size);
     void ReadEdgeFeaturesIndex(std::filesystem::path path, std::string suffix);
-    void ReadEdgeFeaturesData(std::filesystem::path path, std::string suffix);
+    void ReadEdgeFeaturesData(std::filesystem::path path, std::string suffix, size_t block_cache_size);
+
+    // Copy features of nodes with the most edges to memory until they fill budget bytes.
+    void PinNodeFeatures(size_t budget);
+
+    // Move features stored with the same size by every node with features from node-major data to columns.
+    void BuildFeatureColumns();
+    // Move features of node types where every node stores the same feature sizes to dense tensors.
+    void BuildDenseFeatures();
+
+    // Drop cumulative edge weights if every edge has weight 1.
+    void DropUnitEdgeWeights();
+    // Sum of weights of edges in [first, edge] of a type run starting at first.
+    float GetCumulativeWeight(uint64_t first, uint64_t edge) const;
+    // Build alias tables of weighted type runs with at least degree_threshold edges on at most max_threads threads.
+    void BuildAliasTables(uint64_t degree_threshold, size_t max_threads);
+    // Build search trees of cumulative weights of type runs with at least degree_threshold edges and no alias table
+    // on at most max_threads threads.
+    void BuildSearchTrees(uint64_t degree_threshold, size_t max_threads);
+
+    // Replace neighbor ids with their compressed copy.
+    void CompressNeighbors();
+    // Neighbor id of an edge from the compressed, compact or plain destination array.
+    NodeId GetEdgeDestination(uint64_t edge_index) const;
+    // Neighbor ids of edges in [begin, end).
+    void GetEdgeDestinations(uint64_t begin, uint64_t end, NodeId *output) const;
+    // Index of the first edge in [begin, end) with destination not less than dst, end if there is none.
+    uint64_t FindEdge(uint64_t begin, uint64_t end, NodeId dst) const;
+
+    // Dense tensor of the node type, nullptr if features of the node type are stored node-major.
+    const DenseFeatures *GetDenseFeatures(uint64_t internal_id) const;
+
+    // Storage holding a node feature and its location there, columnar features are read from their columns.
+    // Return false if the node doesn't have the feature.
+    bool FindNodeFeature(uint64_t internal_id, FeatureId feature, const BaseStorage<uint8_t> *&storage,
+                         uint64_t &data_offset, uint64_t &stored_size) const;
+
+    // Copy features of a node stored in [in_memory_offset, ...) of in_memory, or read them from storage if
+    // in_memory is null. Reads are appended to requests if it is not null.
+    void CopyNodeFeature(uint64_t internal_id, std::span<snark::FeatureMeta> features, std::span<uint8_t> output,
+                         const uint8_t *in_memory, uint64_t in_memory_offset,
+                         std::vector<ReadRequest> *requests) const;
+
+    // All features of a node or an edge stored in [begin, end) of storage, from cache if possible.
+    FeatureCache::Value GetCachedFeatures(BaseStorage<uint8_t> &storage, uint64_t key, uint64_t begin,
+                                          uint64_t end) const;
+
+    // Decode a node feature stored with quantization into float32 values, zero padded to feature_size bytes.
+    // Encoded values are taken from cached if it is not null.
+    std::span<uint8_t>::iterator ReadQuantizedFeature(const FeatureQuantization &quantization, uint64_t data_offset,
+                                                      uint64_t stored_size, uint64_t feature_size,
+                                                      std::span<uint8_t>::iterator output,
+                                                      const uint8_t *cached) const;
 
     void UniformSampleNeighborWithoutReplacement(int64_t seed, uint64_t internal_node_ids,
                                                  std::span<const Type> in_edge_types, uint64_t count,
@@ -109,6 +231,19 @@ struct Partition
     std::vector<uint64_t> m_node_index;
     std::vector<uint64_t> m_node_feature_index;
 
+    // Columnar node features indexed by feature id, features with zero stride are stored node-major.
+    struct FeatureColumn
+    {
+        uint64_t m_stride = 0;
+        std::shared_ptr<MemoryStorage<uint8_t>> m_data;
+    };
+    std::vector<FeatureColumn> m_node_feature_columns;
+
+    // Dense node features indexed by node type.
+    std::vector<DenseFeatures> m_dense_features;
+    // Row of every node in the tensor of its type.
+    std::vector<uint64_t> m_dense_rows;
+
     // Edge features
     std::shared_ptr<BaseStorage<uint8_t>> m_edge_features;
     std::vector<uint64_t> m_edge_feature_index;
@@ -117,14 +252,44 @@ struct Partition
     // Neighbor/edge indices
     std::vector<Type> m_edge_types;
     std::vector<uint64_t> m_edge_type_offset;
-    std::vector<NodeId> m_edge_destination;
-    std::vector<float> m_edge_weights;
+    huge_vector<NodeId> m_edge_destination;
+    // Compressed neighbor ids, m_edge_destination is empty if they are present.
+    CompressedNeighbors m_compressed_destination;
+    // Compact neighbor ids are indices in m_neighbor_ids shared by partitions of a graph, they are stored in
+    // m_compact_destination or compressed in m_compressed_destination.
+    huge_vector<uint32_t> m_compact_destination;
+    std::shared_ptr<const huge_vector<NodeId>> m_neighbor_ids;
+    huge_vector<float> m_edge_weights;
+    // Every edge has weight 1 and m_edge_weights is empty, edges are sampled by index.
+    bool m_unit_edge_weights = false;
 
-    std::vector<uint64_t> m_neighbors_index;
+    // Alias table entry of an edge: the edge is kept with probability m_threshold, otherwise the edge
+    // at offset m_alias in the same type run is picked.
+    struct NeighborAlias
+    {
+        float m_threshold;
+        uint32_t m_alias;
+    };
+    // Offsets of alias tables in m_alias_tables keyed by the index of their type run in m_edge_types.
+    absl::flat_hash_map<uint64_t, uint64_t> m_alias_offsets;
+    huge_vector<NeighborAlias> m_alias_tables;
+    // Offsets of search trees over cumulative weights in m_search_trees keyed by the index of their type run.
+    absl::flat_hash_map<uint64_t, uint64_t> m_search_tree_offsets;
+    huge_vector<float> m_search_trees;
+
+    huge_vector<uint64_t> m_neighbors_index;
 
     std::vector<Type> m_node_types;
     Metadata m_metadata;
     PartitionStorageType m_storage_type;
+
+    // Feature blocks of nodes keyed by internal id and of edges keyed by edge index with edge_cache_key set.
+    std::shared_ptr<FeatureCache> m_feature_cache;
+    static constexpr uint64_t edge_cache_key = uint64_t(1) << 63;
+
+    // Offsets of pinned nodes features in m_pinned_features keyed by internal id.
+    absl::flat_hash_map<uint64_t, uint64_t> m_pinned_nodes;
+    std::vector<uint8_t> m_pinned_features;
 };
 
 } // namespace snark
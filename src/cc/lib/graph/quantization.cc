@@ -0,0 +1,470 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#include "quantization.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <glog/logging.h>
+#include <glog/raw_logging.h>
+
+#include "locator.h"
+#include "storage.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(_MSC_VER)
+#define SNARK_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace snark
+{
+namespace
+{
+uint32_t float_bits(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+float bits_float(uint32_t bits)
+{
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Round to nearest even, same as F16C conversion instructions.
+uint16_t float_to_half(float value)
+{
+    uint32_t bits = float_bits(value);
+    const uint32_t sign = (bits >> 16) & 0x8000;
+    bits &= 0x7FFFFFFF;
+    if (bits >= 0x7F800000)
+    {
+        // Infinity or NaN, NaNs stay quiet.
+        return uint16_t(sign | 0x7C00 | (bits > 0x7F800000 ? 0x200 : 0));
+    }
+    if (bits >= 0x477FF000)
+    {
+        // Rounds above the largest half value.
+        return uint16_t(sign | 0x7C00);
+    }
+    if (bits < 0x38800000)
+    {
+        // Subnormal half or zero.
+        if (bits < 0x33000000)
+        {
+            return uint16_t(sign);
+        }
+        const uint32_t shift = 126 - (bits >> 23);
+        const uint32_t mantissa = (bits & 0x7FFFFF) | 0x800000;
+        uint32_t half = mantissa >> shift;
+        const uint32_t remainder = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1) != 0))
+        {
+            ++half;
+        }
+        return uint16_t(sign | half);
+    }
+
+    // Rebias exponent from 127 to 15, mantissa overflow correctly carries into exponent.
+    uint32_t half = (bits - 0x38000000) >> 13;
+    const uint32_t remainder = bits & 0x1FFF;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1) != 0))
+    {
+        ++half;
+    }
+    return uint16_t(sign | half);
+}
+
+float half_to_float(uint16_t half)
+{
+    const uint32_t sign = uint32_t(half & 0x8000) << 16;
+    const uint32_t exponent = (half >> 10) & 0x1F;
+    const uint32_t mantissa = half & 0x3FF;
+    if (exponent == 0x1F)
+    {
+        return bits_float(sign | 0x7F800000 | (mantissa << 13));
+    }
+    if (exponent != 0)
+    {
+        return bits_float(sign | ((exponent + 112) << 23) | (mantissa << 13));
+    }
+
+    const float value = std::ldexp(float(mantissa), -24);
+    return sign != 0 ? -value : value;
+}
+
+uint16_t float_to_bfloat16(float value)
+{
+    const uint32_t bits = float_bits(value);
+    if ((bits & 0x7FFFFFFF) > 0x7F800000)
+    {
+        return uint16_t((bits >> 16) | 0x40);
+    }
+    return uint16_t((bits + 0x7FFF + ((bits >> 16) & 1)) >> 16);
+}
+
+float bfloat16_to_float(uint16_t value)
+{
+    return bits_float(uint32_t(value) << 16);
+}
+
+uint16_t load_uint16(const uint8_t *input)
+{
+    uint16_t value;
+    memcpy(&value, input, sizeof(value));
+    return value;
+}
+
+void store_float(uint8_t *output, float value)
+{
+    memcpy(output, &value, sizeof(value));
+}
+
+// Convert values starting from index first.
+void dequantize_scalar(const FeatureQuantization &quantization, const uint8_t *input, size_t first, size_t count,
+                       uint8_t *output)
+{
+    for (size_t i = first; i < count; ++i)
+    {
+        float value = 0;
+        switch (quantization.m_encoding)
+        {
+        case FeatureEncoding::float16:
+            value = half_to_float(load_uint16(input + 2 * i));
+            break;
+        case FeatureEncoding::bfloat16:
+            value = bfloat16_to_float(load_uint16(input + 2 * i));
+            break;
+        case FeatureEncoding::int8:
+            value = (float(int8_t(input[i])) - quantization.m_zero_point) * quantization.m_scale;
+            break;
+        default:
+            assert(false);
+        }
+        store_float(output + 4 * i, value);
+    }
+}
+
+template <typename T> std::vector<T> read_array(const std::filesystem::path &path)
+{
+    std::vector<T> result(std::filesystem::file_size(path) / sizeof(T));
+    FilePtr file(open_file(path, "rb"));
+    if (fread(result.data(), sizeof(T), result.size(), *file) != result.size())
+    {
+        RAW_LOG_FATAL("Failed to read %s", path.string().c_str());
+    }
+    return result;
+}
+
+template <typename T> void write_array(const std::filesystem::path &path, const std::vector<T> &data)
+{
+    // Replace files atomically, so a failure doesn't leave a partition with mismatched index and data.
+    auto temp_path = path;
+    temp_path += ".tmp";
+    {
+        FilePtr file(open_file(temp_path, "wb"));
+        if (fwrite(data.data(), sizeof(T), data.size(), *file) != data.size())
+        {
+            RAW_LOG_FATAL("Failed to write %s", temp_path.string().c_str());
+        }
+    }
+    std::filesystem::rename(temp_path, path);
+}
+
+// Node features of a partition: node index has offsets of the first feature of every node in the
+// feature index, which has offsets of feature values in data.
+struct NodeFeatureFiles
+{
+    NodeFeatureFiles(const std::filesystem::path &path, const std::string &suffix)
+        : m_node_index(read_array<uint64_t>(path / ("node_" + suffix + ".index"))),
+          m_feature_index(read_array<uint64_t>(path / ("node_features_" + suffix + ".index"))),
+          m_data(read_array<uint8_t>(path / ("node_features_" + suffix + ".data")))
+    {
+    }
+
+    // Call f(feature_id, feature_index_entry, values) for every feature of every node.
+    template <typename F> void ForEachFeature(F f) const
+    {
+        for (size_t node = 0; node + 1 < m_node_index.size(); ++node)
+        {
+            for (auto entry = m_node_index[node]; entry < m_node_index[node + 1]; ++entry)
+            {
+                const auto begin = m_feature_index[entry];
+                const auto end = m_feature_index[entry + 1];
+                f(size_t(entry - m_node_index[node]), entry, std::span(m_data).subspan(begin, end - begin));
+            }
+        }
+    }
+
+    std::vector<uint64_t> m_node_index;
+    std::vector<uint64_t> m_feature_index;
+    std::vector<uint8_t> m_data;
+};
+
+// Features are not aligned in data files, so values are copied.
+std::vector<float> as_floats(std::span<const uint8_t> data)
+{
+    if (data.size() % sizeof(float) != 0)
+    {
+        RAW_LOG_FATAL("Feature of %zu bytes is not a float32 vector", data.size());
+    }
+    std::vector<float> result(data.size() / sizeof(float));
+    memcpy(result.data(), data.data(), data.size());
+    return result;
+}
+
+#ifdef SNARK_X86_DISPATCH
+// SIMD versions convert full vectors and return the number of converted values, tails are handled by the scalar one.
+__attribute__((target("avx2,f16c"))) size_t dequantize_avx2(const FeatureQuantization &quantization,
+                                                            const uint8_t *input, size_t count, uint8_t *output)
+{
+    size_t i = 0;
+    switch (quantization.m_encoding)
+    {
+    case FeatureEncoding::float16:
+        for (; i + 8 <= count; i += 8)
+        {
+            const auto values = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + 2 * i));
+            _mm256_storeu_ps(reinterpret_cast<float *>(output + 4 * i), _mm256_cvtph_ps(values));
+        }
+        break;
+    case FeatureEncoding::bfloat16:
+        for (; i + 8 <= count; i += 8)
+        {
+            const auto values =
+                _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input + 2 * i)));
+            _mm256_storeu_ps(reinterpret_cast<float *>(output + 4 * i),
+                             _mm256_castsi256_ps(_mm256_slli_epi32(values, 16)));
+        }
+        break;
+    case FeatureEncoding::int8: {
+        const auto scale = _mm256_set1_ps(quantization.m_scale);
+        const auto zero_point = _mm256_set1_ps(quantization.m_zero_point);
+        for (; i + 8 <= count; i += 8)
+        {
+            const auto values = _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(input + i)));
+            _mm256_storeu_ps(reinterpret_cast<float *>(output + 4 * i),
+                             _mm256_mul_ps(_mm256_sub_ps(_mm256_cvtepi32_ps(values), zero_point), scale));
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    return i;
+}
+
+__attribute__((target("avx512f"))) size_t dequantize_avx512(const FeatureQuantization &quantization,
+                                                            const uint8_t *input, size_t count, uint8_t *output)
+{
+    size_t i = 0;
+    switch (quantization.m_encoding)
+    {
+    case FeatureEncoding::float16:
+        for (; i + 16 <= count; i += 16)
+        {
+            const auto values = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input + 2 * i));
+            _mm512_storeu_ps(output + 4 * i, _mm512_cvtph_ps(values));
+        }
+        break;
+    case FeatureEncoding::bfloat16:
+        for (; i + 16 <= count; i += 16)
+        {
+            const auto values =
+                _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(input + 2 * i)));
+            _mm512_storeu_ps(output + 4 * i, _mm512_castsi512_ps(_mm512_slli_epi32(values, 16)));
+        }
+        break;
+    case FeatureEncoding::int8: {
+        const auto scale = _mm512_set1_ps(quantization.m_scale);
+        const auto zero_point = _mm512_set1_ps(quantization.m_zero_point);
+        for (; i + 16 <= count; i += 16)
+        {
+            const auto values = _mm512_cvtepi8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input + i)));
+            _mm512_storeu_ps(output + 4 * i,
+                             _mm512_mul_ps(_mm512_sub_ps(_mm512_cvtepi32_ps(values), zero_point), scale));
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    return i;
+}
+
+enum class SimdLevel
+{
+    none,
+    avx2,
+    avx512
+};
+
+SimdLevel simd_level()
+{
+    static const SimdLevel level = []() {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+        {
+            return SimdLevel::avx512;
+        }
+        // F16C is a separate feature, virtual machines may expose AVX2 without it.
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c") ? SimdLevel::avx2 : SimdLevel::none;
+    }();
+    return level;
+}
+#endif
+} // namespace
+
+size_t encoded_value_size(FeatureEncoding encoding)
+{
+    switch (encoding)
+    {
+    case FeatureEncoding::float16:
+    case FeatureEncoding::bfloat16:
+        return 2;
+    case FeatureEncoding::int8:
+        return 1;
+    default:
+        return 4;
+    }
+}
+
+FeatureQuantization int8_quantization(float min_value, float max_value)
+{
+    FeatureQuantization result;
+    result.m_encoding = FeatureEncoding::int8;
+    result.m_scale = max_value > min_value ? (max_value - min_value) / 255.0f : 1.0f;
+    result.m_zero_point = -128.0f - min_value / result.m_scale;
+    return result;
+}
+
+void quantize(const FeatureQuantization &quantization, std::span<const float> input, std::span<uint8_t> output)
+{
+    assert(input.size() * encoded_value_size(quantization.m_encoding) == output.size());
+    for (size_t i = 0; i < input.size(); ++i)
+    {
+        switch (quantization.m_encoding)
+        {
+        case FeatureEncoding::float16: {
+            const auto value = float_to_half(input[i]);
+            memcpy(output.data() + 2 * i, &value, sizeof(value));
+            break;
+        }
+        case FeatureEncoding::bfloat16: {
+            const auto value = float_to_bfloat16(input[i]);
+            memcpy(output.data() + 2 * i, &value, sizeof(value));
+            break;
+        }
+        case FeatureEncoding::int8: {
+            const float value = std::round(input[i] / quantization.m_scale + quantization.m_zero_point);
+            output[i] = uint8_t(int8_t(std::clamp(value, -128.0f, 127.0f)));
+            break;
+        }
+        default:
+            memcpy(output.data() + 4 * i, &input[i], sizeof(float));
+        }
+    }
+}
+
+void dequantize(const FeatureQuantization &quantization, const uint8_t *input, size_t count, uint8_t *output)
+{
+    if (quantization.m_encoding == FeatureEncoding::float32)
+    {
+        std::copy_n(input, 4 * count, output);
+        return;
+    }
+
+    size_t converted = 0;
+#ifdef SNARK_X86_DISPATCH
+    switch (simd_level())
+    {
+    case SimdLevel::avx512:
+        converted = dequantize_avx512(quantization, input, count, output);
+        break;
+    case SimdLevel::avx2:
+        converted = dequantize_avx2(quantization, input, count, output);
+        break;
+    default:
+        break;
+    }
+#endif
+    dequantize_scalar(quantization, input, converted, count, output);
+}
+
+void quantize_node_features(std::filesystem::path path, std::span<const std::string> suffixes,
+                            std::vector<FeatureQuantization> &quantization)
+{
+    auto encoding = [&quantization](size_t feature_id) {
+        return feature_id < quantization.size() ? quantization[feature_id].m_encoding : FeatureEncoding::float32;
+    };
+
+    // Value ranges of int8 features.
+    const std::pair<float, float> empty_range = {std::numeric_limits<float>::max(),
+                                                 std::numeric_limits<float>::lowest()};
+    std::vector<std::pair<float, float>> ranges(quantization.size(), empty_range);
+    for (const auto &suffix : suffixes)
+    {
+        NodeFeatureFiles files(path, suffix);
+        files.ForEachFeature([&](size_t feature_id, uint64_t, std::span<const uint8_t> data) {
+            if (encoding(feature_id) != FeatureEncoding::int8)
+            {
+                return;
+            }
+            for (auto value : as_floats(data))
+            {
+                ranges[feature_id].first = std::min(ranges[feature_id].first, value);
+                ranges[feature_id].second = std::max(ranges[feature_id].second, value);
+            }
+        });
+    }
+    for (size_t feature_id = 0; feature_id < quantization.size(); ++feature_id)
+    {
+        if (encoding(feature_id) == FeatureEncoding::int8)
+        {
+            quantization[feature_id] = ranges[feature_id].first <= ranges[feature_id].second
+                                           ? int8_quantization(ranges[feature_id].first, ranges[feature_id].second)
+                                           : int8_quantization(0.0f, 0.0f);
+        }
+    }
+
+    for (const auto &suffix : suffixes)
+    {
+        NodeFeatureFiles files(path, suffix);
+        std::vector<uint64_t> feature_index(files.m_feature_index.size());
+        std::vector<uint8_t> data(std::begin(files.m_data),
+                                  std::begin(files.m_data) + (feature_index.empty() ? 0 : files.m_feature_index[0]));
+        data.reserve(files.m_data.size());
+        files.ForEachFeature([&](size_t feature_id, uint64_t entry, std::span<const uint8_t> values) {
+            feature_index[entry] = data.size();
+            if (encoding(feature_id) == FeatureEncoding::float32)
+            {
+                data.insert(std::end(data), std::begin(values), std::end(values));
+                return;
+            }
+
+            const auto floats = as_floats(values);
+            const auto offset = data.size();
+            data.resize(offset + floats.size() * encoded_value_size(quantization[feature_id].m_encoding));
+            quantize(quantization[feature_id], floats, std::span(data).subspan(offset));
+        });
+        if (!feature_index.empty())
+        {
+            feature_index.back() = data.size();
+        }
+
+        write_array(path / ("node_features_" + suffix + ".data"), data);
+        write_array(path / ("node_features_" + suffix + ".index"), feature_index);
+        std::filesystem::remove(path / ("snapshot_" + suffix + ".bin"));
+        std::filesystem::remove(path / ("node_features_" + suffix + ".zdata"));
+    }
+}
+
+} // namespace snark
@@ -0,0 +1,56 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#ifndef SNARK_QUANTIZATION_H
+#define SNARK_QUANTIZATION_H
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace snark
+{
+
+// Storage encoding of float32 node features. Encoded features are converted back to float32 on
+// reads, so clients request the same feature sizes as for raw graphs.
+enum class FeatureEncoding : uint32_t
+{
+    float32 = 0,
+    float16 = 1,
+    bfloat16 = 2,
+    // value = (q - zero_point) * scale, where q is a signed byte.
+    int8 = 3,
+};
+
+struct FeatureQuantization
+{
+    FeatureEncoding m_encoding = FeatureEncoding::float32;
+    float m_scale = 1.0f;
+    float m_zero_point = 0.0f;
+};
+
+// Number of bytes used to store a single value.
+size_t encoded_value_size(FeatureEncoding encoding);
+
+// Scale and zero point mapping the range [min_value, max_value] to all int8 values.
+FeatureQuantization int8_quantization(float min_value, float max_value);
+
+// Encode input values to output, output size must be input.size() * encoded_value_size(...).
+void quantize(const FeatureQuantization &quantization, std::span<const float> input, std::span<uint8_t> output);
+
+// Decode count values from input and write them as float32 to output, buffers don't have to be aligned.
+// Uses AVX-512 or AVX2 instructions if they are supported by the CPU.
+void dequantize(const FeatureQuantization &quantization, const uint8_t *input, size_t count, uint8_t *output);
+
+// Re-encode float32 node features of partitions with suffixes located in path according to quantization, which is
+// indexed by feature id. Scales and zero points of int8 features are computed from value ranges across all the
+// partitions. Partition snapshots and block compressed copies of node feature data are removed, because they hold
+// offsets or values of the original features.
+void quantize_node_features(std::filesystem::path path, std::span<const std::string> suffixes,
+                            std::vector<FeatureQuantization> &quantization);
+
+} // namespace snark
+
+#endif // SNARK_QUANTIZATION_H
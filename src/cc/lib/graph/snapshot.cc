@@ -0,0 +1,162 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#include "snapshot.h"
+
+#include <cstdio>
+#include <cstring>
+#include <system_error>
+#include <utility>
+
+namespace snark
+{
+namespace
+{
+// "SNAPSHOT" in little endian.
+const uint64_t snapshot_magic = 0x544F485350414E53ull;
+
+// Arrays are aligned to cache lines.
+const uint64_t snapshot_alignment = 64;
+
+// Snapshot is rebuilt from these files, their sizes and modification times are recorded to detect stale snapshots.
+const std::pair<const char *, const char *> source_files[] = {
+    {"node_", ".map"},      {"node_", ".index"}, {"node_features_", ".index"},
+    {"neighbors_", ".index"}, {"edge_", ".index"}, {"edge_features_", ".index"}};
+const size_t source_file_count = std::size(source_files);
+
+struct SnapshotHeader
+{
+    uint64_t m_magic;
+    uint32_t m_version;
+    uint32_t m_array_count;
+    uint64_t m_source_sizes[source_file_count];
+    int64_t m_source_times[source_file_count];
+};
+
+std::filesystem::path snapshot_path(const std::filesystem::path &path, const std::string &suffix)
+{
+    return path / ("snapshot_" + suffix + ".bin");
+}
+
+// Size of a source file or 0 if the file is absent, e.g. feature indices for graphs without features.
+uint64_t source_size(const std::filesystem::path &path, const std::string &suffix,
+                     const std::pair<const char *, const char *> &file)
+{
+    std::error_code error;
+    const auto size = std::filesystem::file_size(path / (file.first + suffix + file.second), error);
+    return error ? 0 : uint64_t(size);
+}
+
+// Modification time of a source file or 0 if the file is absent. Rewriting a file with the same size,
+// e.g. new edge weights, changes only its modification time.
+int64_t source_time(const std::filesystem::path &path, const std::string &suffix,
+                    const std::pair<const char *, const char *> &file)
+{
+    std::error_code error;
+    const auto time = std::filesystem::last_write_time(path / (file.first + suffix + file.second), error);
+    return error ? 0 : int64_t(time.time_since_epoch().count());
+}
+
+void write_bytes(FILE *file, const void *data, size_t size)
+{
+    if (size > 0 && fwrite(data, 1, size, file) != size)
+    {
+        RAW_LOG_FATAL("Failed to write snapshot: %s", strerror(errno));
+    }
+}
+} // namespace
+
+bool has_snapshot(std::filesystem::path path, std::string suffix)
+{
+    std::error_code error;
+    return std::filesystem::is_regular_file(snapshot_path(path, suffix), error);
+}
+
+void SnapshotWriter::Write(std::filesystem::path path, std::string suffix) const
+{
+    SnapshotHeader header = {};
+    header.m_magic = snapshot_magic;
+    header.m_version = SNAPSHOT_VERSION;
+    header.m_array_count = uint32_t(m_arrays.size());
+    for (size_t i = 0; i < source_file_count; ++i)
+    {
+        header.m_source_sizes[i] = source_size(path, suffix, source_files[i]);
+        header.m_source_times[i] = source_time(path, suffix, source_files[i]);
+    }
+
+    std::vector<SnapshotReader::Entry> entries(m_arrays.size());
+    uint64_t offset = sizeof(SnapshotHeader) + entries.size() * sizeof(SnapshotReader::Entry);
+    for (size_t i = 0; i < m_arrays.size(); ++i)
+    {
+        offset = (offset + snapshot_alignment - 1) / snapshot_alignment * snapshot_alignment;
+        entries[i] = {offset, m_arrays[i].m_count, m_arrays[i].m_element_size};
+        offset += m_arrays[i].m_count * m_arrays[i].m_element_size;
+    }
+
+    // Write to a temporary file first, so readers never see a partially written snapshot.
+    const auto final_path = snapshot_path(path, suffix);
+    auto temp_path = final_path;
+    temp_path += ".tmp";
+    {
+        FilePtr file(open_file(temp_path, "wb"));
+        write_bytes(*file, &header, sizeof(header));
+        write_bytes(*file, entries.data(), entries.size() * sizeof(SnapshotReader::Entry));
+        uint64_t position = sizeof(SnapshotHeader) + entries.size() * sizeof(SnapshotReader::Entry);
+        const std::vector<uint8_t> padding(snapshot_alignment, 0);
+        for (size_t i = 0; i < m_arrays.size(); ++i)
+        {
+            write_bytes(*file, padding.data(), entries[i].m_offset - position);
+            const uint64_t size = entries[i].m_count * entries[i].m_element_size;
+            write_bytes(*file, m_arrays[i].m_data, size);
+            position = entries[i].m_offset + size;
+        }
+    }
+
+    std::filesystem::rename(temp_path, final_path);
+}
+
+SnapshotReader::SnapshotReader(std::filesystem::path path, std::string suffix)
+    : m_file(std::make_shared<FilePtr>(open_snapshot(path, suffix)))
+{
+    SnapshotHeader header;
+    if (platform_pread(**m_file, &header, sizeof(header), 0) != sizeof(header) || header.m_magic != snapshot_magic)
+    {
+        RAW_LOG_WARNING("Ignoring snapshot %s: unknown format", snapshot_path(path, suffix).string().c_str());
+        return;
+    }
+
+    if (header.m_version != SNAPSHOT_VERSION || header.m_array_count != uint32_t(SnapshotArray::count))
+    {
+        RAW_LOG_WARNING("Ignoring snapshot %s: version %u, expected %u", snapshot_path(path, suffix).string().c_str(),
+                        header.m_version, SNAPSHOT_VERSION);
+        return;
+    }
+
+    for (size_t i = 0; i < source_file_count; ++i)
+    {
+        if (header.m_source_sizes[i] != source_size(path, suffix, source_files[i]) ||
+            header.m_source_times[i] != source_time(path, suffix, source_files[i]))
+        {
+            RAW_LOG_WARNING("Ignoring snapshot %s: partition files changed after it was written",
+                            snapshot_path(path, suffix).string().c_str());
+            return;
+        }
+    }
+
+    std::vector<Entry> entries(header.m_array_count);
+    const uint64_t size = entries.size() * sizeof(Entry);
+    if (platform_pread(**m_file, entries.data(), size, sizeof(header)) != size)
+    {
+        RAW_LOG_WARNING("Ignoring snapshot %s: truncated file", snapshot_path(path, suffix).string().c_str());
+        return;
+    }
+
+    m_entries = std::move(entries);
+}
+
+bool SnapshotReader::Valid() const
+{
+    return !m_entries.empty();
+}
+
+} // namespace snark
@@ -0,0 +1,110 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#ifndef SNARK_SNAPSHOT_H
+#define SNARK_SNAPSHOT_H
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "locator.h"
+#include "storage.h"
+
+#include <glog/logging.h>
+#include <glog/raw_logging.h>
+
+namespace snark
+{
+
+// Snapshots hold arrays of a partition in their final in-memory layout, so loading them is a
+// single read per array instead of re-deriving edge type runs and cumulative weights from records.
+// Increment the version on any layout change, snapshots with a different version are ignored.
+const uint32_t SNAPSHOT_VERSION = 2;
+
+// Arrays stored in a snapshot.
+enum class SnapshotArray : uint32_t
+{
+    node_ids,
+    node_types,
+    node_index,
+    node_feature_index,
+    edge_feature_index,
+    edge_feature_offset,
+    edge_types,
+    edge_type_offset,
+    edge_destination,
+    edge_weights,
+    neighbors_index,
+    count
+};
+
+bool has_snapshot(std::filesystem::path path, std::string suffix);
+
+class SnapshotWriter
+{
+  public:
+    // Data must stay alive until Write is called.
+    template <typename T> void Add(SnapshotArray array, std::span<const T> data)
+    {
+        m_arrays[size_t(array)] = Array{reinterpret_cast<const uint8_t *>(data.data()), data.size(), sizeof(T)};
+    }
+
+    // Write snapshot next to the partition files with suffix located in path.
+    void Write(std::filesystem::path path, std::string suffix) const;
+
+  private:
+    struct Array
+    {
+        const uint8_t *m_data = nullptr;
+        uint64_t m_count = 0;
+        uint64_t m_element_size = 0;
+    };
+
+    std::array<Array, size_t(SnapshotArray::count)> m_arrays;
+};
+
+class SnapshotReader
+{
+  public:
+    // Snapshot must exist, use has_snapshot to check. Snapshots of a different version or built
+    // from different partition files are reported as invalid.
+    SnapshotReader(std::filesystem::path path, std::string suffix);
+
+    bool Valid() const;
+
+    template <typename T, typename A> void Read(SnapshotArray array, std::vector<T, A> &output) const
+    {
+        const auto &entry = m_entries[size_t(array)];
+        if (entry.m_element_size != sizeof(T))
+        {
+            RAW_LOG_FATAL("Unexpected element size %lu in snapshot array %u", entry.m_element_size, uint32_t(array));
+        }
+
+        output.resize(entry.m_count);
+        const uint64_t size = entry.m_count * entry.m_element_size;
+        if (platform_pread(**m_file, output.data(), size, entry.m_offset) != size)
+        {
+            RAW_LOG_FATAL("Failed to read snapshot array %u", uint32_t(array));
+        }
+    }
+
+    struct Entry
+    {
+        uint64_t m_offset;
+        uint64_t m_count;
+        uint64_t m_element_size;
+    };
+
+  private:
+    std::shared_ptr<FilePtr> m_file;
+    std::vector<Entry> m_entries;
+};
+
+} // namespace snark
+
+#endif // SNARK_SNAPSHOT_H
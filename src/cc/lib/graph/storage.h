@@ -4,11 +4,19 @@
 #ifndef SNARK_STORAGE_BASE_H
 #define SNARK_STORAGE_BASE_H
 
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
 #include <iterator>
 #include <span>
 #include <stdexcept>
+#include <vector>
 
+#ifndef SNARK_PLATFORM_WINDOWS
+#include <sys/mman.h>
+#endif
+
+#include "huge_pages.h"
 #include "locator.h"
 #include "types.h"
 
@@ -46,21 +54,50 @@ template <typename T> struct BaseStorage
     virtual ~BaseStorage() = default;
     virtual size_t size() = 0;
     virtual std::shared_ptr<FilePtr> start() = 0;
+    // Sequential read from a stream returned by start().
     virtual size_t read(void *output, size_t size, size_t count, std::shared_ptr<FilePtr> file_ptr_temp) = 0;
+    // Random access read of size elements at offset. Storages manage file handles for these reads themselves.
     virtual typename std::span<T>::iterator read(uint64_t offset, uint64_t size,
                                                  typename std::span<T>::iterator output_ptr,
                                                  std::shared_ptr<FilePtr> file_ptr) const = 0;
+    // Local file backing random access reads, if any. Callers can use it to batch positional reads.
+    virtual FILE *handle() const
+    {
+        return nullptr;
+    }
+    // Data of storages kept in memory or mapped to it, so it can be read in place. Empty for other storages.
+    virtual std::span<const T> view() const
+    {
+        return {};
+    }
 };
 
+// Read count records of type R from a sequential stream in large chunks and pass them to process(offset, records),
+// where offset is the index of the first record in the chunk. Used to load index files without a read call per record.
+template <typename R, typename F>
+void read_records(BaseStorage<uint8_t> &storage, std::shared_ptr<FilePtr> file_ptr, size_t count, F process)
+{
+    const size_t chunk_size = std::max<size_t>(1, (size_t(1) << 22) / sizeof(R));
+    std::vector<R> buffer(std::min(count, chunk_size));
+    for (size_t offset = 0; offset < count; offset += buffer.size())
+    {
+        const size_t records = std::min(buffer.size(), count - offset);
+        if (storage.read(buffer.data(), sizeof(R), records, file_ptr) != records)
+        {
+            RAW_LOG_FATAL("Failed to read %zu records at %zu", records, offset);
+        }
+        process(offset, std::span<const R>(buffer.data(), records));
+    }
+}
+
 template <typename T> struct MemoryStorage : BaseStorage<T>
 {
   public:
     MemoryStorage()
     {
     }
-    MemoryStorage(std::vector<T> data)
+    MemoryStorage(snark::huge_vector<T> data) : m_data(std::move(data))
     {
-        m_data = std::move(data);
     }
     MemoryStorage(const std::filesystem::path path, const std::string suffix, const open_file_ptr open_file)
     {
@@ -106,8 +143,96 @@ template <typename T> struct MemoryStorage : BaseStorage<T>
         return output_ptr;
     }
 
+    std::span<const T> view() const override
+    {
+        return m_data;
+    }
+
+  private:
+    snark::huge_vector<T> m_data;
+};
+
+// Serve reads directly from a read-only shared mapping of a file. Unlike MemoryStorage
+// the data is not copied to the heap: pages are loaded lazily by the kernel and
+// shared between all processes mapping the same file.
+template <typename T> struct MmapStorage final : BaseStorage<T>
+{
+  public:
+    MmapStorage(std::filesystem::path path, std::string suffix, open_file_ptr open_file)
+    {
+        if (open_file == nullptr)
+            return;
+#ifdef SNARK_PLATFORM_WINDOWS
+        RAW_LOG_FATAL("Memory mapped storage is not supported on windows!");
+#else
+        auto file_ptr = open_file(std::move(path), std::move(suffix));
+
+        snark::platform_fseek(file_ptr, 0L, SEEK_END);
+        m_size = snark::platform_ftell(file_ptr);
+        if (m_size > 0)
+        {
+            auto data = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fileno(file_ptr), 0);
+            if (data == MAP_FAILED)
+            {
+                RAW_LOG_FATAL("Failed to map features data: %s", strerror(errno));
+            }
+            m_data = static_cast<T *>(data);
+        }
+
+        // Mapping stays valid after the file is closed.
+        fclose(file_ptr);
+#endif
+    }
+
+    MmapStorage(const MmapStorage &) = delete;
+    MmapStorage &operator=(const MmapStorage &) = delete;
+
+    ~MmapStorage()
+    {
+#ifndef SNARK_PLATFORM_WINDOWS
+        if (m_data != nullptr)
+        {
+            ::munmap(m_data, m_size);
+        }
+#endif
+    }
+
+    size_t size() override
+    {
+        return m_size;
+    }
+
+    std::shared_ptr<FilePtr> start() override
+    {
+        return std::make_shared<FilePtr>(nullptr);
+    }
+
+    size_t read(void *output, size_t size, size_t count, std::shared_ptr<FilePtr> file_ptr_temp) override
+    {
+        RAW_LOG_FATAL("pointer read not supported by MmapStorage!");
+        return -1;
+    }
+
+    typename std::span<T>::iterator read(uint64_t offset, uint64_t size, typename std::span<T>::iterator output_ptr,
+                                         std::shared_ptr<FilePtr> file_ptr) const override
+    {
+        return std::copy_n(m_data + offset, size, output_ptr);
+    }
+
+    // Pointer to the mapped file for callers interpreting it in place.
+    const T *data() const
+    {
+        return m_data;
+    }
+
+    std::span<const T> view() const override
+    {
+        return std::span<const T>(m_data, m_size);
+    }
+
   private:
-    std::vector<T> m_data;
+    T *m_data = nullptr;
+    size_t m_size = 0;
 };
 
 template <typename T> struct HDFSStorage final : public MemoryStorage<T>
@@ -115,7 +240,7 @@ template <typename T> struct HDFSStorage final : public MemoryStorage<T>
   public:
     HDFSStorage(const char *hdfs_path, const std::string config_path, const std::string suffix,
                 const open_file_ptr open_file)
-        : MemoryStorage<T>(std::move(read_hdfs<T>(hdfs_path, config_path)))
+        : MemoryStorage<T>(read_hdfs<T>(hdfs_path, config_path))
     {
     }
 
@@ -231,6 +356,9 @@ template <typename T> struct HDFSStreamStorage final : BaseStorage<T>
     size_t m_offset;
 };
 
+// Disk storage keeps a single file handle open for the lifetime of the storage and serves
+// random access reads with positional reads, which are thread safe and don't require
+// seeking or opening the file for every request.
 template <typename T> struct DiskStorage final : BaseStorage<T>
 {
   public:
@@ -242,12 +370,10 @@ template <typename T> struct DiskStorage final : BaseStorage<T>
         if (open_file == nullptr)
             return;
 
-        auto file_ptr = m_open_file(m_path, m_suffix);
+        m_file = std::make_shared<FilePtr>(m_open_file(m_path, m_suffix));
 
-        snark::platform_fseek(file_ptr, 0L, SEEK_END);
-        m_size = snark::platform_ftell(file_ptr);
-
-        fclose(file_ptr);
+        snark::platform_fseek(**m_file, 0L, SEEK_END);
+        m_size = snark::platform_ftell(**m_file);
     }
 
     DiskStorage(std::filesystem::path path, size_t partition, snark::Type type, open_alias_file_ptr open_file)
@@ -259,11 +385,10 @@ template <typename T> struct DiskStorage final : BaseStorage<T>
         if (open_file == nullptr)
             return;
 
-        auto file_ptr = m_open_alias_file(m_path, m_partition, m_type);
+        m_file = std::make_shared<FilePtr>(m_open_alias_file(m_path, m_partition, m_type));
 
-        snark::platform_fseek(file_ptr, 0L, SEEK_END);
-        m_size = snark::platform_ftell(file_ptr);
-        fclose(file_ptr);
+        snark::platform_fseek(**m_file, 0L, SEEK_END);
+        m_size = snark::platform_ftell(**m_file);
     }
 
     size_t size() override
@@ -271,6 +396,7 @@ template <typename T> struct DiskStorage final : BaseStorage<T>
         return m_size;
     }
 
+    // Open a new stream for sequential reads with the pointer read method.
     std::shared_ptr<FilePtr> start() override
     {
         FILE *file_ptr;
@@ -293,25 +419,25 @@ template <typename T> struct DiskStorage final : BaseStorage<T>
         return fread(output, size, count, file_ptr);
     }
 
+    // Random access reads use the file handle owned by the storage, file_ptr is ignored.
     typename std::span<T>::iterator read(uint64_t offset, uint64_t size, typename std::span<T>::iterator output_ptr,
-                                         std::shared_ptr<FilePtr> file_ptr_temp) const override
+                                         std::shared_ptr<FilePtr> file_ptr) const override
     {
-        FILE *file_ptr = **file_ptr_temp;
-
-        if (file_ptr == nullptr)
+        if (m_file == nullptr)
             throw std::out_of_range("File not open!");
-        if (feof(file_ptr))
-            throw std::out_of_range("File closed unexpectedly!");
         if (offset >= m_size)
             throw std::out_of_range("Offset out of range!");
 
-        snark::platform_fseek(file_ptr, offset, SEEK_SET);
-
-        output_ptr += fread(&(*output_ptr), sizeof(T), size, file_ptr);
+        output_ptr += snark::platform_pread(**m_file, &(*output_ptr), sizeof(T) * size, offset) / sizeof(T);
 
         return output_ptr;
     }
 
+    FILE *handle() const override
+    {
+        return m_file == nullptr ? nullptr : **m_file;
+    }
+
   private:
     std::filesystem::path m_path = "";
     std::string m_suffix = "";
@@ -319,6 +445,7 @@ template <typename T> struct DiskStorage final : BaseStorage<T>
     snark::Type m_type = 0;
     open_file_ptr m_open_file = nullptr;
     open_alias_file_ptr m_open_alias_file = nullptr;
+    std::shared_ptr<FilePtr> m_file;
     uint64_t m_size = 0;
 };
 
@@ -3,9 +3,14 @@
 
 #ifndef SNARK_TYPES_H
 #define SNARK_TYPES_H
+#include <cstdint>
 #include <cstdlib>
 #include <utility>
 
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#endif
+
 namespace snark
 {
 
@@ -17,11 +22,72 @@ using FeatureMeta = std::pair<FeatureId, FeatureSize>;
 
 const int32_t PLACEHOLDER_NODE_TYPE = -1;
 
+// Hint to load the cache line with address for a read, batch lookups issue it ahead of the loads
+// to overlap cache misses of independent nodes.
+inline void prefetch(const void *address)
+{
+#if defined(_MSC_VER)
+    _mm_prefetch(reinterpret_cast<const char *>(address), _MM_HINT_T0);
+#else
+    __builtin_prefetch(address);
+#endif
+}
+
+// Record layout of node_*.map files.
+#pragma pack(push, 1)
+struct NodeMapRecord
+{
+    NodeId m_node_id;
+    uint64_t m_internal_id;
+    Type m_type;
+};
+#pragma pack(pop)
+static_assert(sizeof(NodeMapRecord) == 20);
+
 // Enum ordering should match PyPartitionStorageType in py_graph.h.
 enum PartitionStorageType
 {
     memory,
     disk,
+    mmap,
+    // Features of the highest degree nodes are pinned in memory, the rest are read from disk.
+    hybrid,
+};
+
+// Default memory budget of decompressed blocks of compressed feature data of a graph.
+const size_t DEFAULT_BLOCK_CACHE_SIZE = size_t(64) << 20;
+
+// Optional layouts and caches of a graph loaded from partitions, defaults keep every option disabled except
+// the cache of compressed feature data. Fields should match PyGraphOptions in py_graph.h.
+struct GraphOptions
+{
+    // Memory budget in bytes of the cache for features read from disk, shared by all partitions.
+    size_t m_feature_cache_size = 0;
+    // Memory budget in bytes of decompressed blocks of compressed feature data read from disk, shared by all
+    // partitions. Node and edge features of a partition get half of its share each, 0 disables the cache.
+    size_t m_block_cache_size = DEFAULT_BLOCK_CACHE_SIZE;
+    // Memory budget in bytes for features of the highest degree nodes of hybrid partitions.
+    size_t m_pinned_features_size = 0;
+    // Allocate partitions on NUMA nodes and serve requests with workers bound to them, only used by graph
+    // engine servers. numa_node_count overrides the number of nodes of the machine topology if it is not 0.
+    bool m_numa = false;
+    size_t m_numa_node_count = 0;
+    // Back large neighbor, node map and in memory feature arrays with huge pages if the OS provides them.
+    bool m_huge_pages = false;
+    // Store node features of the same size for every node of memory partitions feature-major.
+    bool m_columnar_features = false;
+    // Store features of node types with the same feature sizes for every node in a tensor per type without
+    // the feature index.
+    bool m_dense_features = false;
+    // Keep neighbor ids delta encoded in blocks.
+    bool m_compressed_neighbors = false;
+    // Replace neighbor ids with 32 bit indices in a table shared by all partitions.
+    bool m_compact_neighbor_ids = false;
+    // Weighted edges of a node and type with at least alias_degree_threshold edges are sampled from alias tables,
+    // smaller runs with at least search_tree_degree_threshold edges are searched in a tree of blocks of cumulative
+    // weights instead of a binary search. 0 disables them.
+    size_t m_alias_degree_threshold = 0;
+    size_t m_search_tree_degree_threshold = 0;
 };
 
 } // namespace snark
@@ -228,9 +228,30 @@ int32_t SampleEdges(PySampler *py_sampler, int64_t seed, size_t count, NodeID *o
     }
 }
 
+snark::GraphOptions to_graph_options(const PyGraphOptions *options)
+{
+    if (options == nullptr)
+    {
+        return {};
+    }
+
+    return snark::GraphOptions{.m_feature_cache_size = options->feature_cache_size,
+                               .m_block_cache_size = options->block_cache_size,
+                               .m_pinned_features_size = options->pinned_features_size,
+                               .m_numa = options->numa,
+                               .m_numa_node_count = options->numa_node_count,
+                               .m_huge_pages = options->huge_pages,
+                               .m_columnar_features = options->columnar_features,
+                               .m_dense_features = options->dense_features,
+                               .m_compressed_neighbors = options->compressed_neighbors,
+                               .m_compact_neighbor_ids = options->compact_neighbor_ids,
+                               .m_alias_degree_threshold = options->alias_degree_threshold,
+                               .m_search_tree_degree_threshold = options->search_tree_degree_threshold};
+}
+
 int32_t CreateLocalGraph(PyGraph *py_graph, const char *meta_location, size_t count, uint32_t *partitions,
                          const char **partition_locations, PyPartitionStorageType storage_type_,
-                         const char *config_path)
+                         const PyGraphOptions *options, const char *config_path)
 {
     snark::PartitionStorageType storage_type = static_cast<snark::PartitionStorageType>(storage_type_);
     snark::Metadata metadata(meta_location, config_path);
@@ -244,8 +265,9 @@ int32_t CreateLocalGraph(PyGraph *py_graph, const char *meta_location, size_t co
 
     py_graph->graph = std::make_unique<GraphInternal>();
     std::vector<size_t> partition_indices(partitions, partitions + count);
-    py_graph->graph->graph = std::make_unique<snark::Graph>(
-        metadata, partition_paths, std::vector<uint32_t>(partitions, partitions + count), storage_type);
+    py_graph->graph->graph =
+        std::make_unique<snark::Graph>(metadata, partition_paths, std::vector<uint32_t>(partitions, partitions + count),
+                                       storage_type, to_graph_options(options));
     py_graph->graph->node_sampler_factory[SamplerType::Weighted] =
         std::make_shared<snark::WeightedNodeSamplerFactory>(metadata, partition_paths, partition_indices);
     py_graph->graph->node_sampler_factory[SamplerType::Uniform] =
@@ -925,6 +947,44 @@ int32_t RandomWalk(PyGraph *py_graph, int64_t seed, float p, float q, NodeID def
     return 0;
 }
 
+int32_t GetFeatureCacheStats(PyGraph *py_graph, uint64_t *hits, uint64_t *misses)
+{
+    if (py_graph->graph == nullptr || py_graph->graph->graph == nullptr)
+    {
+        RAW_LOG_ERROR("Feature cache statistics are only available for local graphs");
+        return 1;
+    }
+
+    const auto stats = py_graph->graph->graph->GetFeatureCacheStats();
+    *hits = stats.m_hits;
+    *misses = stats.m_misses;
+    return 0;
+}
+
+int32_t GetNodeFeatureViews(PyGraph *py_graph, NodeID *node_ids, size_t node_ids_size, Feature *features,
+                            size_t features_size, const uint8_t **out_data, uint64_t *out_sizes)
+{
+    if (py_graph->graph == nullptr || py_graph->graph->graph == nullptr)
+    {
+        RAW_LOG_ERROR("Feature views are only available for local graphs");
+        return 1;
+    }
+
+    std::vector<std::span<const uint8_t>> views(node_ids_size * features_size);
+    const auto nodes = std::span(reinterpret_cast<snark::NodeId *>(node_ids), node_ids_size);
+    if (!py_graph->graph->graph->GetNodeFeatureViews(nodes, std::span(features, features_size), views))
+    {
+        return 2;
+    }
+
+    for (size_t i = 0; i < views.size(); ++i)
+    {
+        out_data[i] = views[i].data();
+        out_sizes[i] = views[i].size();
+    }
+    return 0;
+}
+
 int32_t ResetSampler(PySampler *py_sampler)
 {
     py_sampler->sampler.reset();
@@ -20,6 +20,7 @@ namespace snark
 {
 class Sampler;
 class GRPCServer;
+struct GraphOptions;
 } // namespace snark
 
 namespace deep_graph
@@ -46,6 +47,8 @@ enum PyPartitionStorageType // C interface to PartitionStoragetype in types.h
 {
     memory,
     disk,
+    mmap,
+    hybrid,
 };
 #else
 
@@ -61,6 +64,8 @@ enum PyPartitionStorageType // C interface to PartitionStoragetype in types.h
 {
     memory,
     disk,
+    mmap,
+    hybrid,
 };
 #endif
 
@@ -76,15 +81,33 @@ extern "C"
     typedef void (*GetSparseFeaturesCallback)(const int64_t **, size_t *, const uint8_t **, size_t *, int64_t *);
     typedef void (*GetStringFeaturesCallback)(size_t, const uint8_t *);
 
+    // C interface to GraphOptions in types.h, fields have the same meaning.
+    typedef struct PyGraphOptions
+    {
+        size_t feature_cache_size;
+        size_t block_cache_size;
+        size_t pinned_features_size;
+        bool numa;
+        size_t numa_node_count;
+        bool huge_pages;
+        bool columnar_features;
+        bool dense_features;
+        bool compressed_neighbors;
+        bool compact_neighbor_ids;
+        size_t alias_degree_threshold;
+        size_t search_tree_degree_threshold;
+    } PyGraphOptions;
+
     DEEPGNN_DLL extern int32_t CreateLocalGraph(PyGraph *graph, const char *meta_location, size_t count,
                                                 uint32_t *partition_indices, const char **partition_locations,
-                                                PyPartitionStorageType storage_type, const char *config_path);
+                                                PyPartitionStorageType storage_type, const PyGraphOptions *options,
+                                                const char *config_path);
 
     DEEPGNN_DLL extern int32_t StartServer(PyServer *graph, const char *meta_location, size_t count,
                                            uint32_t *partition_indices, const char **partition_locations,
                                            const char *host_name, const char *ssl_key, const char *ssl_cert,
                                            const char *ssl_root, const PyPartitionStorageType storage_type,
-                                           const char *config_path);
+                                           const PyGraphOptions *options, const char *config_path);
 
     DEEPGNN_DLL extern int32_t CreateRemoteClient(PyGraph *graph, const char *output_folder, const char **connection,
                                                   size_t connection_count, const char *ssl_cert, size_t num_threads,
@@ -152,6 +175,16 @@ extern "C"
     DEEPGNN_DLL extern int32_t SampleEdges(PySampler *sampler, int64_t seed, size_t count, NodeID *out_src_id,
                                            NodeID *out_dst_id, Type *out_type);
 
+    // Feature cache statistics are only available for local graphs.
+    DEEPGNN_DLL extern int32_t GetFeatureCacheStats(PyGraph *graph, uint64_t *hits, uint64_t *misses);
+
+    // Pointers to stored node features and their sizes in bytes without copying them, valid while the graph is
+    // loaded. Outputs have a slot per node and feature, ordered by nodes first. Views are only available for
+    // local graphs, return 2 if some feature has to be copied with GetNodeFeature or GetNodeStringFeature.
+    DEEPGNN_DLL extern int32_t GetNodeFeatureViews(PyGraph *graph, NodeID *node_ids, size_t node_ids_size,
+                                                   Feature *features, size_t features_size, const uint8_t **out_data,
+                                                   uint64_t *out_sizes);
+
     DEEPGNN_DLL extern int32_t ResetSampler(PySampler *sampler);
     DEEPGNN_DLL extern int32_t ResetGraph(PyGraph *graph);
     DEEPGNN_DLL extern int32_t ResetServer(PyServer *graph);
@@ -162,6 +195,9 @@ extern "C"
 #ifdef __cplusplus
 }
 
+// Options of the C interface, defaults if options is null.
+snark::GraphOptions to_graph_options(const PyGraphOptions *options);
+
 } // python
 } // deep_graph
 #endif
@@ -31,7 +31,8 @@ std::string safe_convert(const char *buffer)
 
 int32_t StartServer(PyServer *graph, const char *meta_location, size_t count, uint32_t *partition_indices,
                     const char **partition_locations, const char *host_name, const char *ssl_key, const char *ssl_cert,
-                    const char *ssl_root, const PyPartitionStorageType storage_type_, const char *config_path)
+                    const char *ssl_root, const PyPartitionStorageType storage_type_, const PyGraphOptions *options,
+                    const char *config_path)
 {
     snark::PartitionStorageType storage_type = static_cast<snark::PartitionStorageType>(storage_type_);
     snark::Metadata metadata(safe_convert(meta_location), safe_convert(config_path));
@@ -41,13 +42,15 @@ int32_t StartServer(PyServer *graph, const char *meta_location, size_t count, ui
     {
         partition_paths.emplace_back(safe_convert(partition_locations[i]));
     }
+    auto engine = std::make_shared<snark::GraphEngineServiceImpl>(
+        metadata, partition_paths, std::vector<uint32_t>(partition_indices, partition_indices + count),
+        static_cast<snark::PartitionStorageType>(storage_type), to_graph_options(options));
+    const auto numa_nodes = engine->NumaNodeCount();
     graph->server = std::make_unique<snark::GRPCServer>(
-        std::make_shared<snark::GraphEngineServiceImpl>(
-            metadata, partition_paths, std::vector<uint32_t>(partition_indices, partition_indices + count),
-            static_cast<snark::PartitionStorageType>(storage_type)),
+        std::move(engine),
         std::make_shared<snark::GraphSamplerServiceImpl>(
             metadata, partition_paths, std::vector<size_t>(partition_indices, partition_indices + count)),
-        safe_convert(host_name), safe_convert(ssl_key), safe_convert(ssl_cert), safe_convert(ssl_root));
+        safe_convert(host_name), safe_convert(ssl_key), safe_convert(ssl_cert), safe_convert(ssl_root), numa_nodes);
     return 0;
 }
 
@@ -0,0 +1,54 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// Write block compressed copies of node and edge feature data of local graph partitions, graph engines
+// read them instead of raw data files with PartitionStorageType.disk:
+//   compress_features <graph_path> [block_size]
+// Raw data files are kept for other storage types and can be removed if only disk storage is used.
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "src/cc/lib/graph/compressed_storage.h"
+
+#include <glog/logging.h>
+#include <glog/raw_logging.h>
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <graph_path> [block_size]\n", argv[0]);
+        return 1;
+    }
+
+    const std::filesystem::path path = argv[1];
+    const uint32_t block_size = argc > 2 ? uint32_t(std::stoul(argv[2])) : snark::DEFAULT_COMPRESSED_BLOCK_SIZE;
+    size_t count = 0;
+    for (auto &p : std::filesystem::directory_iterator(path))
+    {
+        const auto stem = p.path().stem().string();
+        if (p.path().extension() != ".data" ||
+            !(stem.starts_with("node_features_") || stem.starts_with("edge_features_")))
+        {
+            continue;
+        }
+
+        auto output = p.path();
+        output.replace_extension(".zdata");
+        snark::write_compressed_data(p.path(), output, block_size);
+        RAW_LOG_INFO("Compressed %s from %zu to %zu bytes", p.path().filename().string().c_str(),
+                     size_t(std::filesystem::file_size(p.path())), size_t(std::filesystem::file_size(output)));
+        ++count;
+    }
+
+    if (count == 0)
+    {
+        RAW_LOG_FATAL("No feature data found in %s", path.string().c_str());
+    }
+
+    return 0;
+}
@@ -0,0 +1,92 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// Re-encode float32 node features of a local graph in place to reduce memory used by partitions,
+// graph engines decode them back to float32 on reads:
+//   quantize_features <graph_path> <feature_id>:<float16|bfloat16|int8> [...]
+// Encodings are recorded in the meta file, every partition in the folder is converted. Snapshots and
+// compressed node feature data (.zdata) of the partitions are removed, run write_snapshot and
+// compress_features again to recreate them from quantized features.
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "src/cc/lib/graph/metadata.h"
+#include "src/cc/lib/graph/quantization.h"
+
+#include <glog/logging.h>
+#include <glog/raw_logging.h>
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: %s <graph_path> <feature_id>:<float16|bfloat16|int8> [...]\n", argv[0]);
+        return 1;
+    }
+
+    const std::filesystem::path path = argv[1];
+    snark::Metadata metadata(path);
+    if (!metadata.m_node_feature_quantization.empty())
+    {
+        RAW_LOG_FATAL("Node features in %s are already quantized", path.string().c_str());
+    }
+
+    std::vector<snark::FeatureQuantization> quantization(metadata.m_node_feature_count);
+    for (int i = 2; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const auto separator = arg.find(':');
+        const size_t feature_id = separator == std::string::npos ? 0 : std::stoul(arg.substr(0, separator));
+        const auto name = separator == std::string::npos ? "" : arg.substr(separator + 1);
+        if (feature_id >= quantization.size())
+        {
+            RAW_LOG_FATAL("Feature id in %s is out of range, graph has %zu node features", arg.c_str(),
+                          quantization.size());
+        }
+        if (name == "float16")
+        {
+            quantization[feature_id].m_encoding = snark::FeatureEncoding::float16;
+        }
+        else if (name == "bfloat16")
+        {
+            quantization[feature_id].m_encoding = snark::FeatureEncoding::bfloat16;
+        }
+        else if (name == "int8")
+        {
+            quantization[feature_id].m_encoding = snark::FeatureEncoding::int8;
+        }
+        else
+        {
+            RAW_LOG_FATAL("Unknown feature encoding %s", arg.c_str());
+        }
+    }
+
+    // Every partition has a neighbors index, same as in graph engines.
+    const std::string neighbors_prefix = "neighbors_";
+    std::vector<std::string> suffixes;
+    for (auto &p : std::filesystem::directory_iterator(path))
+    {
+        auto stem = p.path().stem().string();
+        if (p.path().extension() == ".index" && stem.size() > neighbors_prefix.size() &&
+            stem.starts_with(neighbors_prefix))
+        {
+            suffixes.push_back(stem.substr(neighbors_prefix.size()));
+        }
+    }
+    std::sort(std::begin(suffixes), std::end(suffixes));
+    if (suffixes.empty())
+    {
+        RAW_LOG_FATAL("No partitions found in %s", path.string().c_str());
+    }
+
+    snark::quantize_node_features(path, suffixes, quantization);
+    metadata.m_node_feature_quantization = std::move(quantization);
+    metadata.Write(path);
+    RAW_LOG_INFO("Quantized node features of %zu partitions", suffixes.size());
+
+    return 0;
+}
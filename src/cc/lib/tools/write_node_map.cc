@@ -0,0 +1,78 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// Write node map index for local graph partitions, so graph engines can map it instead of
+// building a node map on every start:
+//   write_node_map <graph_path> [partition ...]
+// Index is used only by graphs loading exactly the same partitions in the same order, all
+// partitions from metadata are used if none are provided.
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/cc/lib/graph/metadata.h"
+#include "src/cc/lib/graph/node_map.h"
+
+#include <glog/logging.h>
+#include <glog/raw_logging.h>
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <graph_path> [partition ...]\n", argv[0]);
+        return 1;
+    }
+
+    const std::filesystem::path path = argv[1];
+    std::vector<uint32_t> partitions;
+    for (int i = 2; i < argc; ++i)
+    {
+        partitions.push_back(uint32_t(std::stoul(argv[i])));
+    }
+    if (partitions.empty())
+    {
+        snark::Metadata metadata(path);
+        for (uint32_t partition = 0; partition < metadata.m_partition_count; ++partition)
+        {
+            partitions.push_back(partition);
+        }
+    }
+
+    // Same order of partition files as in graph engines: by partition, then by suffix.
+    const std::string neighbors_prefix = "neighbors_";
+    std::vector<std::pair<std::filesystem::path, std::string>> partition_files;
+    for (auto partition : partitions)
+    {
+        std::vector<std::string> suffixes;
+        for (auto &p : std::filesystem::directory_iterator(path))
+        {
+            auto stem = p.path().stem().string();
+            if (stem.size() > neighbors_prefix.size() && stem.starts_with(neighbors_prefix) &&
+                int(partition) == std::stoi(stem.substr(neighbors_prefix.size())))
+            {
+                suffixes.push_back(stem.substr(neighbors_prefix.size()));
+            }
+        }
+        std::sort(std::begin(suffixes), std::end(suffixes));
+        for (auto &suffix : suffixes)
+        {
+            partition_files.emplace_back(path, std::move(suffix));
+        }
+    }
+
+    if (partition_files.empty())
+    {
+        RAW_LOG_FATAL("No partitions found in %s", path.string().c_str());
+    }
+
+    // Build map from partition files even if there is an index already.
+    std::filesystem::remove(path / "node_map.index");
+    snark::NodeMap(partition_files, "").Write(partition_files, path);
+    RAW_LOG_INFO("Wrote node map index for %zu partitions", partition_files.size());
+    return 0;
+}
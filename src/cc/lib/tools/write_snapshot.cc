@@ -0,0 +1,62 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+// Write snapshots for local graph partitions, so graph engines can load them without
+// parsing node maps and edge indices:
+//   write_snapshot <graph_path> [suffix ...]
+// If no suffixes are provided, snapshots are written for every partition in the folder.
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "src/cc/lib/graph/metadata.h"
+#include "src/cc/lib/graph/partition.h"
+
+#include <glog/logging.h>
+#include <glog/raw_logging.h>
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <graph_path> [suffix ...]\n", argv[0]);
+        return 1;
+    }
+
+    const std::filesystem::path path = argv[1];
+    std::vector<std::string> suffixes(argv + 2, argv + argc);
+    if (suffixes.empty())
+    {
+        // Every partition has a neighbors index, same as in graph engines.
+        const std::string neighbors_prefix = "neighbors_";
+        for (auto &p : std::filesystem::directory_iterator(path))
+        {
+            auto stem = p.path().stem().string();
+            if (p.path().extension() == ".index" && stem.size() > neighbors_prefix.size() &&
+                stem.starts_with(neighbors_prefix))
+            {
+                suffixes.push_back(stem.substr(neighbors_prefix.size()));
+            }
+        }
+        std::sort(std::begin(suffixes), std::end(suffixes));
+    }
+
+    if (suffixes.empty())
+    {
+        RAW_LOG_FATAL("No partitions found in %s", path.string().c_str());
+    }
+
+    snark::Metadata metadata(path);
+    for (const auto &suffix : suffixes)
+    {
+        // Features are not part of snapshots, disk storage avoids reading them.
+        snark::Partition partition(metadata, path, suffix, snark::PartitionStorageType::disk);
+        partition.WriteSnapshot(path, suffix);
+        RAW_LOG_INFO("Wrote snapshot for partition %s", suffix.c_str());
+    }
+
+    return 0;
+}
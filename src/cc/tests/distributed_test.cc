@@ -565,6 +565,206 @@ TEST(DistributedTest, UniformSampleNeighborsWithoutReplacementSingleServer)
     EXPECT_EQ(output_nodes, std::vector<snark::NodeId>({1, 3, 2, 4, 6, 3}));
 }
 
+TEST(DistributedTest, NumaWorkersMatchSingleThreadedReplies)
+{
+    // Partitions are spread between two NUMA nodes round robin, nodes divisible by 4 and 5 are in several
+    // partitions, so sampling uses seeds of partitions handled by different nodes.
+    TempFolder path("NumaWorkersMatchSingleThreadedReplies");
+    const size_t partition_count = 4;
+
+    // Sparse feature with a single 3 dimensional index {value, 13, 42} and value stored as floats.
+    auto sparse_feature = [](int32_t value) {
+        std::vector<int32_t> data = {3, 3, value, 0, 13, 0, 42, 0, value};
+        auto start = reinterpret_cast<float *>(data.data());
+        return std::vector<float>(start, start + data.size());
+    };
+    for (size_t partition = 0; partition < partition_count; ++partition)
+    {
+        TestGraph::MemoryGraph m;
+        for (size_t node = 0; node < num_nodes; ++node)
+        {
+            if (node % 4 != partition && node % 5 != partition)
+            {
+                continue;
+            }
+            std::vector<TestGraph::NeighborRecord> neighbors;
+            std::vector<std::vector<std::vector<float>>> edge_features;
+            for (size_t k = 1; k <= 2 + node % 7; ++k)
+            {
+                neighbors.emplace_back(snark::NodeId((node + k * (partition + 1)) % num_nodes), 0, float(k));
+                edge_features.push_back({std::vector<float>{float(k)}, sparse_feature(int32_t(k))});
+            }
+            m.m_nodes.push_back(TestGraph::Node{
+                .m_id = snark::NodeId(node),
+                .m_type = int32_t(node % 2),
+                .m_weight = 1.0f,
+                .m_float_features = {std::vector<float>{float(node), 0.5f}, sparse_feature(int32_t(node))},
+                .m_neighbors = std::move(neighbors),
+                .m_edge_features = std::move(edge_features)});
+        }
+        TestGraph::convert(path.path, std::to_string(partition) + "_0", std::move(m), 2);
+    }
+
+    std::vector<snark::NodeId> input_nodes(num_nodes + 1);
+    std::iota(std::begin(input_nodes), std::end(input_nodes), 0);
+    std::shuffle(std::begin(input_nodes), std::end(input_nodes), snark::Xoroshiro128PlusGenerator(5));
+    std::vector<snark::Type> input_types = {0};
+    std::vector<snark::FeatureMeta> features = {{0, fv_size * sizeof(float)}};
+    const size_t nb_count = 5;
+
+    // First edge of the partition storing every node, the missing node has no edges.
+    std::vector<snark::NodeId> edge_dst;
+    for (auto node : input_nodes)
+    {
+        edge_dst.emplace_back((node + node % 4 + 1) % num_nodes);
+    }
+    std::vector<snark::Type> edge_types(input_nodes.size(), 0);
+    std::vector<snark::FeatureMeta> edge_features = {{0, sizeof(float)}};
+    std::vector<snark::FeatureId> string_features = {0};
+    std::vector<snark::FeatureId> sparse_features = {1};
+    struct Replies
+    {
+        std::vector<snark::Type> m_types;
+        std::vector<float> m_features;
+        std::vector<float> m_edge_features;
+        std::vector<int64_t> m_string_dimensions;
+        std::vector<uint8_t> m_string_values;
+        std::vector<int64_t> m_sparse_dimensions;
+        std::vector<std::vector<int64_t>> m_sparse_indices;
+        std::vector<std::vector<uint8_t>> m_sparse_values;
+        std::vector<int64_t> m_edge_string_dimensions;
+        std::vector<uint8_t> m_edge_string_values;
+        std::vector<int64_t> m_edge_sparse_dimensions;
+        std::vector<std::vector<int64_t>> m_edge_sparse_indices;
+        std::vector<std::vector<uint8_t>> m_edge_sparse_values;
+        std::vector<uint64_t> m_neighbor_counts;
+        std::vector<snark::NodeId> m_neighbor_nodes;
+        std::vector<snark::Type> m_neighbor_types;
+        std::vector<float> m_neighbor_weights;
+        std::vector<uint64_t> m_full_neighbor_counts;
+        std::vector<snark::NodeId> m_weighted_nodes;
+        std::vector<snark::Type> m_weighted_types;
+        std::vector<float> m_weighted_weights;
+        std::vector<snark::NodeId> m_uniform_nodes;
+        std::vector<snark::Type> m_uniform_types;
+    };
+    std::vector<Replies> replies;
+    for (bool numa : {false, true})
+    {
+        // Disk storage with a feature cache reads misses in workers of NUMA nodes.
+        const snark::GraphOptions options{.m_feature_cache_size = 1 << 20, .m_numa = numa, .m_numa_node_count = 2};
+        auto service = std::make_shared<snark::GraphEngineServiceImpl>(
+            snark::Metadata(path.string()), std::vector<std::string>(partition_count, path.string()),
+            std::vector<uint32_t>{0, 1, 2, 3}, snark::PartitionStorageType::disk, options);
+        EXPECT_EQ(size_t(numa ? 2 : 1), service->NumaNodeCount());
+        const auto numa_nodes = service->NumaNodeCount();
+        snark::GRPCServer server(std::move(service), std::shared_ptr<snark::GraphSamplerServiceImpl>{},
+                                 "localhost:0", "", "", "", numa_nodes);
+        snark::GRPCClient client(std::vector<std::shared_ptr<grpc::Channel>>{server.InProcessChannel()}, 1, 1);
+
+        Replies reply;
+        for (size_t i = 0; i < 2; ++i)
+        {
+            // Cold and warm feature cache.
+            std::vector<float> output(fv_size * input_nodes.size(), -1.0f);
+            client.GetNodeFeature(std::span(input_nodes), std::span(features),
+                                  std::span(reinterpret_cast<uint8_t *>(output.data()), output.size() * sizeof(float)));
+            EXPECT_TRUE(reply.m_features.empty() || reply.m_features == output);
+            reply.m_features = std::move(output);
+        }
+
+        reply.m_types.resize(input_nodes.size());
+        client.GetNodeType(std::span(input_nodes), std::span(reply.m_types), -1);
+
+        reply.m_edge_features.resize(input_nodes.size(), -1.0f);
+        client.GetEdgeFeature(std::span(input_nodes), std::span(edge_dst), std::span(edge_types),
+                              std::span(edge_features),
+                              std::span(reinterpret_cast<uint8_t *>(reply.m_edge_features.data()),
+                                        reply.m_edge_features.size() * sizeof(float)));
+
+        reply.m_string_dimensions.resize(input_nodes.size() * string_features.size());
+        client.GetNodeStringFeature(std::span(input_nodes), std::span(string_features),
+                                    std::span(reply.m_string_dimensions), reply.m_string_values);
+        reply.m_sparse_dimensions.resize(sparse_features.size());
+        reply.m_sparse_indices.resize(sparse_features.size());
+        reply.m_sparse_values.resize(sparse_features.size());
+        client.GetNodeSparseFeature(std::span(input_nodes), std::span(sparse_features),
+                                    std::span(reply.m_sparse_dimensions), reply.m_sparse_indices,
+                                    reply.m_sparse_values);
+
+        reply.m_edge_string_dimensions.resize(input_nodes.size() * string_features.size());
+        client.GetEdgeStringFeature(std::span(input_nodes), std::span(edge_dst), std::span(edge_types),
+                                    std::span(string_features), std::span(reply.m_edge_string_dimensions),
+                                    reply.m_edge_string_values);
+        reply.m_edge_sparse_dimensions.resize(sparse_features.size());
+        reply.m_edge_sparse_indices.resize(sparse_features.size());
+        reply.m_edge_sparse_values.resize(sparse_features.size());
+        client.GetEdgeSparseFeature(std::span(input_nodes), std::span(edge_dst), std::span(edge_types),
+                                    std::span(sparse_features), std::span(reply.m_edge_sparse_dimensions),
+                                    reply.m_edge_sparse_indices, reply.m_edge_sparse_values);
+
+        reply.m_neighbor_counts.resize(input_nodes.size());
+        client.NeighborCount(std::span(input_nodes), std::span(input_types), std::span(reply.m_neighbor_counts));
+        reply.m_full_neighbor_counts.resize(input_nodes.size());
+        client.FullNeighbor(std::span(input_nodes), std::span(input_types), reply.m_neighbor_nodes,
+                            reply.m_neighbor_types, reply.m_neighbor_weights, std::span(reply.m_full_neighbor_counts));
+
+        reply.m_weighted_nodes.resize(nb_count * input_nodes.size());
+        reply.m_weighted_types.resize(nb_count * input_nodes.size());
+        reply.m_weighted_weights.resize(nb_count * input_nodes.size());
+        client.WeightedSampleNeighbor(23, std::span(input_nodes), std::span(input_types), nb_count,
+                                      std::span(reply.m_weighted_nodes), std::span(reply.m_weighted_types),
+                                      std::span(reply.m_weighted_weights), -1, 0.0f, -1);
+
+        reply.m_uniform_nodes.resize(nb_count * input_nodes.size());
+        reply.m_uniform_types.resize(nb_count * input_nodes.size());
+        client.UniformSampleNeighbor(false, 29, std::span(input_nodes), std::span(input_types), nb_count,
+                                     std::span(reply.m_uniform_nodes), std::span(reply.m_uniform_types), -1, -1);
+        replies.emplace_back(std::move(reply));
+    }
+
+    // Node num_nodes is missing from every partition.
+    std::vector<float> expected_features;
+    for (auto node : input_nodes)
+    {
+        expected_features.emplace_back(node == snark::NodeId(num_nodes) ? 0.0f : float(node));
+        expected_features.emplace_back(node == snark::NodeId(num_nodes) ? 0.0f : 0.5f);
+    }
+    EXPECT_EQ(expected_features, replies[0].m_features);
+    for (size_t i = 0; i < input_nodes.size(); ++i)
+    {
+        // Nodes in several partitions may find the edge after the first neighbor of another partition.
+        if (input_nodes[i] != snark::NodeId(num_nodes))
+        {
+            EXPECT_LE(1.0f, replies[0].m_edge_features[i]);
+        }
+    }
+    EXPECT_EQ(replies[0].m_neighbor_counts, replies[0].m_full_neighbor_counts);
+
+    EXPECT_EQ(replies[0].m_types, replies[1].m_types);
+    EXPECT_EQ(replies[0].m_features, replies[1].m_features);
+    EXPECT_EQ(replies[0].m_edge_features, replies[1].m_edge_features);
+    EXPECT_EQ(replies[0].m_string_dimensions, replies[1].m_string_dimensions);
+    EXPECT_EQ(replies[0].m_string_values, replies[1].m_string_values);
+    EXPECT_EQ(replies[0].m_sparse_dimensions, replies[1].m_sparse_dimensions);
+    EXPECT_EQ(replies[0].m_sparse_indices, replies[1].m_sparse_indices);
+    EXPECT_EQ(replies[0].m_sparse_values, replies[1].m_sparse_values);
+    EXPECT_EQ(replies[0].m_edge_string_dimensions, replies[1].m_edge_string_dimensions);
+    EXPECT_EQ(replies[0].m_edge_string_values, replies[1].m_edge_string_values);
+    EXPECT_EQ(replies[0].m_edge_sparse_dimensions, replies[1].m_edge_sparse_dimensions);
+    EXPECT_EQ(replies[0].m_edge_sparse_indices, replies[1].m_edge_sparse_indices);
+    EXPECT_EQ(replies[0].m_edge_sparse_values, replies[1].m_edge_sparse_values);
+    EXPECT_EQ(replies[0].m_neighbor_counts, replies[1].m_neighbor_counts);
+    EXPECT_EQ(replies[0].m_neighbor_nodes, replies[1].m_neighbor_nodes);
+    EXPECT_EQ(replies[0].m_neighbor_types, replies[1].m_neighbor_types);
+    EXPECT_EQ(replies[0].m_neighbor_weights, replies[1].m_neighbor_weights);
+    EXPECT_EQ(replies[0].m_weighted_nodes, replies[1].m_weighted_nodes);
+    EXPECT_EQ(replies[0].m_weighted_types, replies[1].m_weighted_types);
+    EXPECT_EQ(replies[0].m_weighted_weights, replies[1].m_weighted_weights);
+    EXPECT_EQ(replies[0].m_uniform_nodes, replies[1].m_uniform_nodes);
+    EXPECT_EQ(replies[0].m_uniform_types, replies[1].m_uniform_types);
+}
+
 using ServerList = std::vector<std::shared_ptr<snark::GRPCServer>>;
 std::pair<ServerList, std::shared_ptr<snark::GRPCClient>> CreateMultiServerEnvironment(std::string name)
 {
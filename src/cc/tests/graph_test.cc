@@ -1,8 +1,17 @@
 // Copyright (c) Microsoft Corporation.
 // Licensed under the MIT License.
 
+#include "src/cc/lib/graph/async_reader.h"
+#include "src/cc/lib/graph/compressed_neighbors.h"
+#include "src/cc/lib/graph/compressed_storage.h"
+#include "src/cc/lib/graph/feature_cache.h"
 #include "src/cc/lib/graph/graph.h"
+#include "src/cc/lib/graph/huge_pages.h"
+#include "src/cc/lib/graph/node_map.h"
+#include "src/cc/lib/graph/numa.h"
+#include "src/cc/lib/graph/parallel.h"
 #include "src/cc/lib/graph/partition.h"
+#include "src/cc/lib/graph/quantization.h"
 #include "src/cc/lib/graph/sampler.h"
 #include "src/cc/lib/graph/xoroshiro.h"
 #include "src/cc/tests/mocks.h"
@@ -11,11 +20,17 @@
 #include <array>
 #include <cassert>
 #include <cstdio>
+#include <cstring>
 #include <filesystem>
+#include <limits>
+#include <numeric>
 #include <span>
+#include <stdexcept>
+#include <thread>
 #include <vector>
 
 #include "boost/random/uniform_int_distribution.hpp"
+#include "boost/random/uniform_real_distribution.hpp"
 #include "gtest/gtest.h"
 
 using WeightedNodePartitionList = std::vector<snark::WeightedNodeSamplerPartition>;
@@ -409,6 +424,61 @@ TEST_P(StorageTypeGraphTest, NodeFeaturesMultipleNodesMissingFeature)
     EXPECT_EQ(std::vector<float>(std::begin(large_res), std::end(large_res)), std::vector<float>(3, 0.0f));
 }
 
+TEST_P(StorageTypeGraphTest, NodeFeaturesQuantized)
+{
+    auto path = std::filesystem::temp_directory_path() / "quantized_features_test";
+    std::filesystem::remove_all(path);
+    std::filesystem::create_directories(path);
+
+    // Features are float16, bfloat16, int8 and float32. Small integers are exact in 16 bit floats.
+    TestGraph::MemoryGraph m;
+    for (snark::NodeId node = 0; node < 3; ++node)
+    {
+        const float base = float(10 * node);
+        std::vector<std::vector<float>> features = {
+            {base, base + 1, base + 2}, {-base, -base - 1}, {base / 20, 1.0f - base / 20}, {base + 0.1f}};
+        m.m_nodes.push_back(TestGraph::Node{.m_id = node, .m_type = 0, .m_weight = 1.0f, .m_float_features = features});
+    }
+    TestGraph::convert(path, "0_0", std::move(m), 1);
+
+    snark::Metadata metadata(path.string());
+    std::vector<snark::FeatureQuantization> quantization(4);
+    quantization[0].m_encoding = snark::FeatureEncoding::float16;
+    quantization[1].m_encoding = snark::FeatureEncoding::bfloat16;
+    quantization[2].m_encoding = snark::FeatureEncoding::int8;
+    const std::vector<std::string> suffixes = {"0_0"};
+    // Compressed copies hold the original features and must not outlive them.
+    snark::write_compressed_data(path / "node_features_0_0.data", path / "node_features_0_0.zdata");
+    snark::quantize_node_features(path, suffixes, quantization);
+    EXPECT_FALSE(std::filesystem::exists(path / "node_features_0_0.zdata"));
+    EXPECT_FLOAT_EQ(1.0f / 255, quantization[2].m_scale);
+    metadata.m_node_feature_quantization = quantization;
+    metadata.Write(path);
+
+    snark::Graph g(snark::Metadata(path.string()), {path.string()}, std::vector<uint32_t>{0}, GetParam());
+    std::vector<snark::NodeId> nodes = {2, 5, 1};
+    // The float16 feature is requested with an extra value to check padding.
+    std::vector<snark::FeatureMeta> features = {{0, 16}, {1, 8}, {2, 8}, {3, 4}};
+    std::vector<uint8_t> output(36 * nodes.size());
+    g.GetNodeFeature(std::span(nodes), std::span(features), std::span(output));
+    std::vector<float> result(output.size() / 4);
+    memcpy(result.data(), output.data(), output.size());
+
+    const std::vector<float> expected_head = {20, 21, 22, 0, -20, -21};
+    EXPECT_EQ(expected_head, std::vector<float>(std::begin(result), std::begin(result) + 6));
+    EXPECT_NEAR(1.0f, result[6], quantization[2].m_scale / 2);
+    EXPECT_NEAR(0.0f, result[7], quantization[2].m_scale / 2);
+    EXPECT_EQ(20.1f, result[8]);
+    EXPECT_EQ(std::vector<float>(9, 0.0f), std::vector<float>(std::begin(result) + 9, std::begin(result) + 18));
+    const std::vector<float> expected_tail = {10, 11, 12, 0, -10, -11};
+    EXPECT_EQ(expected_tail, std::vector<float>(std::begin(result) + 18, std::begin(result) + 24));
+    EXPECT_NEAR(0.5f, result[24], quantization[2].m_scale / 2);
+    EXPECT_NEAR(0.5f, result[25], quantization[2].m_scale / 2);
+    EXPECT_EQ(10.1f, result[26]);
+
+    std::filesystem::remove_all(path);
+}
+
 TEST_P(StorageTypeGraphTest, NodeFeaturesMultipleNodesSingleFeatureMixedSizes)
 {
     TestGraph::MemoryGraph m;
@@ -509,6 +579,36 @@ TEST_P(StorageTypeGraphTest, NodeSparseFeaturesMixedDimensions)
     EXPECT_EQ(std::vector<int32_t>({1, 6}), std::vector<int32_t>(tmp, tmp + 2));
 }
 
+TEST_P(StorageTypeGraphTest, NodeSparseFeaturesManyIndices)
+{
+    TestGraph::MemoryGraph m;
+    // indices - 1, 2, 3, 4, 5, data - 7
+    std::vector<int32_t> f1_data = {5, 1, 1, 0, 2, 0, 3, 0, 4, 0, 5, 0, 7};
+    // indices - 10, 11, 12, 13, data - 8
+    std::vector<int32_t> f2_data = {4, 1, 10, 0, 11, 0, 12, 0, 13, 0, 8};
+    auto start = reinterpret_cast<float *>(f1_data.data());
+    std::vector<std::vector<float>> f1 = {std::vector<float>(start, start + f1_data.size())};
+    start = reinterpret_cast<float *>(f2_data.data());
+    std::vector<std::vector<float>> f2 = {std::vector<float>(start, start + f2_data.size())};
+    m.m_nodes.push_back(TestGraph::Node{.m_id = 0, .m_type = 0, .m_weight = 1.0f, .m_float_features = f1});
+    m.m_nodes.push_back(TestGraph::Node{.m_id = 1, .m_type = 1, .m_weight = 1.0f, .m_float_features = f2});
+    auto path = std::filesystem::temp_directory_path();
+    TestGraph::convert(path, "0_0", std::move(m), 2);
+    snark::Metadata metadata(path.string());
+    snark::Graph g(std::move(metadata), {path.string()}, std::vector<uint32_t>{0}, GetParam());
+    std::vector<snark::NodeId> nodes = {1, 0};
+    std::vector<snark::FeatureId> features = {0};
+
+    std::vector<std::vector<uint8_t>> data(features.size());
+    std::vector<std::vector<int64_t>> indices(features.size());
+    std::vector<int64_t> dimensions = {-1};
+    g.GetNodeSparseFeature(std::span(nodes), std::span(features), std::span(dimensions), indices, data);
+    EXPECT_EQ(std::vector<int64_t>({0, 10, 0, 11, 0, 12, 0, 13, 1, 1, 1, 2, 1, 3, 1, 4, 1, 5}), indices.front());
+    auto tmp = reinterpret_cast<int32_t *>(data.front().data());
+    EXPECT_EQ(std::vector<int32_t>({8, 7}), std::vector<int32_t>(tmp, tmp + 2));
+    EXPECT_EQ(std::vector<int64_t>({1}), dimensions);
+}
+
 TEST_P(StorageTypeGraphTest, NodeSparseFeaturesMissingFeature)
 {
     TestGraph::MemoryGraph m;
@@ -928,6 +1028,1130 @@ TEST(GraphTest, NodeTypesMultipleTypesNeighborsSpreadAcrossPartitions)
     EXPECT_EQ(std::vector<snark::Type>({0, 1, 2}), types);
 }
 
+TEST(GraphTest, QuantizationRoundTrip)
+{
+    // Lengths cover full vectors of SIMD paths and scalar tails.
+    for (size_t count = 0; count < 40; ++count)
+    {
+        std::vector<float> input(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            input[i] = float(int(i) - 20) / 4;
+        }
+
+        for (auto encoding :
+             {snark::FeatureEncoding::float16, snark::FeatureEncoding::bfloat16, snark::FeatureEncoding::int8})
+        {
+            auto quantization = encoding == snark::FeatureEncoding::int8 ? snark::int8_quantization(-5.0f, 5.0f)
+                                                                          : snark::FeatureQuantization{encoding};
+            std::vector<uint8_t> encoded(count * snark::encoded_value_size(encoding));
+            snark::quantize(quantization, input, encoded);
+            std::vector<float> decoded(count);
+            snark::dequantize(quantization, encoded.data(), count, reinterpret_cast<uint8_t *>(decoded.data()));
+            for (size_t i = 0; i < count; ++i)
+            {
+                // Quarters are exact in 16 bit floats.
+                EXPECT_NEAR(input[i], decoded[i], encoding == snark::FeatureEncoding::int8 ? quantization.m_scale / 2
+                                                                                           : 0.0f);
+            }
+        }
+    }
+}
+
+TEST(GraphTest, NodeMapLocationsOrderedByPartition)
+{
+    // Node 5 is present in every partition, node ids are shuffled to spread them between shards.
+    auto path = std::filesystem::temp_directory_path();
+    std::vector<std::pair<std::filesystem::path, std::string>> partition_files;
+    for (int partition = 0; partition < 3; ++partition)
+    {
+        TestGraph::MemoryGraph m;
+        for (snark::NodeId node : {snark::NodeId(1000 * partition + 17), snark::NodeId(5),
+                                   snark::NodeId(1000 * partition + 3)})
+        {
+            m.m_nodes.push_back(TestGraph::Node{.m_id = node, .m_type = 0, .m_weight = 1.0f});
+        }
+        auto suffix = std::to_string(partition) + "_0";
+        TestGraph::convert(path, suffix, std::move(m), 1);
+        partition_files.emplace_back(path, suffix);
+    }
+
+    snark::NodeMap node_map(partition_files, "");
+    auto index = node_map.Find(5);
+    ASSERT_NE(snark::NodeMap::npos, index);
+    EXPECT_EQ(3, node_map.Count(index));
+    for (uint32_t partition = 0; partition < 3; ++partition)
+    {
+        EXPECT_EQ(partition, node_map.PartitionIndex(index + partition));
+        EXPECT_EQ(1, node_map.InternalId(index + partition));
+    }
+
+    index = node_map.Find(2003);
+    ASSERT_NE(snark::NodeMap::npos, index);
+    EXPECT_EQ(1, node_map.Count(index));
+    EXPECT_EQ(2, node_map.PartitionIndex(index));
+    EXPECT_EQ(2, node_map.InternalId(index));
+    EXPECT_EQ(snark::NodeMap::npos, node_map.Find(4));
+}
+
+TEST(GraphTest, NodeMapIndexMatchesBuiltMap)
+{
+    // Skewed ids of both signs exercise interpolation search fallbacks.
+    auto path = std::filesystem::temp_directory_path() / "node_map_index_test";
+    std::filesystem::remove_all(path);
+    std::filesystem::create_directories(path);
+    std::vector<std::pair<std::filesystem::path, std::string>> partition_files;
+    std::vector<snark::NodeId> nodes;
+    for (int partition = 0; partition < 2; ++partition)
+    {
+        TestGraph::MemoryGraph m;
+        for (snark::NodeId node = 0; node < 1000; ++node)
+        {
+            const snark::NodeId id = node * node * node * (partition == 0 ? 1 : -1) + 7 * partition;
+            m.m_nodes.push_back(TestGraph::Node{.m_id = id, .m_type = 0, .m_weight = 1.0f});
+            nodes.push_back(id);
+        }
+        m.m_nodes.push_back(TestGraph::Node{.m_id = std::numeric_limits<snark::NodeId>::max() - partition});
+        nodes.push_back(std::numeric_limits<snark::NodeId>::max() - partition);
+        if (partition == 0)
+        {
+            m.m_nodes.push_back(TestGraph::Node{.m_id = 7});
+        }
+        auto suffix = std::to_string(partition) + "_0";
+        TestGraph::convert(path, suffix, std::move(m), 1);
+        partition_files.emplace_back(path, suffix);
+    }
+    nodes.push_back(-5);
+    nodes.push_back(std::numeric_limits<snark::NodeId>::min());
+
+    snark::NodeMap built(partition_files, "");
+    std::vector<uint64_t> expected(nodes.size());
+    built.Find(nodes, expected);
+    EXPECT_EQ(snark::NodeMap::npos, expected[expected.size() - 2]);
+    EXPECT_EQ(snark::NodeMap::npos, expected.back());
+
+    built.Write(partition_files, path);
+    ASSERT_TRUE(std::filesystem::exists(path / "node_map.index"));
+    snark::NodeMap mapped(partition_files, "");
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        // Batch lookups are pipelined in blocks, they must agree with single lookups.
+        ASSERT_EQ(expected[i], built.Find(nodes[i]));
+        const auto index = mapped.Find(nodes[i]);
+        ASSERT_EQ(expected[i], index);
+        if (index == snark::NodeMap::npos)
+        {
+            continue;
+        }
+
+        // Node 7 is the first node of the second partition and the last one of the first partition.
+        EXPECT_EQ(nodes[i] == 7 ? 2 : 1, mapped.Count(index));
+        EXPECT_EQ(built.PartitionIndex(index), mapped.PartitionIndex(index));
+        EXPECT_EQ(built.InternalId(index), mapped.InternalId(index));
+    }
+
+    // Index is ignored for a different list of partitions.
+    snark::NodeMap single(std::vector<std::pair<std::filesystem::path, std::string>>{partition_files.back()}, "");
+    EXPECT_EQ(snark::NodeMap::npos, single.Find(8));
+    EXPECT_NE(snark::NodeMap::npos, single.Find(-8 + 7));
+
+    std::filesystem::remove_all(path);
+}
+
+TEST(GraphTest, NodeMapIndexRejectedForRewrittenPartition)
+{
+    auto path = std::filesystem::temp_directory_path() / "node_map_index_rewrite_test";
+    std::filesystem::remove_all(path);
+    std::filesystem::create_directories(path);
+    std::vector<std::pair<std::filesystem::path, std::string>> partition_files;
+    auto convert = [&path](std::string suffix, snark::NodeId first) {
+        TestGraph::MemoryGraph m;
+        for (snark::NodeId node = first; node < first + 100; ++node)
+        {
+            m.m_nodes.push_back(TestGraph::Node{.m_id = node, .m_type = 0, .m_weight = 1.0f});
+        }
+        TestGraph::convert(path, suffix, std::move(m), 1);
+    };
+    convert("0_0", 0);
+    convert("1_0", 1000);
+    partition_files.emplace_back(path, "0_0");
+    partition_files.emplace_back(path, "1_0");
+    snark::NodeMap(partition_files, "").Write(partition_files, path);
+    ASSERT_TRUE(std::filesystem::exists(path / "node_map.index"));
+
+    // Same node count keeps the size of the node map, the modification time is bumped explicitly for
+    // file systems with coarse timestamps.
+    const auto map_path = path / "node_1_0.map";
+    const auto time = std::filesystem::last_write_time(map_path);
+    const auto size = std::filesystem::file_size(map_path);
+    convert("1_0", 2000);
+    ASSERT_EQ(size, std::filesystem::file_size(map_path));
+    std::filesystem::last_write_time(map_path, time + std::chrono::seconds(1));
+
+    snark::NodeMap node_map(partition_files, "");
+    EXPECT_EQ(snark::NodeMap::npos, node_map.Find(1000));
+    const auto index = node_map.Find(2000);
+    ASSERT_NE(snark::NodeMap::npos, index);
+    EXPECT_EQ(1, node_map.PartitionIndex(index));
+    EXPECT_EQ(0, node_map.InternalId(index));
+
+    std::filesystem::remove_all(path);
+}
+
+TEST(GraphTest, NodeMapDenseIds)
+{
+    auto path = std::filesystem::temp_directory_path() / "node_map_dense_test";
+    std::filesystem::remove_all(path);
+    std::filesystem::create_directories(path);
+
+    // Ids 0..9 in order in a single partition are locations themselves.
+    TestGraph::MemoryGraph ordered;
+    for (snark::NodeId node = 0; node < 10; ++node)
+    {
+        ordered.m_nodes.push_back(TestGraph::Node{.m_id = node, .m_type = 0, .m_weight = 1.0f});
+    }
+    TestGraph::convert(path, "0_0", std::move(ordered), 1);
+    std::vector<std::pair<std::filesystem::path, std::string>> single = {{path, "0_0"}};
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        // The second pass maps an index written by the first one.
+        snark::NodeMap node_map(single, "");
+        for (snark::NodeId node = 0; node < 10; ++node)
+        {
+            auto index = node_map.Find(node);
+            ASSERT_EQ(uint64_t(node), index);
+            EXPECT_EQ(1, node_map.Count(index));
+            EXPECT_EQ(0, node_map.PartitionIndex(index));
+            EXPECT_EQ(uint64_t(node), node_map.InternalId(index));
+        }
+        EXPECT_EQ(snark::NodeMap::npos, node_map.Find(10));
+        EXPECT_EQ(snark::NodeMap::npos, node_map.Find(-1));
+        node_map.Write(single, path);
+    }
+    std::filesystem::remove(path / "node_map.index");
+
+    // Ids 0..9 shuffled between two partitions, node 4 is in both.
+    TestGraph::MemoryGraph first;
+    TestGraph::MemoryGraph second;
+    for (snark::NodeId node : {9, 4, 0, 2, 6})
+    {
+        first.m_nodes.push_back(TestGraph::Node{.m_id = node, .m_type = 0, .m_weight = 1.0f});
+    }
+    for (snark::NodeId node : {1, 3, 4, 5, 7, 8})
+    {
+        second.m_nodes.push_back(TestGraph::Node{.m_id = node, .m_type = 0, .m_weight = 1.0f});
+    }
+    TestGraph::convert(path, "0_0", std::move(first), 1);
+    TestGraph::convert(path, "1_0", std::move(second), 1);
+    std::vector<std::pair<std::filesystem::path, std::string>> both = {{path, "0_0"}, {path, "1_0"}};
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        snark::NodeMap node_map(both, "");
+        auto index = node_map.Find(4);
+        ASSERT_NE(snark::NodeMap::npos, index);
+        EXPECT_EQ(2, node_map.Count(index));
+        EXPECT_EQ(0, node_map.PartitionIndex(index));
+        EXPECT_EQ(1, node_map.InternalId(index));
+        EXPECT_EQ(1, node_map.PartitionIndex(index + 1));
+        EXPECT_EQ(2, node_map.InternalId(index + 1));
+
+        index = node_map.Find(8);
+        ASSERT_NE(snark::NodeMap::npos, index);
+        EXPECT_EQ(1, node_map.Count(index));
+        EXPECT_EQ(1, node_map.PartitionIndex(index));
+        EXPECT_EQ(5, node_map.InternalId(index));
+        EXPECT_EQ(snark::NodeMap::npos, node_map.Find(10));
+        EXPECT_EQ(snark::NodeMap::npos, node_map.Find(-3));
+        node_map.Write(both, path);
+    }
+
+    std::filesystem::remove_all(path);
+}
+
+TEST(GraphTest, PartitionSnapshotMatchesPartitionFiles)
+{
+    TestGraph::MemoryGraph m;
+    m.m_nodes.push_back(TestGraph::Node{
+        .m_id = 7,
+        .m_type = 0,
+        .m_weight = 1.0f,
+        .m_float_features = {std::vector<float>{1.0f, 2.0f}},
+        .m_neighbors{std::vector<TestGraph::NeighborRecord>{{3, 0, 1.0f}, {5, 1, 2.0f}, {9, 1, 0.5f}}},
+        .m_edge_features = {{std::vector<float>{1.5f}}, {std::vector<float>{2.5f}}, {std::vector<float>{3.5f}}}});
+    m.m_nodes.push_back(TestGraph::Node{.m_id = 3,
+                                        .m_type = 1,
+                                        .m_weight = 1.0f,
+                                        .m_float_features = {std::vector<float>{3.0f, 4.0f}},
+                                        .m_neighbors{std::vector<TestGraph::NeighborRecord>{{7, 0, 3.0f}}},
+                                        .m_edge_features = {{std::vector<float>{4.5f}}}});
+    auto path = std::filesystem::temp_directory_path() / "partition_snapshot_test";
+    std::filesystem::remove_all(path);
+    std::filesystem::create_directories(path);
+    auto partition = TestGraph::convert(path, "0_0", std::move(m), 2);
+    partition.WriteSnapshot(path, "0_0");
+
+    // Snapshot is used instead of the node map and edge index, so overwriting them must not change results.
+    // Modification times are restored, otherwise the snapshot is rejected as stale.
+    for (auto name : {"node_0_0.map", "edge_0_0.index"})
+    {
+        const auto size = std::filesystem::file_size(path / name);
+        const auto time = std::filesystem::last_write_time(path / name);
+        std::filesystem::resize_file(path / name, 0);
+        std::filesystem::resize_file(path / name, size);
+        std::filesystem::last_write_time(path / name, time);
+    }
+
+    snark::Metadata metadata(path.string());
+    snark::Graph g(std::move(metadata), {path.string()}, {0}, snark::PartitionStorageType::memory);
+    std::vector<snark::NodeId> nodes = {7, 3, 4};
+    std::vector<snark::Type> types = {0, 1};
+    std::vector<snark::NodeId> neighbor_nodes;
+    std::vector<snark::Type> neighbor_types;
+    std::vector<float> neighbor_weights;
+    std::vector<uint64_t> neighbor_counts(nodes.size());
+    g.FullNeighbor(std::span(nodes), std::span(types), neighbor_nodes, neighbor_types, neighbor_weights,
+                   std::span(neighbor_counts));
+    EXPECT_EQ(std::vector<snark::NodeId>({3, 5, 9, 7}), neighbor_nodes);
+    EXPECT_EQ(std::vector<snark::Type>({0, 1, 1, 0}), neighbor_types);
+    EXPECT_EQ(std::vector<float>({1.0f, 2.0f, 0.5f, 3.0f}), neighbor_weights);
+    EXPECT_EQ(std::vector<uint64_t>({3, 1, 0}), neighbor_counts);
+
+    std::vector<snark::FeatureMeta> features = {{0, 2 * sizeof(float)}};
+    std::vector<float> node_features(nodes.size() * 2, -1.0f);
+    auto node_features_bytes =
+        std::span(reinterpret_cast<uint8_t *>(node_features.data()), node_features.size() * sizeof(float));
+    g.GetNodeFeature(std::span(nodes), std::span(features), node_features_bytes);
+    EXPECT_EQ(std::vector<float>({1.0f, 2.0f, 3.0f, 4.0f, 0.0f, 0.0f}), node_features);
+
+    std::vector<snark::NodeId> src = {7};
+    std::vector<snark::NodeId> dst = {3};
+    std::vector<snark::Type> edge_types = {0};
+    std::vector<snark::FeatureMeta> edge_features_meta = {{0, sizeof(float)}};
+    float edge_feature = -1.0f;
+    g.GetEdgeFeature(std::span(src), std::span(dst), std::span(edge_types), std::span(edge_features_meta),
+                     std::span(reinterpret_cast<uint8_t *>(&edge_feature), sizeof(float)));
+    EXPECT_EQ(1.5f, edge_feature);
+
+    std::filesystem::remove_all(path);
+}
+
+TEST(GraphTest, PartitionSnapshotRejectedForRewrittenEdges)
+{
+    auto convert = [](std::filesystem::path path, float weight) {
+        TestGraph::MemoryGraph m;
+        m.m_nodes.push_back(
+            TestGraph::Node{.m_id = 7,
+                            .m_type = 0,
+                            .m_weight = 1.0f,
+                            .m_neighbors{std::vector<TestGraph::NeighborRecord>{{3, 0, weight}, {5, 0, 2.0f}}}});
+        m.m_nodes.push_back(TestGraph::Node{.m_id = 3, .m_type = 0, .m_weight = 1.0f});
+        return TestGraph::convert(path, "0_0", std::move(m), 1);
+    };
+    auto path = std::filesystem::temp_directory_path() / "partition_snapshot_rewrite_test";
+    std::filesystem::remove_all(path);
+    std::filesystem::create_directories(path);
+    convert(path, 1.0f).WriteSnapshot(path, "0_0");
+
+    // Different weights keep the size of the edge index, the modification time is bumped explicitly for
+    // file systems with coarse timestamps.
+    const auto edge_path = path / "edge_0_0.index";
+    const auto size = std::filesystem::file_size(edge_path);
+    const auto time = std::filesystem::last_write_time(edge_path);
+    convert(path, 4.0f);
+    ASSERT_EQ(size, std::filesystem::file_size(edge_path));
+    std::filesystem::last_write_time(edge_path, time + std::chrono::seconds(1));
+
+    snark::Metadata metadata(path.string());
+    snark::Graph g(std::move(metadata), {path.string()}, {0}, snark::PartitionStorageType::memory);
+    std::vector<snark::NodeId> nodes = {7};
+    std::vector<snark::Type> types = {0};
+    std::vector<snark::NodeId> neighbor_nodes;
+    std::vector<snark::Type> neighbor_types;
+    std::vector<float> neighbor_weights;
+    std::vector<uint64_t> neighbor_counts(nodes.size());
+    g.FullNeighbor(std::span(nodes), std::span(types), neighbor_nodes, neighbor_types, neighbor_weights,
+                   std::span(neighbor_counts));
+    EXPECT_EQ(std::vector<snark::NodeId>({3, 5}), neighbor_nodes);
+    EXPECT_EQ(std::vector<float>({4.0f, 2.0f}), neighbor_weights);
+
+    std::filesystem::remove_all(path);
+}
+
+TEST(GraphTest, CompressedFeatureDataMatchesRawData)
+{
+    TestGraph::MemoryGraph m;
+    for (snark::NodeId node = 0; node < 50; ++node)
+    {
+        // Repeated values compress, node ids make blocks different.
+        const float value = float(node % 7);
+        m.m_nodes.push_back(TestGraph::Node{
+            .m_id = node,
+            .m_type = 0,
+            .m_weight = 1.0f,
+            .m_float_features = {std::vector<float>{value, value, value, float(node)}},
+            .m_neighbors{std::vector<TestGraph::NeighborRecord>{{(node + 1) % 50, 0, 1.0f}}},
+            .m_edge_features = {{std::vector<float>{float(node) + 0.5f}}}});
+    }
+    auto path = std::filesystem::temp_directory_path() / "compressed_features_test";
+    std::filesystem::remove_all(path);
+    std::filesystem::create_directories(path);
+    TestGraph::convert(path, "0_0", std::move(m), 1);
+
+    // Small blocks split features between blocks. Raw data is removed to make sure it is not used.
+    for (auto name : {"node_features_0_0", "edge_features_0_0"})
+    {
+        snark::write_compressed_data(path / (std::string(name) + ".data"), path / (std::string(name) + ".zdata"), 24);
+        std::filesystem::remove(path / (std::string(name) + ".data"));
+    }
+
+    // Blocks are decompressed on every read when the block cache is disabled.
+    for (size_t block_cache_size : {snark::DEFAULT_BLOCK_CACHE_SIZE, size_t(0)})
+    {
+        snark::Graph g(snark::Metadata(path.string()), {path.string()}, {0}, snark::PartitionStorageType::disk,
+                       snark::GraphOptions{.m_block_cache_size = block_cache_size});
+        std::vector<snark::NodeId> nodes = {49, 3, 60, 17};
+        std::vector<snark::FeatureMeta> features = {{0, 4 * sizeof(float)}};
+        std::vector<float> node_features(nodes.size() * 4, -1.0f);
+        auto node_features_bytes =
+            std::span(reinterpret_cast<uint8_t *>(node_features.data()), node_features.size() * sizeof(float));
+        g.GetNodeFeature(std::span(nodes), std::span(features), node_features_bytes);
+        EXPECT_EQ(std::vector<float>({0, 0, 0, 49, 3, 3, 3, 3, 0, 0, 0, 0, 3, 3, 3, 17}), node_features);
+
+        std::vector<snark::NodeId> src = {0};
+        std::vector<snark::NodeId> dst = {1};
+        std::vector<snark::Type> edge_types = {0};
+        std::vector<snark::FeatureMeta> edge_features_meta = {{0, sizeof(float)}};
+        float edge_feature = -1.0f;
+        g.GetEdgeFeature(std::span(src), std::span(dst), std::span(edge_types), std::span(edge_features_meta),
+                         std::span(reinterpret_cast<uint8_t *>(&edge_feature), sizeof(float)));
+        EXPECT_EQ(0.5f, edge_feature);
+    }
+
+    std::filesystem::remove_all(path);
+}
+
+TEST(GraphTest, StaleCompressedFeatureDataIsIgnored)
+{
+    TestGraph::MemoryGraph m;
+    for (snark::NodeId node = 0; node < 4; ++node)
+    {
+        m.m_nodes.push_back(TestGraph::Node{
+            .m_id = node, .m_type = 0, .m_weight = 1.0f, .m_float_features = {std::vector<float>{float(node)}}});
+    }
+    auto path = std::filesystem::temp_directory_path() / "stale_compressed_features_test";
+    std::filesystem::remove_all(path);
+    std::filesystem::create_directories(path);
+    TestGraph::convert(path, "0_0", std::move(m), 1);
+    const auto data_path = path / "node_features_0_0.data";
+    snark::write_compressed_data(data_path, path / "node_features_0_0.zdata");
+    EXPECT_TRUE(snark::has_compressed_data(path, "node_features_0_0"));
+
+    // Rewrite data with the same size, only its modification time tells compressed data is stale.
+    std::vector<float> data(std::filesystem::file_size(data_path) / sizeof(float), 7.0f);
+    const auto time = std::filesystem::last_write_time(data_path);
+    FILE *file = fopen(data_path.string().c_str(), "wb");
+    ASSERT_EQ(data.size(), fwrite(data.data(), sizeof(float), data.size(), file));
+    fclose(file);
+    std::filesystem::last_write_time(data_path, time + std::chrono::seconds(1));
+    EXPECT_FALSE(snark::has_compressed_data(path, "node_features_0_0"));
+
+    snark::Graph g(snark::Metadata(path.string()), {path.string()}, {0}, snark::PartitionStorageType::disk);
+    std::vector<snark::NodeId> nodes = {1, 2};
+    std::vector<snark::FeatureMeta> features = {{0, sizeof(float)}};
+    std::vector<float> output(nodes.size(), -1.0f);
+    g.GetNodeFeature(std::span(nodes), std::span(features),
+                     std::span(reinterpret_cast<uint8_t *>(output.data()), output.size() * sizeof(float)));
+    EXPECT_EQ(std::vector<float>({7.0f, 7.0f}), output);
+
+    std::filesystem::remove_all(path);
+}
+
+TEST(GraphTest, FeatureCacheEvictsUnreferencedBlocks)
+{
+    // Keys 0, 16 and 32 share a shard, which fits two blocks of 4 bytes.
+    snark::FeatureCache cache(16 * 8);
+    auto block = [](uint8_t value) { return std::make_shared<const std::vector<uint8_t>>(4, value); };
+    cache.Put(0, block(0));
+    cache.Put(16, block(16));
+    ASSERT_NE(nullptr, cache.Get(0));
+    cache.Put(32, block(32));
+    EXPECT_EQ(nullptr, cache.Get(16));
+    EXPECT_EQ(std::vector<uint8_t>(4, 0), *cache.Get(0));
+    EXPECT_EQ(std::vector<uint8_t>(4, 32), *cache.Get(32));
+
+    const auto stats = cache.GetStats();
+    EXPECT_EQ(3, stats.m_hits);
+    EXPECT_EQ(1, stats.m_misses);
+}
+
+TEST(GraphTest, FeatureCacheServesRepeatedDiskReads)
+{
+    TestGraph::MemoryGraph m;
+    for (snark::NodeId node = 0; node < 10; ++node)
+    {
+        m.m_nodes.push_back(TestGraph::Node{
+            .m_id = node,
+            .m_type = 0,
+            .m_weight = 1.0f,
+            .m_float_features = {std::vector<float>{float(node), float(node) + 0.5f}},
+            .m_neighbors{std::vector<TestGraph::NeighborRecord>{{(node + 1) % 10, 0, 1.0f}}},
+            .m_edge_features = {{std::vector<float>{float(node) + 0.25f}}}});
+    }
+    auto path = std::filesystem::temp_directory_path() / "feature_cache_test";
+    std::filesystem::remove_all(path);
+    std::filesystem::create_directories(path);
+    TestGraph::convert(path, "0_0", std::move(m), 1);
+
+    snark::Graph g(snark::Metadata(path.string()), {path.string()}, {0}, snark::PartitionStorageType::disk,
+                   snark::GraphOptions{.m_feature_cache_size = 1 << 20});
+    std::vector<snark::NodeId> nodes = {7, 3, 60, 7};
+    std::vector<snark::FeatureMeta> features = {{0, 2 * sizeof(float)}};
+    for (size_t i = 0; i < 2; ++i)
+    {
+        std::vector<float> node_features(nodes.size() * 2, -1.0f);
+        g.GetNodeFeature(std::span(nodes), std::span(features),
+                         std::span(reinterpret_cast<uint8_t *>(node_features.data()),
+                                   node_features.size() * sizeof(float)));
+        EXPECT_EQ(std::vector<float>({7, 7.5, 3, 3.5, 0, 0, 7, 7.5}), node_features);
+    }
+
+    // Missing nodes don't use cache. Misses are cached after the batch is read, so both requests for node 7
+    // in the first batch miss and the second batch only hits.
+    auto stats = g.GetFeatureCacheStats();
+    EXPECT_EQ(3, stats.m_hits);
+    EXPECT_EQ(3, stats.m_misses);
+
+    std::vector<snark::NodeId> src = {0};
+    std::vector<snark::NodeId> dst = {1};
+    std::vector<snark::Type> edge_types = {0};
+    std::vector<snark::FeatureMeta> edge_features_meta = {{0, sizeof(float)}};
+    for (size_t i = 0; i < 2; ++i)
+    {
+        float edge_feature = -1.0f;
+        g.GetEdgeFeature(std::span(src), std::span(dst), std::span(edge_types), std::span(edge_features_meta),
+                         std::span(reinterpret_cast<uint8_t *>(&edge_feature), sizeof(float)));
+        EXPECT_EQ(0.25f, edge_feature);
+    }
+
+    stats = g.GetFeatureCacheStats();
+    EXPECT_EQ(4, stats.m_hits);
+    EXPECT_EQ(4, stats.m_misses);
+
+    std::filesystem::remove_all(path);
+}
+
+TEST(GraphTest, FeatureCacheMissesAreBatchedReads)
+{
+    TestGraph::MemoryGraph m;
+    for (snark::NodeId node = 0; node < 10; ++node)
+    {
+        m.m_nodes.push_back(TestGraph::Node{.m_id = node,
+                                            .m_type = 0,
+                                            .m_weight = 1.0f,
+                                            .m_float_features = {std::vector<float>{float(node), float(node) + 0.5f},
+                                                                 std::vector<float>{float(node) + 0.25f}}});
+    }
+    auto path = std::filesystem::temp_directory_path() / "feature_cache_batch_test";
+    std::filesystem::remove_all(path);
+    std::filesystem::create_directories(path);
+    TestGraph::convert(path, "0_0", std::move(m), 1);
+
+    snark::Partition partition(snark::Metadata(path.string()), path, "0_0", snark::PartitionStorageType::disk,
+                               snark::GraphOptions{.m_feature_cache_size = 1 << 20});
+    std::vector<snark::FeatureMeta> features = {{1, sizeof(float)}, {0, 2 * sizeof(float)}};
+    snark::AsyncReader reader;
+    for (size_t i = 0; i < 2; ++i)
+    {
+        std::vector<float> node_features(6, -1.0f);
+        auto output =
+            std::span(reinterpret_cast<uint8_t *>(node_features.data()), node_features.size() * sizeof(float));
+        std::vector<snark::ReadRequest> requests;
+        std::vector<snark::PendingNodeFeature> pending;
+        for (uint64_t node : {7, 3})
+        {
+            ASSERT_TRUE(partition.GetNodeFeature(node, std::span(features), output.subspan(node == 7 ? 0 : 12, 12),
+                                                 &requests, &pending));
+        }
+
+        // Misses read whole feature blobs with the batch, hits are copied from the cache right away.
+        EXPECT_EQ(i == 0 ? 2 : 0, requests.size());
+        EXPECT_EQ(i == 0 ? 2 : 0, pending.size());
+        reader.Read(requests);
+        for (const auto &node : pending)
+        {
+            node.m_partition->FinishNodeFeature(node);
+        }
+        EXPECT_EQ(std::vector<float>({7.25, 7, 7.5, 3.25, 3, 3.5}), node_features);
+    }
+
+    auto stats = partition.GetFeatureCacheStats();
+    EXPECT_EQ(2, stats.m_hits);
+    EXPECT_EQ(2, stats.m_misses);
+
+    std::filesystem::remove_all(path);
+}
+
+TEST(GraphTest, HybridStoragePinsFeaturesOfHighDegreeNodes)
+{
+    TestGraph::MemoryGraph m;
+    for (snark::NodeId node = 0; node < 10; ++node)
+    {
+        // Nodes 5 and 2 have the most neighbors.
+        std::vector<TestGraph::NeighborRecord> neighbors;
+        const snark::NodeId degree = node == 5 ? 6 : node == 2 ? 4 : 1;
+        for (snark::NodeId nb = 1; nb <= degree; ++nb)
+        {
+            neighbors.push_back({(node + nb) % 10, 0, 1.0f});
+        }
+        m.m_nodes.push_back(TestGraph::Node{.m_id = node,
+                                            .m_type = 0,
+                                            .m_weight = 1.0f,
+                                            .m_float_features = {std::vector<float>{float(node), float(node) + 0.5f}},
+                                            .m_neighbors{std::move(neighbors)}});
+    }
+    auto path = std::filesystem::temp_directory_path() / "hybrid_storage_test";
+    std::filesystem::remove_all(path);
+    std::filesystem::create_directories(path);
+    TestGraph::convert(path, "0_0", std::move(m), 1);
+
+    // Budget fits features of two nodes.
+    snark::Graph g(snark::Metadata(path.string()), {path.string()}, {0}, snark::PartitionStorageType::hybrid,
+                   snark::GraphOptions{.m_pinned_features_size = 4 * sizeof(float)});
+
+    // Zero out data on disk, only pinned features keep their values.
+    const auto data_path = path / "node_features_0_0.data";
+    const std::vector<char> zeros(std::filesystem::file_size(data_path));
+    FILE *data = fopen(data_path.string().c_str(), "r+b");
+    ASSERT_NE(nullptr, data);
+    EXPECT_EQ(zeros.size(), fwrite(zeros.data(), 1, zeros.size(), data));
+    fclose(data);
+
+    std::vector<snark::NodeId> nodes = {5, 3, 2, 60};
+    std::vector<snark::FeatureMeta> features = {{0, 2 * sizeof(float)}};
+    std::vector<float> node_features(nodes.size() * 2, -1.0f);
+    g.GetNodeFeature(
+        std::span(nodes), std::span(features),
+        std::span(reinterpret_cast<uint8_t *>(node_features.data()), node_features.size() * sizeof(float)));
+    EXPECT_EQ(std::vector<float>({5, 5.5, 0, 0, 2, 2.5, 0, 0}), node_features);
+
+    std::filesystem::remove_all(path);
+}
+
+TEST(GraphTest, ColumnarFeaturesMatchNodeMajorFeatures)
+{
+    // Feature 0 has the same size for every node and is stored in a column, feature 1 stays node-major.
+    TestGraph::MemoryGraph m;
+    for (snark::NodeId node = 0; node < 4; ++node)
+    {
+        m.m_nodes.push_back(TestGraph::Node{
+            .m_id = node,
+            .m_type = 0,
+            .m_weight = 1.0f,
+            .m_float_features = {std::vector<float>{float(node), float(node) + 0.5f}, std::vector<float>(node, 1.0f)}});
+    }
+    auto path = std::filesystem::temp_directory_path() / "columnar_features_test";
+    std::filesystem::remove_all(path);
+    std::filesystem::create_directories(path);
+    TestGraph::convert(path, "0_0", std::move(m), 1);
+    snark::Graph g(snark::Metadata(path.string()), {path.string()}, {0}, snark::PartitionStorageType::memory,
+                   snark::GraphOptions{.m_columnar_features = true});
+
+    // Gathered from the column only.
+    std::vector<snark::NodeId> nodes = {3, 60, 1};
+    std::vector<snark::FeatureMeta> features = {{0, 3 * sizeof(float)}};
+    std::vector<float> node_features(nodes.size() * 3, -1.0f);
+    g.GetNodeFeature(
+        std::span(nodes), std::span(features),
+        std::span(reinterpret_cast<uint8_t *>(node_features.data()), node_features.size() * sizeof(float)));
+    EXPECT_EQ(std::vector<float>({3, 3.5, 0, 0, 0, 0, 1, 1.5, 0}), node_features);
+
+    // Columnar and node-major features of the same node.
+    features = {{1, 2 * sizeof(float)}, {0, sizeof(float)}};
+    node_features.assign(nodes.size() * 3, -1.0f);
+    g.GetNodeFeature(
+        std::span(nodes), std::span(features),
+        std::span(reinterpret_cast<uint8_t *>(node_features.data()), node_features.size() * sizeof(float)));
+    EXPECT_EQ(std::vector<float>({1, 1, 3, 0, 0, 0, 1, 0, 1}), node_features);
+
+    // Raw values of columnar features are served too.
+    std::vector<snark::FeatureId> string_features = {0};
+    std::vector<int64_t> dimensions(nodes.size());
+    std::vector<uint8_t> values;
+    g.GetNodeStringFeature(std::span(nodes), std::span(string_features), std::span(dimensions), values);
+    EXPECT_EQ(std::vector<int64_t>({8, 0, 8}), dimensions);
+    EXPECT_EQ(std::vector<float>({3, 3.5, 1, 1.5}),
+              std::vector<float>(reinterpret_cast<float *>(values.data()),
+                                 reinterpret_cast<float *>(values.data() + values.size())));
+
+    std::filesystem::remove_all(path);
+}
+
+TEST(GraphTest, DenseFeaturesMatchNodeMajorFeatures)
+{
+    // Nodes of type 0 have the same feature sizes and are stored in a dense tensor, type 1 stays node-major.
+    TestGraph::MemoryGraph m;
+    for (snark::NodeId node = 0; node < 6; ++node)
+    {
+        const bool dense = node % 2 == 0;
+        m.m_nodes.push_back(TestGraph::Node{
+            .m_id = node,
+            .m_type = dense ? 0 : 1,
+            .m_weight = 1.0f,
+            .m_float_features = {std::vector<float>{float(node)},
+                                 std::vector<float>(dense ? 2 : node, float(node) + 0.5f)}});
+    }
+    auto path = std::filesystem::temp_directory_path() / "dense_features_test";
+    std::filesystem::remove_all(path);
+    std::filesystem::create_directories(path);
+    TestGraph::convert(path, "0_0", std::move(m), 2);
+
+    // Results don't depend on the layout.
+    for (bool columnar : {false, true})
+    {
+        snark::Graph g(snark::Metadata(path.string()), {path.string()}, {0}, snark::PartitionStorageType::memory,
+                       snark::GraphOptions{.m_columnar_features = columnar, .m_dense_features = true});
+
+        std::vector<snark::NodeId> nodes = {4, 3, 60, 0, 1};
+        std::vector<snark::FeatureMeta> features = {{1, 2 * sizeof(float)}, {0, sizeof(float)}, {2, sizeof(float)}};
+        std::vector<float> node_features(nodes.size() * 4, -1.0f);
+        g.GetNodeFeature(
+            std::span(nodes), std::span(features),
+            std::span(reinterpret_cast<uint8_t *>(node_features.data()), node_features.size() * sizeof(float)));
+        EXPECT_EQ(std::vector<float>({4.5, 4.5, 4, 0, 3.5, 3.5, 3, 0, 0, 0, 0, 0, 0.5, 0.5, 0, 0, 1.5, 0, 1, 0}),
+                  node_features);
+
+        std::vector<snark::FeatureId> string_features = {1};
+        std::vector<int64_t> dimensions(nodes.size());
+        std::vector<uint8_t> values;
+        g.GetNodeStringFeature(std::span(nodes), std::span(string_features), std::span(dimensions), values);
+        EXPECT_EQ(std::vector<int64_t>({8, 12, 0, 8, 4}), dimensions);
+        EXPECT_EQ(std::vector<float>({4.5, 4.5, 3.5, 3.5, 3.5, 0.5, 0.5, 1.5}),
+                  std::vector<float>(reinterpret_cast<float *>(values.data()),
+                                     reinterpret_cast<float *>(values.data() + values.size())));
+    }
+
+    std::filesystem::remove_all(path);
+}
+
+TEST(GraphTest, NodeFeatureViewsPointToStoredFeatures)
+{
+    TestGraph::MemoryGraph m;
+    for (snark::NodeId node = 0; node < 3; ++node)
+    {
+        m.m_nodes.push_back(TestGraph::Node{.m_id = node,
+                                            .m_type = 0,
+                                            .m_weight = 1.0f,
+                                            .m_float_features = {std::vector<float>(node + 1, float(node))}});
+    }
+    auto path = std::filesystem::temp_directory_path() / "feature_views_test";
+    std::filesystem::remove_all(path);
+    std::filesystem::create_directories(path);
+    TestGraph::convert(path, "0_0", std::move(m), 1);
+
+    std::vector<snark::NodeId> nodes = {2, 60, 0};
+    std::vector<snark::FeatureId> features = {0, 1};
+    for (auto storage_type : {snark::PartitionStorageType::memory, snark::PartitionStorageType::mmap})
+    {
+        snark::Graph g(snark::Metadata(path.string()), {path.string()}, {0}, storage_type);
+        std::vector<std::span<const uint8_t>> views(nodes.size() * features.size());
+        ASSERT_TRUE(g.GetNodeFeatureViews(std::span(nodes), std::span(features), std::span(views)));
+        std::vector<size_t> sizes;
+        for (const auto &view : views)
+        {
+            sizes.emplace_back(view.size());
+        }
+        EXPECT_EQ(std::vector<size_t>({3 * sizeof(float), 0, 0, 0, sizeof(float), 0}), sizes);
+        EXPECT_EQ(std::vector<float>({2, 2, 2}),
+                  std::vector<float>(reinterpret_cast<const float *>(views[0].data()),
+                                     reinterpret_cast<const float *>(views[0].data() + views[0].size())));
+        EXPECT_EQ(0.0f, *reinterpret_cast<const float *>(views[4].data()));
+    }
+
+    // Features on disk have to be copied.
+    snark::Graph g(snark::Metadata(path.string()), {path.string()}, {0}, snark::PartitionStorageType::disk);
+    std::vector<std::span<const uint8_t>> views(nodes.size() * features.size());
+    EXPECT_FALSE(g.GetNodeFeatureViews(std::span(nodes), std::span(features), std::span(views)));
+
+    std::filesystem::remove_all(path);
+}
+
+TEST(GraphTest, CompressedNeighborsDecodeNeighborIds)
+{
+    // Sorted runs with small gaps, a run with gaps over 32 bits stored in raw blocks and negative ids.
+    std::vector<snark::NodeId> neighbors;
+    std::vector<uint64_t> runs = {0};
+    for (snark::NodeId id = 0; id < 150; ++id)
+    {
+        neighbors.emplace_back(3 * id + id % 3);
+    }
+    runs.emplace_back(neighbors.size());
+    for (snark::NodeId id = 0; id < 70; ++id)
+    {
+        neighbors.emplace_back((id << 40) - std::numeric_limits<snark::NodeId>::max() / 2);
+    }
+    runs.emplace_back(neighbors.size());
+    for (snark::NodeId id = -5; id < 100; ++id)
+    {
+        neighbors.emplace_back(id * 1000);
+    }
+    runs.emplace_back(neighbors.size());
+
+    snark::CompressedNeighbors compressed(neighbors);
+    EXPECT_EQ(neighbors.size(), compressed.size());
+    EXPECT_LT(compressed.memory_size(), neighbors.size() * sizeof(snark::NodeId));
+    for (size_t i = 0; i < neighbors.size(); ++i)
+    {
+        EXPECT_EQ(neighbors[i], compressed[i]);
+    }
+
+    std::vector<snark::NodeId> decoded(neighbors.size());
+    for (auto [begin, end] : std::vector<std::pair<uint64_t, uint64_t>>{{0, neighbors.size()}, {5, 6}, {63, 200}})
+    {
+        compressed.Decode(begin, end, decoded.data());
+        EXPECT_EQ(std::vector<snark::NodeId>(std::begin(neighbors) + begin, std::begin(neighbors) + end),
+                  std::vector<snark::NodeId>(std::begin(decoded), std::begin(decoded) + (end - begin)));
+    }
+
+    for (size_t run = 0; run + 1 < runs.size(); ++run)
+    {
+        const auto begin = std::begin(neighbors) + runs[run];
+        const auto end = std::begin(neighbors) + runs[run + 1];
+        for (auto it = begin; it != end; ++it)
+        {
+            for (auto value : {*it - 1, *it, *it + 1})
+            {
+                EXPECT_EQ(uint64_t(std::lower_bound(begin, end, value) - std::begin(neighbors)),
+                          compressed.LowerBound(runs[run], runs[run + 1], value));
+            }
+        }
+    }
+}
+
+TEST(GraphTest, NeighborLayoutsMatchNeighborIds)
+{
+    // Nodes 0 and 2 are in the first partition, node 1 in the second one.
+    TestGraph::MemoryGraph m1, m2;
+    for (snark::NodeId node = 0; node < 3; ++node)
+    {
+        std::vector<TestGraph::NeighborRecord> neighbors;
+        for (snark::NodeId nb = 0; nb < 100 * (node + 1); ++nb)
+        {
+            neighbors.emplace_back(5 * nb + node, nb % 3 == 0 ? 0 : 1, 1.0f + nb % 4);
+        }
+        std::stable_sort(std::begin(neighbors), std::end(neighbors),
+                         [](const auto &left, const auto &right) { return std::get<1>(left) < std::get<1>(right); });
+        (node == 1 ? m2 : m1)
+            .m_nodes.push_back(
+                TestGraph::Node{.m_id = node, .m_type = 0, .m_weight = 1.0f, .m_neighbors = std::move(neighbors)});
+    }
+    auto path = std::filesystem::temp_directory_path() / "neighbor_layouts_test";
+    std::filesystem::remove_all(path);
+    std::filesystem::create_directories(path);
+    TestGraph::convert(path, "0_0", std::move(m1), 1);
+    TestGraph::convert(path, "1_0", std::move(m2), 1);
+    snark::Graph plain(snark::Metadata(path.string()), {path.string(), path.string()}, {0, 1},
+                       snark::PartitionStorageType::memory);
+
+    std::vector<snark::NodeId> nodes = {2, 0, 1, 5};
+    std::vector<snark::Type> types = {0, 1};
+    std::vector<snark::NodeId> plain_ids;
+    std::vector<snark::Type> plain_types;
+    std::vector<float> plain_weights;
+    std::vector<uint64_t> plain_counts(nodes.size());
+    plain.FullNeighbor(std::span(nodes), std::span(types), plain_ids, plain_types, plain_weights,
+                       std::span(plain_counts));
+    EXPECT_EQ(std::vector<uint64_t>({300, 100, 200, 0}), plain_counts);
+
+    const size_t count = 20;
+    std::vector<snark::NodeId> plain_samples(count * nodes.size()), samples(count * nodes.size());
+    std::vector<snark::Type> sample_types(count * nodes.size());
+    std::vector<float> sample_weights(count * nodes.size());
+    std::vector<float> total_weights(nodes.size());
+    plain.SampleNeighbor(13, std::span(nodes), std::span(types), count, std::span(plain_samples),
+                         std::span(sample_types), std::span(sample_weights), std::span(total_weights), -1, 0, -1);
+    std::vector<std::vector<snark::NodeId>> plain_uniform_samples;
+    std::vector<uint64_t> total_counts(nodes.size());
+    for (bool without_replacement : {true, false})
+    {
+        std::fill(std::begin(total_counts), std::end(total_counts), 0);
+        plain.UniformSampleNeighbor(without_replacement, 17, std::span(nodes), std::span(types), count,
+                                    std::span(samples), std::span(sample_types), std::span(total_counts), -1, -1);
+        plain_uniform_samples.emplace_back(samples);
+    }
+
+    // Compressed, compact and compressed compact neighbor ids.
+    for (auto [compressed_neighbors, compact_neighbor_ids] :
+         std::vector<std::pair<bool, bool>>{{true, false}, {false, true}, {true, true}})
+    {
+        snark::Graph g(snark::Metadata(path.string()), {path.string(), path.string()}, {0, 1},
+                       snark::PartitionStorageType::memory,
+                       snark::GraphOptions{.m_compressed_neighbors = compressed_neighbors,
+                                           .m_compact_neighbor_ids = compact_neighbor_ids});
+        std::vector<snark::NodeId> ids;
+        std::vector<snark::Type> neighbor_types;
+        std::vector<float> weights;
+        std::vector<uint64_t> counts(nodes.size());
+        g.FullNeighbor(std::span(nodes), std::span(types), ids, neighbor_types, weights, std::span(counts));
+        EXPECT_EQ(plain_counts, counts);
+        EXPECT_EQ(plain_ids, ids);
+        EXPECT_EQ(plain_weights, weights);
+
+        std::fill(std::begin(total_weights), std::end(total_weights), 0.0f);
+        g.SampleNeighbor(13, std::span(nodes), std::span(types), count, std::span(samples), std::span(sample_types),
+                         std::span(sample_weights), std::span(total_weights), -1, 0, -1);
+        EXPECT_EQ(plain_samples, samples);
+
+        for (bool without_replacement : {true, false})
+        {
+            std::fill(std::begin(total_counts), std::end(total_counts), 0);
+            g.UniformSampleNeighbor(without_replacement, 17, std::span(nodes), std::span(types), count,
+                                    std::span(samples), std::span(sample_types), std::span(total_counts), -1, -1);
+            EXPECT_EQ(plain_uniform_samples[without_replacement ? 0 : 1], samples);
+        }
+    }
+
+    std::filesystem::remove_all(path);
+}
+
+TEST(GraphTest, UnitEdgeWeightsSampleLikeWeightedEdges)
+{
+    // Edges of the weighted graph have weight 1 too, except an edge of node 10 which keeps its partition weighted.
+    auto path = std::filesystem::temp_directory_path() / "unit_edge_weights_test";
+    std::filesystem::remove_all(path);
+    for (auto name : {"unit", "weighted"})
+    {
+        TestGraph::MemoryGraph m;
+        for (snark::NodeId node = 0; node < 3; ++node)
+        {
+            std::vector<TestGraph::NeighborRecord> neighbors;
+            for (snark::NodeId nb = 0; nb < 30 * (node + 1); ++nb)
+            {
+                neighbors.emplace_back(nb + 100 * node, nb < 10 ? 0 : 1, 1.0f);
+            }
+            m.m_nodes.push_back(
+                TestGraph::Node{.m_id = node, .m_type = 0, .m_weight = 1.0f, .m_neighbors = std::move(neighbors)});
+        }
+        if (name == std::string("weighted"))
+        {
+            m.m_nodes.push_back(TestGraph::Node{
+                .m_id = 10, .m_type = 0, .m_weight = 1.0f, .m_neighbors{{TestGraph::NeighborRecord{0, 0, 2.0f}}}});
+        }
+        std::filesystem::create_directories(path / name);
+        auto partition = TestGraph::convert(path / name, "0_0", std::move(m), 1);
+        // Unit weights are restored in snapshots.
+        partition.WriteSnapshot(path / name, "0_0");
+    }
+
+    snark::Graph unit(snark::Metadata((path / "unit").string()), {(path / "unit").string()}, {0},
+                      snark::PartitionStorageType::memory);
+    snark::Graph weighted(snark::Metadata((path / "weighted").string()), {(path / "weighted").string()}, {0},
+                          snark::PartitionStorageType::memory);
+    std::vector<snark::NodeId> nodes = {2, 0, 1};
+    std::vector<snark::Type> types = {0, 1};
+    std::vector<snark::NodeId> neighbor_ids;
+    std::vector<snark::Type> neighbor_types;
+    std::vector<float> neighbor_weights;
+    std::vector<uint64_t> neighbor_counts(nodes.size());
+    unit.FullNeighbor(std::span(nodes), std::span(types), neighbor_ids, neighbor_types, neighbor_weights,
+                      std::span(neighbor_counts));
+    EXPECT_EQ(std::vector<uint64_t>({90, 30, 60}), neighbor_counts);
+    EXPECT_EQ(std::vector<float>(180, 1.0f), neighbor_weights);
+
+    const size_t count = 50;
+    std::vector<snark::NodeId> unit_samples(count * nodes.size()), weighted_samples(count * nodes.size());
+    std::vector<snark::Type> unit_types(count * nodes.size()), weighted_types(count * nodes.size());
+    std::vector<float> unit_weights(count * nodes.size()), weighted_weights(count * nodes.size());
+    std::vector<float> unit_total(nodes.size()), weighted_total(nodes.size());
+    unit.SampleNeighbor(21, std::span(nodes), std::span(types), count, std::span(unit_samples),
+                        std::span(unit_types), std::span(unit_weights), std::span(unit_total), -1, 0, -1);
+    weighted.SampleNeighbor(21, std::span(nodes), std::span(types), count, std::span(weighted_samples),
+                            std::span(weighted_types), std::span(weighted_weights), std::span(weighted_total), -1, 0,
+                            -1);
+    EXPECT_EQ(weighted_samples, unit_samples);
+    EXPECT_EQ(weighted_types, unit_types);
+    EXPECT_EQ(weighted_weights, unit_weights);
+    EXPECT_EQ(weighted_total, unit_total);
+
+    std::filesystem::remove_all(path);
+}
+
+TEST(GraphTest, AliasTablesSampleNeighborsByWeight)
+{
+    // Node 0 has 200 edges with weights 1 to 4 to sample from an alias table, node 1 is below the threshold.
+    auto path = std::filesystem::temp_directory_path() / "alias_tables_test";
+    std::filesystem::remove_all(path);
+    std::filesystem::create_directories(path);
+    {
+        TestGraph::MemoryGraph m;
+        for (snark::NodeId node = 0; node < 2; ++node)
+        {
+            std::vector<TestGraph::NeighborRecord> neighbors;
+            for (snark::NodeId nb = 0; nb < (node == 0 ? 200 : 5); ++nb)
+            {
+                neighbors.emplace_back(nb + 1000 * node, 0, float(nb % 4 + 1));
+            }
+            m.m_nodes.push_back(
+                TestGraph::Node{.m_id = node, .m_type = 0, .m_weight = 1.0f, .m_neighbors = std::move(neighbors)});
+        }
+        TestGraph::convert(path, "0_0", std::move(m), 1);
+    }
+
+    snark::Graph plain(snark::Metadata(path.string()), {path.string()}, {0}, snark::PartitionStorageType::memory);
+    snark::Graph alias(snark::Metadata(path.string()), {path.string()}, {0}, snark::PartitionStorageType::memory,
+                       snark::GraphOptions{.m_alias_degree_threshold = 100});
+    std::vector<snark::Type> types = {0};
+    const size_t count = 100000;
+    std::vector<snark::NodeId> samples(count), plain_samples(count);
+    std::vector<snark::Type> sample_types(count), plain_types(count);
+    std::vector<float> weights(count), plain_weights(count);
+    std::vector<float> total(1), plain_total(1);
+
+    std::vector<snark::NodeId> nodes = {1};
+    alias.SampleNeighbor(13, std::span(nodes), std::span(types), count, std::span(samples), std::span(sample_types),
+                         std::span(weights), std::span(total), -1, 0, -1);
+    plain.SampleNeighbor(13, std::span(nodes), std::span(types), count, std::span(plain_samples),
+                         std::span(plain_types), std::span(plain_weights), std::span(plain_total), -1, 0, -1);
+    EXPECT_EQ(plain_samples, samples);
+    EXPECT_EQ(plain_weights, weights);
+
+    nodes = {0};
+    total.front() = 0;
+    alias.SampleNeighbor(13, std::span(nodes), std::span(types), count, std::span(samples), std::span(sample_types),
+                         std::span(weights), std::span(total), -1, 0, -1);
+    EXPECT_EQ(500.0f, total.front());
+    std::vector<size_t> weight_counts(4);
+    for (size_t i = 0; i < count; ++i)
+    {
+        ASSERT_LE(0, samples[i]);
+        ASSERT_GT(200, samples[i]);
+        EXPECT_EQ(float(samples[i] % 4 + 1), weights[i]);
+        ++weight_counts[samples[i] % 4];
+    }
+    for (size_t weight = 1; weight <= 4; ++weight)
+    {
+        EXPECT_NEAR(weight / 10.0, double(weight_counts[weight - 1]) / count, 0.01);
+    }
+
+    std::filesystem::remove_all(path);
+}
+
+TEST(GraphTest, SearchTreesSampleLikeBinarySearch)
+{
+    // Short type runs keep the binary search, longer ones are searched in trees of one and two levels.
+    auto path = std::filesystem::temp_directory_path() / "search_trees_test";
+    std::filesystem::remove_all(path);
+    std::filesystem::create_directories(path);
+    {
+        TestGraph::MemoryGraph m;
+        snark::Xoroshiro128PlusGenerator gen(5);
+        boost::random::uniform_real_distribution<float> weight(0.5f, 3.0f);
+        const std::vector<snark::NodeId> degrees = {10, 17, 100, 300, 5000};
+        for (snark::NodeId node = 0; node < snark::NodeId(degrees.size()); ++node)
+        {
+            std::vector<TestGraph::NeighborRecord> neighbors;
+            for (snark::NodeId nb = 0; nb < degrees[node]; ++nb)
+            {
+                neighbors.emplace_back(nb + 10000 * node, nb < degrees[node] / 3 ? 0 : 1, weight(gen));
+            }
+            m.m_nodes.push_back(
+                TestGraph::Node{.m_id = node, .m_type = 0, .m_weight = 1.0f, .m_neighbors = std::move(neighbors)});
+        }
+        TestGraph::convert(path, "0_0", std::move(m), 1);
+    }
+
+    snark::Graph plain(snark::Metadata(path.string()), {path.string()}, {0}, snark::PartitionStorageType::memory);
+    snark::Graph tree(snark::Metadata(path.string()), {path.string()}, {0}, snark::PartitionStorageType::memory,
+                      snark::GraphOptions{.m_search_tree_degree_threshold = 1});
+    std::vector<snark::NodeId> nodes = {4, 0, 3, 1, 2};
+    std::vector<snark::Type> types = {0, 1};
+    const size_t count = 1000;
+    std::vector<snark::NodeId> samples(count * nodes.size()), plain_samples(count * nodes.size());
+    std::vector<snark::Type> sample_types(count * nodes.size()), plain_types(count * nodes.size());
+    std::vector<float> weights(count * nodes.size()), plain_weights(count * nodes.size());
+    std::vector<float> total(nodes.size()), plain_total(nodes.size());
+    tree.SampleNeighbor(17, std::span(nodes), std::span(types), count, std::span(samples), std::span(sample_types),
+                        std::span(weights), std::span(total), -1, 0, -1);
+    plain.SampleNeighbor(17, std::span(nodes), std::span(types), count, std::span(plain_samples),
+                         std::span(plain_types), std::span(plain_weights), std::span(plain_total), -1, 0, -1);
+    EXPECT_EQ(plain_samples, samples);
+    EXPECT_EQ(plain_types, sample_types);
+    EXPECT_EQ(plain_weights, weights);
+    EXPECT_EQ(plain_total, total);
+
+    std::filesystem::remove_all(path);
+}
+
+TEST(GraphTest, NumaWorkersRunOnRequestedNodes)
+{
+    snark::NumaWorkers workers(2, 2);
+    EXPECT_EQ(2, workers.NodeCount());
+
+    std::vector<size_t> calls(2);
+    std::vector<size_t> nodes = {0, 1};
+    for (size_t i = 0; i < 10; ++i)
+    {
+        workers.Run(nodes, [&calls](size_t node) { ++calls[node]; });
+    }
+    EXPECT_EQ(std::vector<size_t>({10, 10}), calls);
+
+    nodes = {1};
+    EXPECT_THROW(workers.Run(nodes, [](size_t node) { throw std::runtime_error("failed"); }), std::runtime_error);
+
+    bool called = false;
+    snark::run_on_numa_node(0, [&called]() { called = true; });
+    EXPECT_TRUE(called);
+    EXPECT_LE(1, snark::numa_node_count());
+}
+
+TEST(GraphTest, HugePageVectorsKeepValues)
+{
+    {
+        snark::HugePageScope scope(true);
+        // Small arrays use regular pages.
+        snark::huge_vector<uint64_t> small(16, 1);
+        EXPECT_EQ(0, snark::huge_page_stats().m_allocated);
+
+        const size_t count = snark::huge_page_size / sizeof(uint64_t) + 1;
+        snark::huge_vector<uint64_t> large(count);
+        std::iota(std::begin(large), std::end(large), 0);
+        EXPECT_EQ(2 * snark::huge_page_size, snark::huge_page_stats().m_allocated);
+        EXPECT_EQ(count - 1, large.back());
+        EXPECT_EQ(1, small.back());
+    }
+    EXPECT_EQ(0, snark::huge_page_stats().m_allocated);
+    EXPECT_FALSE(snark::huge_pages_enabled());
+
+    snark::huge_vector<uint64_t> regular(snark::huge_page_size / sizeof(uint64_t));
+    EXPECT_EQ(0, snark::huge_page_stats().m_allocated);
+}
+
+TEST(GraphTest, HugePageScopesApplyToTheirThreads)
+{
+    snark::HugePageScope enabled(true);
+    {
+        // A graph loaded without huge pages on another thread doesn't turn them off here.
+        std::thread other([]() {
+            snark::HugePageScope disabled(false);
+            EXPECT_FALSE(snark::huge_pages_enabled());
+        });
+        other.join();
+    }
+    EXPECT_TRUE(snark::huge_pages_enabled());
+
+    std::vector<char> inherited(4, 0);
+    snark::parallel_for(
+        inherited.size(), [&inherited](size_t index) { inherited[index] = snark::huge_pages_enabled(); },
+        inherited.size());
+    EXPECT_EQ(std::vector<char>(4, 1), inherited);
+
+    bool numa_inherited = false;
+    snark::run_on_numa_node(0, [&numa_inherited]() { numa_inherited = snark::huge_pages_enabled(); });
+    EXPECT_TRUE(numa_inherited);
+
+    std::thread unrelated([]() { EXPECT_FALSE(snark::huge_pages_enabled()); });
+    unrelated.join();
+}
+
 TEST(GraphTest, NodeFeaturesMultipleTypesNeighborsSpreadAcrossPartitions)
 {
     TestGraph::MemoryGraph m1;
@@ -1433,4 +2657,104 @@ TEST(GraphTest, GetNeigborCountMultiplePartitions)
 }
 
 INSTANTIATE_TEST_SUITE_P(StorageTypeGroup, StorageTypeGraphTest,
-                         testing::Values(snark::PartitionStorageType::memory, snark::PartitionStorageType::disk));
+                         testing::Values(snark::PartitionStorageType::memory, snark::PartitionStorageType::disk,
+                                         snark::PartitionStorageType::mmap));
+
+class AsyncReaderTest : public testing::TestWithParam<snark::AsyncReader::Backend>
+{
+};
+
+TEST_P(AsyncReaderTest, BatchReadsMatchFileContent)
+{
+    auto path = std::filesystem::temp_directory_path() / "async_reader_test.data";
+    std::vector<uint8_t> content(1 << 16);
+    for (size_t i = 0; i < content.size(); ++i)
+    {
+        content[i] = uint8_t(i * 31 + 7);
+    }
+    {
+        FILE *out = fopen(path.string().c_str(), "wb");
+        fwrite(content.data(), 1, content.size(), out);
+        fclose(out);
+    }
+
+    // Use more requests than the io_uring queue depth to check submissions are refilled.
+    FILE *file = fopen(path.string().c_str(), "rb");
+    snark::Xoroshiro128PlusGenerator gen(13);
+    boost::random::uniform_int_distribution<size_t> offsets(0, content.size() - 100);
+    boost::random::uniform_int_distribution<size_t> sizes(0, 100);
+    std::vector<std::vector<uint8_t>> outputs(1000);
+    std::vector<snark::ReadRequest> requests;
+    for (auto &output : outputs)
+    {
+        output.resize(sizes(gen));
+        requests.emplace_back(snark::ReadRequest{file, offsets(gen), output.size(), output.data()});
+    }
+
+    // Read past the end of file stops at the last byte.
+    std::vector<uint8_t> tail(20);
+    requests.emplace_back(snark::ReadRequest{file, content.size() - 10, tail.size(), tail.data()});
+
+    snark::AsyncReader reader(GetParam());
+    reader.Read(requests);
+    fclose(file);
+
+    for (size_t i = 0; i < outputs.size(); ++i)
+    {
+        auto expected = std::begin(content) + requests[i].m_offset;
+        EXPECT_TRUE(std::equal(std::begin(outputs[i]), std::end(outputs[i]), expected));
+    }
+    EXPECT_TRUE(std::equal(std::begin(tail), std::begin(tail) + 10, std::end(content) - 10));
+    EXPECT_TRUE(std::all_of(std::begin(tail) + 10, std::end(tail), [](uint8_t v) { return v == 0; }));
+}
+
+TEST(AsyncReaderWorkersTest, ConcurrentBatchesAreRead)
+{
+    auto path = std::filesystem::temp_directory_path() / "async_reader_workers_test.data";
+    std::vector<uint64_t> content(1 << 12);
+    std::iota(std::begin(content), std::end(content), 0);
+    {
+        FILE *out = fopen(path.string().c_str(), "wb");
+        fwrite(content.data(), sizeof(uint64_t), content.size(), out);
+        fclose(out);
+    }
+
+    // Every batch is large enough to be split between workers, callers read batches back to back.
+    FILE *file = fopen(path.string().c_str(), "rb");
+    snark::AsyncReader reader(snark::AsyncReader::Backend::threads);
+    std::vector<std::vector<uint64_t>> outputs(4, std::vector<uint64_t>(content.size()));
+    std::vector<std::thread> callers;
+    for (size_t caller = 0; caller < outputs.size(); ++caller)
+    {
+        callers.emplace_back([&, caller]() {
+            auto &output = outputs[caller];
+            for (size_t round = 0; round < 10; ++round)
+            {
+                std::fill(std::begin(output), std::end(output), 0);
+                std::vector<snark::ReadRequest> requests;
+                for (size_t i = 0; i < output.size(); ++i)
+                {
+                    const uint64_t offset = (output.size() - 1 - i) * sizeof(uint64_t);
+                    requests.emplace_back(
+                        snark::ReadRequest{file, offset, sizeof(uint64_t), reinterpret_cast<uint8_t *>(&output[i])});
+                }
+                reader.Read(requests);
+            }
+        });
+    }
+    for (auto &caller : callers)
+    {
+        caller.join();
+    }
+    fclose(file);
+
+    for (const auto &output : outputs)
+    {
+        EXPECT_TRUE(std::equal(std::begin(output), std::end(output), std::rbegin(content)));
+    }
+    std::filesystem::remove(path);
+}
+
+INSTANTIATE_TEST_SUITE_P(AsyncReaderGroup, AsyncReaderTest,
+                         testing::Values(snark::AsyncReader::Backend::io_uring,
+                                         snark::AsyncReader::Backend::threads));
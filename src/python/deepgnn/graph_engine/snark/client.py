@@ -52,6 +52,27 @@ class PartitionStorageType(IntEnum):
 
     memory = 0
     disk = 1
+    mmap = 2
+    hybrid = 3
+
+
+class _GraphOptions(Structure):
+    """Layout should match PyGraphOptions in py_graph.h."""
+
+    _fields_ = [
+        ("feature_cache_size", c_size_t),
+        ("block_cache_size", c_size_t),
+        ("pinned_features_size", c_size_t),
+        ("numa", c_bool),
+        ("numa_node_count", c_size_t),
+        ("huge_pages", c_bool),
+        ("columnar_features", c_bool),
+        ("dense_features", c_bool),
+        ("compressed_neighbors", c_bool),
+        ("compact_neighbor_ids", c_bool),
+        ("alias_degree_threshold", c_size_t),
+        ("search_tree_degree_threshold", c_size_t),
+    ]
 
 
 # Define our own classes to copy data from C to Python runtime.
@@ -152,6 +173,16 @@ class MemoryGraph:
         storage_type: PartitionStorageType = PartitionStorageType.memory,
         config_path: str = "",
         stream: bool = False,
+        feature_cache_size: int = 0,
+        block_cache_size: int = 64 * 1024 * 1024,
+        pinned_features_size: int = 0,
+        huge_pages: bool = False,
+        columnar_features: bool = False,
+        dense_features: bool = False,
+        compressed_neighbors: bool = False,
+        compact_neighbor_ids: bool = False,
+        alias_degree_threshold: int = 0,
+        search_tree_degree_threshold: int = 0,
     ):
         """Load graph to memory.
 
@@ -165,6 +196,16 @@ class MemoryGraph:
             config_path (str, optional): Path to folder with configuration files.
             stream (bool, default=False): If remote path is given: by default, download files first then load,
                 if stream = True and libhdfs present, stream data directly to memory -- see docs/advanced/hdfs.md for setup and usage.
+            feature_cache_size (int, default=0): Memory budget in bytes to cache features read from disk storage, 0 disables cache.
+            block_cache_size (int, default=64MB): Memory budget in bytes to cache decompressed blocks of compressed feature data read from disk storage, 0 disables cache.
+            pinned_features_size (int, default=0): Memory budget in bytes for features of the highest degree nodes in hybrid storage.
+            huge_pages (bool, default=False): Back large graph arrays with huge pages to reduce TLB misses of random reads.
+            columnar_features (bool, default=False): Store node features of the same size for every node feature-major in memory partitions.
+            dense_features (bool, default=False): Store features of node types with the same feature sizes for every node as dense tensors without a feature index in memory partitions.
+            compressed_neighbors (bool, default=False): Keep neighbor ids delta encoded in blocks to reduce adjacency memory.
+            compact_neighbor_ids (bool, default=False): Replace neighbor ids with 32 bit indices in a table of neighbor ids shared by all partitions.
+            alias_degree_threshold (int, default=0): Sample weighted neighbors of nodes with at least this many edges of a type from alias tables, 0 disables them.
+            search_tree_degree_threshold (int, default=0): Search cumulative weights of nodes with at least this many edges of a type in trees of 16 weight blocks instead of a binary search, 0 disables them.
         """
         if partitions is None:
             partitions = [(meta_path, 0)]
@@ -196,6 +237,7 @@ class MemoryGraph:
             POINTER(c_uint32),
             POINTER(c_char_p),
             c_int32,
+            POINTER(_GraphOptions),
             c_char_p,
         ]
 
@@ -220,6 +262,20 @@ class MemoryGraph:
             partition_array,
             location_array,
             c_int32(storage_type),
+            byref(
+                _GraphOptions(
+                    feature_cache_size=feature_cache_size,
+                    block_cache_size=block_cache_size,
+                    pinned_features_size=pinned_features_size,
+                    huge_pages=huge_pages,
+                    columnar_features=columnar_features,
+                    dense_features=dense_features,
+                    compressed_neighbors=compressed_neighbors,
+                    compact_neighbor_ids=compact_neighbor_ids,
+                    alias_degree_threshold=alias_degree_threshold,
+                    search_tree_degree_threshold=search_tree_degree_threshold,
+                )
+            ),
             c_char_p(bytes(config_path, "utf-8")),
         )
         self._describe_clib_functions()
@@ -303,6 +359,18 @@ class MemoryGraph:
             "extract node string features"
         )
 
+        self.lib.GetNodeFeatureViews.argtypes = [
+            POINTER(_DEEP_GRAPH),
+            POINTER(c_int64),
+            c_size_t,
+            POINTER(c_int32),
+            c_size_t,
+            POINTER(POINTER(c_uint8)),
+            POINTER(c_uint64),
+        ]
+        # Features that can't be viewed are reported with a return code instead of an exception.
+        self.lib.GetNodeFeatureViews.restype = c_int32
+
         self.lib.GetEdgeStringFeature.argtypes = [
             POINTER(_DEEP_GRAPH),
             POINTER(c_int64),
@@ -381,6 +449,15 @@ class MemoryGraph:
             "sample neighbors with uniform distribution"
         )
 
+        self.lib.GetFeatureCacheStats.argtypes = [
+            POINTER(_DEEP_GRAPH),
+            POINTER(c_uint64),
+            POINTER(c_uint64),
+        ]
+        self.lib.GetFeatureCacheStats.errcheck = _ErrCallback(  # type: ignore
+            "get feature cache stats"
+        )
+
         self.lib.ResetGraph.argtypes = [POINTER(_DEEP_GRAPH)]
         self.lib.ResetGraph.restype = c_int32
         self.lib.ResetGraph.errcheck = _ErrCallback("reset graph")  # type: ignore
@@ -509,6 +586,51 @@ class MemoryGraph:
 
         return py_cb.values, dimensions // py_cb.values.itemsize
 
+    def node_feature_views(
+        self, nodes: np.ndarray, features: np.ndarray, dtype: np.dtype
+    ) -> Optional[List[np.ndarray]]:
+        """Retrieve node features without copying them from graph storage.
+
+        Args:
+            nodes (np.array): list of nodes
+            features (np.array): list of feature ids
+            dtype (np.dtype): feature types to extract
+
+        Returns:
+            List[np.ndarray]: Read-only arrays over stored features ordered by node ids first and then by feature ids,
+                valid while the graph is loaded. Arrays of missing features are empty. None if some feature is
+                not stored in memory or memory mapped storage, node_string_features copies such features.
+        """
+        nodes = np.array(nodes, dtype=np.int64)
+        features = np.array(features, dtype=np.int32)
+        assert len(features.shape) == 1
+
+        data = (POINTER(c_uint8) * (nodes.size * features.size))()
+        sizes = np.zeros(nodes.size * features.size, dtype=np.uint64)
+        result = self.lib.GetNodeFeatureViews(
+            self.g_,
+            nodes.ctypes.data_as(POINTER(c_int64)),
+            c_size_t(len(nodes)),
+            features.ctypes.data_as(POINTER(c_int32)),
+            c_size_t(len(features)),
+            data,
+            sizes.ctypes.data_as(POINTER(c_uint64)),
+        )
+        if result == 2:
+            return None
+        if result != 0:
+            raise Exception("Failed to extract node feature views")
+
+        views = []
+        for pointer, size in zip(data, sizes):
+            if size == 0:
+                views.append(np.empty(0, dtype=dtype))
+                continue
+            view = np.ctypeslib.as_array(pointer, shape=(int(size),)).view(dtype)
+            view.flags.writeable = False
+            views.append(view)
+        return views
+
     def edge_features(
         self,
         edge_src: np.ndarray,
@@ -808,6 +930,13 @@ class MemoryGraph:
 
         return result_nodes, result_types
 
+    def feature_cache_stats(self) -> Tuple[int, int]:
+        """Return number of hits and misses of the feature cache."""
+        hits = c_uint64()
+        misses = c_uint64()
+        self.lib.GetFeatureCacheStats(self.g_, byref(hits), byref(misses))
+        return hits.value, misses.value
+
     def reset(self):
         """Reset graph and unload it from memory."""
         self.lib.ResetGraph(self.g_)
@@ -64,6 +64,17 @@ class Server:
         storage_type: client.PartitionStorageType = client.PartitionStorageType.memory,
         config_path: str = "",
         stream: bool = False,
+        feature_cache_size: int = 0,
+        block_cache_size: int = 64 * 1024 * 1024,
+        pinned_features_size: int = 0,
+        numa: bool = False,
+        huge_pages: bool = False,
+        columnar_features: bool = False,
+        dense_features: bool = False,
+        compressed_neighbors: bool = False,
+        compact_neighbor_ids: bool = False,
+        alias_degree_threshold: int = 0,
+        search_tree_degree_threshold: int = 0,
     ):
         """Init snark server."""
         temp_dir = tempfile.TemporaryDirectory()
@@ -99,6 +110,17 @@ class Server:
             storage_type,
             config_path,
             stream,  # type: ignore
+            feature_cache_size,
+            block_cache_size,
+            pinned_features_size,
+            numa,
+            huge_pages,
+            columnar_features,
+            dense_features,
+            compressed_neighbors,
+            compact_neighbor_ids,
+            alias_degree_threshold,
+            search_tree_degree_threshold,
         )
 
     def reset(self):
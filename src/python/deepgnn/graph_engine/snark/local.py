@@ -29,6 +29,16 @@ class Client(Graph):
         storage_type: client.PartitionStorageType = client.PartitionStorageType.memory,
         config_path: str = "",
         stream: bool = False,
+        feature_cache_size: int = 0,
+        block_cache_size: int = 64 * 1024 * 1024,
+        pinned_features_size: int = 0,
+        huge_pages: bool = False,
+        columnar_features: bool = False,
+        dense_features: bool = False,
+        compressed_neighbors: bool = False,
+        compact_neighbor_ids: bool = False,
+        alias_degree_threshold: int = 0,
+        search_tree_degree_threshold: int = 0,
     ):
         """Provide a convenient wrapper around ctypes API of native graph."""
         self.logger = get_logger()
@@ -42,7 +52,21 @@ class Client(Graph):
             f"Graph data path: {path}. Partitions {partitions}. Storage type {storage_type}. Config path {config_path}. Stream {stream}."
         )
         self.graph = client.MemoryGraph(
-            path, partitions_with_paths, storage_type, config_path, stream
+            path,
+            partitions_with_paths,
+            storage_type,
+            config_path,
+            stream,
+            feature_cache_size,
+            block_cache_size,
+            pinned_features_size,
+            huge_pages,
+            columnar_features,
+            dense_features,
+            compressed_neighbors,
+            compact_neighbor_ids,
+            alias_degree_threshold,
+            search_tree_degree_threshold,
         )
         self.node_samplers: Dict[str, client.NodeSampler] = {}
         self.edge_samplers: Dict[str, client.EdgeSampler] = {}
@@ -3,12 +3,20 @@
 
 """Stanalone graph engine server."""
 from datetime import datetime
-from ctypes import POINTER, Structure, byref, c_char_p, c_size_t, c_uint32, c_int32
+from ctypes import (
+    POINTER,
+    Structure,
+    byref,
+    c_char_p,
+    c_size_t,
+    c_uint32,
+    c_int32,
+)
 from typing import Optional, Any, Dict, List, Tuple, Union, Sequence
 
 from deepgnn.graph_engine.snark._lib import _get_c_lib
 from deepgnn.graph_engine.snark._downloader import download_graph_data, GraphPath
-from deepgnn.graph_engine.snark.client import PartitionStorageType
+from deepgnn.graph_engine.snark.client import PartitionStorageType, _GraphOptions
 from deepgnn.graph_engine.snark.meta import _set_hadoop_classpath
 
 
@@ -39,6 +47,17 @@ class Server:
         storage_type: PartitionStorageType = PartitionStorageType.memory,
         config_path: str = "",
         stream: bool = False,
+        feature_cache_size: int = 0,
+        block_cache_size: int = 64 * 1024 * 1024,
+        pinned_features_size: int = 0,
+        numa: bool = False,
+        huge_pages: bool = False,
+        columnar_features: bool = False,
+        dense_features: bool = False,
+        compressed_neighbors: bool = False,
+        compact_neighbor_ids: bool = False,
+        alias_degree_threshold: int = 0,
+        search_tree_degree_threshold: int = 0,
     ):
         """Create server and start it.
 
@@ -54,6 +73,17 @@ class Server:
             config_path (str, optional): Path to folder with configuration files for hdfs access.
             stream (bool, default=False): If remote path is given: by default, download files first then load,
                 if stream = True and libhdfs present, stream data directly to memory.
+            feature_cache_size (int, default=0): Memory budget in bytes to cache features read from disk storage, 0 disables cache.
+            block_cache_size (int, default=64MB): Memory budget in bytes to cache decompressed blocks of compressed feature data read from disk storage, 0 disables cache.
+            pinned_features_size (int, default=0): Memory budget in bytes for features of the highest degree nodes in hybrid storage.
+            numa (bool, default=False): Place partitions on NUMA nodes and serve requests with threads bound to them.
+            huge_pages (bool, default=False): Back large graph arrays with huge pages to reduce TLB misses of random reads.
+            columnar_features (bool, default=False): Store node features of the same size for every node feature-major in memory partitions.
+            dense_features (bool, default=False): Store features of node types with the same feature sizes for every node as dense tensors without a feature index in memory partitions.
+            compressed_neighbors (bool, default=False): Keep neighbor ids delta encoded in blocks to reduce adjacency memory.
+            compact_neighbor_ids (bool, default=False): Replace neighbor ids with 32 bit indices in a table of neighbor ids shared by all partitions.
+            alias_degree_threshold (int, default=0): Sample weighted neighbors of nodes with at least this many edges of a type from alias tables, 0 disables them.
+            search_tree_degree_threshold (int, default=0): Search cumulative weights of nodes with at least this many edges of a type in trees of 16 weight blocks instead of a binary search, 0 disables them.
         """
         if partitions is None:
             partitions = [(meta_path, 0)]
@@ -97,6 +127,7 @@ class Server:
             c_char_p,
             c_char_p,
             c_int32,
+            POINTER(_GraphOptions),
             c_char_p,
         ]
 
@@ -131,6 +162,21 @@ class Server:
             ssl_cert,
             ssl_root,
             c_int32(storage_type),
+            byref(
+                _GraphOptions(
+                    feature_cache_size=feature_cache_size,
+                    block_cache_size=block_cache_size,
+                    pinned_features_size=pinned_features_size,
+                    numa=numa,
+                    huge_pages=huge_pages,
+                    columnar_features=columnar_features,
+                    dense_features=dense_features,
+                    compressed_neighbors=compressed_neighbors,
+                    compact_neighbor_ids=compact_neighbor_ids,
+                    alias_degree_threshold=alias_degree_threshold,
+                    search_tree_degree_threshold=search_tree_degree_threshold,
+                )
+            ),
             c_char_p(bytes(config_path, "utf-8")),
         )
 
@@ -190,6 +236,72 @@ if __name__ == "__main__":
         + list(PartitionStorageType),
         help="Partition storage backing to use, eg memory or disk.",
     )
+    parser.add_argument(
+        "--feature_cache_size",
+        type=int,
+        default=0,
+        help="Memory budget in bytes to cache features read from disk storage.",
+    )
+    parser.add_argument(
+        "--block_cache_size",
+        type=int,
+        default=64 * 1024 * 1024,
+        help="Memory budget in bytes to cache decompressed blocks of compressed feature data read from disk storage.",
+    )
+    parser.add_argument(
+        "--pinned_features_size",
+        type=int,
+        default=0,
+        help="Memory budget in bytes for features of the highest degree nodes in hybrid storage.",
+    )
+    parser.add_argument(
+        "--numa",
+        action="store_true",
+        default=False,
+        help="Place partitions on NUMA nodes and serve requests with threads bound to them.",
+    )
+    parser.add_argument(
+        "--huge_pages",
+        action="store_true",
+        default=False,
+        help="Back large graph arrays with huge pages to reduce TLB misses of random reads.",
+    )
+    parser.add_argument(
+        "--columnar_features",
+        action="store_true",
+        default=False,
+        help="Store node features of the same size for every node feature-major in memory partitions.",
+    )
+    parser.add_argument(
+        "--dense_features",
+        action="store_true",
+        default=False,
+        help="Store features of node types with the same feature sizes for every node as dense tensors in memory partitions.",
+    )
+    parser.add_argument(
+        "--compressed_neighbors",
+        action="store_true",
+        default=False,
+        help="Keep neighbor ids delta encoded in blocks to reduce adjacency memory.",
+    )
+    parser.add_argument(
+        "--compact_neighbor_ids",
+        action="store_true",
+        default=False,
+        help="Replace neighbor ids with 32 bit indices in a table of neighbor ids shared by all partitions.",
+    )
+    parser.add_argument(
+        "--alias_degree_threshold",
+        type=int,
+        default=0,
+        help="Sample weighted neighbors of nodes with at least this many edges of a type from alias tables, 0 disables them.",
+    )
+    parser.add_argument(
+        "--search_tree_degree_threshold",
+        type=int,
+        default=0,
+        help="Search cumulative weights of nodes with at least this many edges of a type in trees of 16 weight blocks, 0 disables them.",
+    )
     parser.add_argument(
         "--config_path",
         type=str,
@@ -223,6 +335,17 @@ if __name__ == "__main__":
         storage_type=args.storage_type,
         config_path=args.config_path,
         stream=args.stream,
+        feature_cache_size=args.feature_cache_size,
+        block_cache_size=args.block_cache_size,
+        pinned_features_size=args.pinned_features_size,
+        numa=args.numa,
+        huge_pages=args.huge_pages,
+        columnar_features=args.columnar_features,
+        dense_features=args.dense_features,
+        compressed_neighbors=args.compressed_neighbors,
+        compact_neighbor_ids=args.compact_neighbor_ids,
+        alias_degree_threshold=args.alias_degree_threshold,
+        search_tree_degree_threshold=args.search_tree_degree_threshold,
     )
     logger.info("Server started...")
     try:
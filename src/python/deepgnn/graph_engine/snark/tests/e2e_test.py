@@ -13,6 +13,7 @@ import platform
 from typing import List, Tuple
 import socket
 from contextlib import closing
+from ctypes import POINTER, c_int32, c_int64, c_size_t, c_uint8, c_uint64
 
 import numpy as np
 import numpy.testing as npt
@@ -532,6 +533,66 @@ def test_node_features_graph_multiple_partitions(
     npt.assert_equal(v_missing, [[0, 0, 0], [13, 17, 0]])
 
 
+@pytest.mark.parametrize(
+    "storage_type",
+    [client.PartitionStorageType.memory, client.PartitionStorageType.mmap],
+)
+@pytest.mark.parametrize("multi_partition_graph_data", param, indirect=True)
+def test_node_feature_views_graph_multiple_partitions(
+    multi_partition_graph_data, storage_type
+):
+    cl = client.MemoryGraph(
+        multi_partition_graph_data,
+        [0, 1],
+        storage_type,
+    )
+    views = cl.node_feature_views(
+        np.array([9, 0, -1], dtype=np.int64),
+        features=np.array([1, 2], dtype=np.int32),
+        dtype=np.float32,
+    )
+    v = cl.node_features(
+        np.array([9, 0], dtype=np.int64),
+        features=np.array([[1, 2]], dtype=np.int32),
+        dtype=np.float32,
+    )
+
+    # Views are ordered by nodes first, node 0 has no feature 2 and node -1 is missing.
+    assert views is not None
+    assert len(views) == 6
+    npt.assert_array_equal(views[0], v[0])
+    npt.assert_array_equal(views[2], v[1])
+    npt.assert_equal(views[1].view(np.uint64), [13, 17])
+    for view in [views[0], views[1], views[2]]:
+        assert not view.flags.writeable
+        with pytest.raises(ValueError):
+            view[0] = 0
+    for view in [views[3], views[4], views[5]]:
+        assert view.size == 0
+
+
+@pytest.mark.parametrize("multi_partition_graph_data", ["original"], indirect=True)
+def test_node_feature_views_disk_storage(multi_partition_graph_data):
+    cl = client.MemoryGraph(
+        multi_partition_graph_data,
+        [0, 1],
+        client.PartitionStorageType.disk,
+    )
+
+    # Features read from disk have no stable memory to view.
+    result = cl.lib.GetNodeFeatureViews(
+        cl.g_,
+        np.array([9], dtype=np.int64).ctypes.data_as(POINTER(c_int64)),
+        c_size_t(1),
+        np.array([1], dtype=np.int32).ctypes.data_as(POINTER(c_int32)),
+        c_size_t(1),
+        (POINTER(c_uint8) * 1)(),
+        np.zeros(1, dtype=np.uint64).ctypes.data_as(POINTER(c_uint64)),
+    )
+    assert result == 2
+    assert cl.node_feature_views([9], [1], np.float32) is None
+
+
 @pytest.mark.parametrize(
     "storage_type",
     [client.PartitionStorageType.memory, client.PartitionStorageType.disk],